@@ -0,0 +1,119 @@
+/*
+ * Benchmark of batch conversion throughput against the number of worker
+ * threads.  A set of PGM files of very unequal sizes (64 to 1024 pixels on
+ * a side, mixing smooth and noisy content) is written to a temporary
+ * directory, and the whole set is converted to birp with 1, 2, 4, ... up to
+ * MAX_JOBS threads.  Results are printed one JSON object per line on the
+ * standard output, with the speedup over one thread.
+ *
+ * Usage: batch_bench [-f FILES] [-j MAX_JOBS] [-r REPEAT]
+ *   FILES     number of files in the set (default 40)
+ *   MAX_JOBS  largest number of threads (default: the number of online CPUs)
+ *   REPEAT    runs per thread count; the fastest is reported (default 1)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "const.h"
+#include "image.h"
+#include "batch.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Write file number i of the set: sizes cycle through 64..1024, content alternates. */
+static int write_input(const char *dir, int i) {
+    int size = 64 << (i % 5);
+    unsigned char *raster = malloc((size_t) size * size);
+    if (raster == NULL)
+        return -1;
+    unsigned int seed = 1234 + i;
+    for (int r = 0; r < size; r++) {
+        for (int c = 0; c < size; c++) {
+            seed = seed * 1103515245 + 12345;
+            int noisy = (i % 2 == 0) && ((r / 32 + c / 32) % 2 == 0);
+            raster[(size_t) r * size + c] = noisy ? (unsigned char) (seed >> 16) : (unsigned char) ((r + c + i) / 8);
+        }
+    }
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/in%03d.pgm", dir, i);
+    FILE *f = fopen(path, "w");
+    int err = f == NULL || img_write_pgm(raster, size, size, f);
+    if (f != NULL)
+        fclose(f);
+    free(raster);
+    return err ? -1 : 0;
+}
+
+int main(int argc, char **argv) {
+    int files = 40;
+    int max_jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int repeat = 1;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-f") == 0) {
+            files = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-j") == 0) {
+            max_jobs = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+            repeat = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-f FILES] [-j MAX_JOBS] [-r REPEAT]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (files <= 0 || max_jobs <= 0 || max_jobs > BATCH_JOBS_MAX || repeat <= 0)
+        return EXIT_FAILURE;
+
+    char in_dir[] = "/tmp/batch_bench_in_XXXXXX";
+    char out_dir[] = "/tmp/batch_bench_out_XXXXXX";
+    if (mkdtemp(in_dir) == NULL || mkdtemp(out_dir) == NULL)
+        return EXIT_FAILURE;
+    for (int i = 0; i < files; i++) {
+        if (write_input(in_dir, i) == -1) {
+            fprintf(stderr, "cannot write input files in %s\n", in_dir);
+            return EXIT_FAILURE;
+        }
+    }
+
+    FILE *log = fopen("/dev/null", "w");
+    char *inputs[] = {in_dir};
+    double base = 0;
+    for (int jobs = 1; ; jobs = jobs * 2 < max_jobs ? jobs * 2 : max_jobs) {
+        double best = -1;
+        int status = 0;
+        for (int rep = 0; rep < repeat; rep++) {
+            global_options = 0x21;
+            double start = now();
+            status |= birp_batch(inputs, 1, out_dir, jobs, log);
+            double seconds = now() - start;
+            if (best < 0 || seconds < best)
+                best = seconds;
+        }
+        if (jobs == 1)
+            base = best;
+        printf("{\"bench\":\"batch\",\"files\":%d,\"jobs\":%d,\"status\":\"%s\",\"seconds\":%.6f,"
+               "\"files_per_s\":%.2f,\"speedup\":%.2f}\n", files, jobs, status == 0 ? "ok" : "failed",
+               best, files / best, base / best);
+        fflush(stdout);
+        if (jobs == max_jobs)
+            break;
+    }
+    fclose(log);
+
+    char path[1024];
+    for (int i = 0; i < files; i++) {
+        snprintf(path, sizeof(path), "%s/in%03d.pgm", in_dir, i);
+        remove(path);
+        snprintf(path, sizeof(path), "%s/in%03d.birp", out_dir, i);
+        remove(path);
+    }
+    remove(in_dir);
+    remove(out_dir);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,262 @@
+/*
+ * Benchmark driver for the BDD hot paths.  For every combination of
+ * synthetic image and size, each of bdd_from_raster, bdd_to_raster,
+ * bdd_serialize, bdd_deserialize, bdd_map, bdd_rotate and bdd_zoom is timed
+ * separately.  Results are printed one JSON object per line on the
+ * standard output so they can be collected and compared across releases.
+ *
+ * Usage: birp_bench [-s SIZES] [-i IMAGES] [-r REPEAT] [-b BUDGET] [-d RSRC_DIR]
+ *   SIZES   comma-separated edge lengths, ascending (default 1024,4096; at most 8192)
+ *   IMAGES  comma-separated list drawn from uniform, checker, gradient,
+ *           noise, M, checker_pgm, cour25, stone (default: all)
+ *   REPEAT  runs per operation; the fastest is reported (default 1)
+ *   BUDGET  seconds; once all operations on an image take longer than this,
+ *           larger sizes of that image are reported as "over_budget" rather
+ *           than run (default 0, no budget)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "image.h"
+
+static const char *all_images[] = {
+    "uniform", "checker", "gradient", "noise", "M", "checker_pgm", "cour25", "stone", NULL
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned char complement_pixel(unsigned char byte) {
+    return 255 - byte;
+}
+
+static int in_list(const char *list, const char *name) {
+    size_t n = strlen(name);
+    for (const char *p = list; p != NULL && *p != '\0'; ) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t) (end - p) : strlen(p);
+        if (len == n && strncmp(p, name, n) == 0)
+            return 1;
+        p = end ? end + 1 : NULL;
+    }
+    return 0;
+}
+
+/* Tile a sample PGM from the resource directory over a size x size raster. */
+static int tile_sample(const char *dir, const char *name, int size) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.pgm", dir, name);
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return -1;
+    static unsigned char sample[1 << 20];
+    int w, h;
+    int err = img_read_pgm(f, &w, &h, sample, sizeof(sample));
+    fclose(f);
+    if (err)
+        return -1;
+    for (int r = 0; r < size; r++)
+        for (int c = 0; c < size; c++)
+            raster_data[(size_t) r * size + c] = sample[(r % h) * w + (c % w)];
+    return 0;
+}
+
+static int generate(const char *dir, const char *image, int size) {
+    if (raster_reserve((size_t) size * size) == NULL)
+        return -1;
+    if (strcmp(image, "checker_pgm") == 0)
+        return tile_sample(dir, "checker", size);
+    if (strcmp(image, "M") == 0 || strcmp(image, "cour25") == 0 || strcmp(image, "stone") == 0)
+        return tile_sample(dir, image, size);
+    unsigned int seed = 42;
+    for (int r = 0; r < size; r++) {
+        for (int c = 0; c < size; c++) {
+            unsigned char v;
+            if (strcmp(image, "uniform") == 0) {
+                v = 128;
+            } else if (strcmp(image, "checker") == 0) {
+                v = ((r / 8) + (c / 8)) % 2 ? 255 : 0;
+            } else if (strcmp(image, "gradient") == 0) {
+                v = (unsigned char) (((long) (r + c) * 255) / (2 * size - 2 > 0 ? 2 * size - 2 : 1));
+            } else if (strcmp(image, "noise") == 0) {
+                seed = seed * 1103515245 + 12345;
+                v = (unsigned char) (seed >> 16);
+            } else {
+                return -1;
+            }
+            raster_data[(size_t) r * size + c] = v;
+        }
+    }
+    return 0;
+}
+
+static void report(const char *image, int size, const char *op, double seconds, int nodes, const char *status) {
+    double mpix = (double) size * size / 1e6;
+    printf("{\"bench\":\"birp\",\"image\":\"%s\",\"size\":%d,\"op\":\"%s\",\"status\":\"%s\","
+           "\"seconds\":%.6f,\"mpix_per_s\":%.2f,\"nodes\":%d}\n",
+           image, size, op, status, seconds, seconds > 0 ? mpix / seconds : 0.0, nodes);
+    fflush(stdout);
+}
+
+/*
+ * Run all operations on the image currently in raster_data.  Each repetition
+ * starts from an empty node table so that node creation is always measured.
+ */
+static double run_image(const char *image, int size, int repeat, unsigned char *decoded) {
+    double best[7];
+    const char *ops[7] = {
+        "bdd_from_raster", "bdd_to_raster", "bdd_serialize", "bdd_deserialize",
+        "bdd_map", "bdd_rotate", "bdd_zoom"
+    };
+    int nodes[7] = {0};
+    int failed = -1;
+    for (int k = 0; k < 7; k++)
+        best[k] = -1;
+    double t[7];
+    for (int rep = 0; rep < repeat && failed < 0; rep++) {
+        bdd_reset_nodes();
+        double t0 = now();
+        BDD_NODE *root = bdd_from_raster(size, size, raster_data);
+        t[0] = now() - t0;
+        nodes[0] = current_bdd_node_index - BDD_NUM_LEAVES;
+        if (root == NULL) {
+            failed = 0;
+            break;
+        }
+
+        t0 = now();
+        bdd_to_raster(root, size, size, decoded);
+        t[1] = now() - t0;
+
+        char *buf = NULL;
+        size_t len = 0;
+        FILE *mem = open_memstream(&buf, &len);
+        t0 = now();
+        bdd_serialize(root, mem);
+        fflush(mem);
+        t[2] = now() - t0;
+        fclose(mem);
+
+        bdd_reset_nodes();
+        mem = fmemopen(buf, len, "r");
+        t0 = now();
+        root = bdd_deserialize(mem);
+        t[3] = now() - t0;
+        fclose(mem);
+        free(buf);
+        nodes[3] = current_bdd_node_index - BDD_NUM_LEAVES;
+        if (root == NULL) {
+            failed = 3;
+            break;
+        }
+
+        int level = bdd_min_level(size, size);
+        BDD_NODE *mapped, *rotated, *zoomed;
+        int before = current_bdd_node_index;
+        t0 = now();
+        mapped = bdd_map(root, complement_pixel);
+        t[4] = now() - t0;
+        nodes[4] = current_bdd_node_index - before;
+
+        before = current_bdd_node_index;
+        t0 = now();
+        rotated = bdd_rotate(root, level);
+        t[5] = now() - t0;
+        nodes[5] = current_bdd_node_index - before;
+
+        before = current_bdd_node_index;
+        t0 = now();
+        zoomed = bdd_zoom(root, level, 1);
+        t[6] = now() - t0;
+        nodes[6] = current_bdd_node_index - before;
+        if (mapped == NULL || rotated == NULL || zoomed == NULL) {
+            failed = mapped == NULL ? 4 : rotated == NULL ? 5 : 6;
+            break;
+        }
+        for (int k = 0; k < 7; k++)
+            if (best[k] < 0 || t[k] < best[k])
+                best[k] = t[k];
+    }
+    for (int k = 0; k < failed; k++) /* Operations that completed before the failure */
+        if (best[k] < 0 || t[k] < best[k])
+            best[k] = t[k];
+    for (int k = 0; k < 7; k++) {
+        if (failed >= 0 && k >= failed)
+            report(image, size, ops[k], 0, nodes[k], k == failed ? "node_table_full" : "skipped");
+        else
+            report(image, size, ops[k], best[k], nodes[k], "ok");
+    }
+    double total = 0;
+    for (int k = 0; k < 7; k++)
+        total += best[k] > 0 ? best[k] : 0;
+    return total;
+}
+
+int main(int argc, char **argv) {
+    const char *sizes = "1024,4096";
+    const char *images = NULL;
+    const char *dir = "rsrc";
+    int repeat = 1;
+    double budget = 0;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+            sizes = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "-i") == 0) {
+            images = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+            repeat = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-b") == 0) {
+            budget = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+            dir = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-s SIZES] [-i IMAGES] [-r REPEAT] [-b BUDGET] [-d RSRC_DIR]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repeat < 1)
+        repeat = 1;
+    unsigned char *decoded = malloc(RASTER_SIZE_MAX);
+    if (decoded == NULL)
+        return EXIT_FAILURE;
+    printf("{\"bench\":\"layout\",\"node_bytes\":%zu,\"hash_entry_bytes\":%zu,\"bytes_per_node\":%.2f}\n",
+           sizeof(BDD_NODE), sizeof(*bdd_hash_map),
+           (double) (sizeof(BDD_NODE) * BDD_NODES_MAX + sizeof(*bdd_hash_map) * BDD_HASH_SIZE) / BDD_NODES_MAX);
+    int nimages = sizeof(all_images) / sizeof(*all_images) - 1;
+    int *over_budget = calloc(nimages, sizeof(int));
+    for (const char *p = sizes; p != NULL && *p != '\0'; ) {
+        int size = atoi(p);
+        const char *end = strchr(p, ',');
+        p = end ? end + 1 : NULL;
+        if (size <= 0 || size > 8192) {
+            fprintf(stderr, "size %d out of range (1..8192)\n", size);
+            continue;
+        }
+        for (int i = 0; i < nimages; i++) {
+            const char *image = all_images[i];
+            if (images != NULL && !in_list(images, image))
+                continue;
+            if (over_budget[i]) {
+                report(image, size, "all", 0, 0, "over_budget");
+                continue;
+            }
+            if (generate(dir, image, size)) {
+                fprintf(stderr, "could not generate image %s\n", image);
+                continue;
+            }
+            double total = run_image(image, size, repeat, decoded);
+            if (budget > 0 && total > budget)
+                over_budget[i] = 1;
+        }
+    }
+    free(over_budget);
+    free(decoded);
+    return EXIT_SUCCESS;
+}
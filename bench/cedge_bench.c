@@ -0,0 +1,94 @@
+/*
+ * Comparison of bilevel images stored as ordinary BDDs, with leaves 0 and
+ * 255, and as BDDs with complemented edges: the number of nodes of each,
+ * the time to convert between them, and the time to negate the image (-n,
+ * which walks the ordinary BDD, against flipping one bit of an edge).  The
+ * images are those of rsrc, thresholded at 128 as by -t 128.  Results are
+ * printed one JSON object per line on the standard output.
+ *
+ * Usage: cedge_bench [RSRC_DIR] [REPEAT]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "image.h"
+#include "lut.h"
+#include "cedge.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static BDD_NODE *read_bilevel(const char *dir, const char *image, int *wp, int *hp) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s.birp", dir, image);
+    FILE *in = fopen(path, "r");
+    if (in == NULL)
+        return NULL;
+    BDD_NODE *root = img_read_birp(in, wp, hp);
+    fclose(in);
+    if (root == NULL)
+        return NULL;
+    unsigned char lut[BDD_LUT_SIZE];
+    lut_identity(lut);
+    lut_threshold(lut, 128);
+    return bdd_map_lut(root, lut);
+}
+
+int main(int argc, char **argv) {
+    const char *dir = argc > 1 ? argv[1] : "rsrc";
+    int repeat = argc > 2 ? atoi(argv[2]) : 100;
+    if (repeat <= 0) {
+        fprintf(stderr, "usage: %s [RSRC_DIR] [REPEAT]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *images[] = { "checker", "M", "cour25", "stone" };
+    for (int i = 0; i < 4; i++) {
+        bdd_reset_nodes();
+        int w, h;
+        BDD_NODE *root = read_bilevel(dir, images[i], &w, &h);
+        if (root == NULL) {
+            fprintf(stderr, "could not read image %s\n", images[i]);
+            continue;
+        }
+        int nodes = bdd_count_nodes(root, NULL);
+        double t0 = now();
+        int edge = bdd_cedge_from_bdd(root);
+        double from_seconds = now() - t0;
+        if (edge == -1) {
+            fprintf(stderr, "could not convert image %s\n", images[i]);
+            continue;
+        }
+        int cedge_nodes = bdd_cedge_count_nodes(edge);
+        t0 = now();
+        BDD_NODE *back = bdd_cedge_to_bdd(edge);
+        double to_seconds = now() - t0;
+        /* After the first negation its nodes exist, but each one is still looked up again */
+        double map_seconds = 0, not_seconds = 0;
+        int negative = edge;
+        unsigned char lut[BDD_LUT_SIZE];
+        lut_identity(lut);
+        lut_complement(lut);
+        for (int rep = 0; rep < repeat; rep++) {
+            t0 = now();
+            bdd_map_lut(root, lut);
+            map_seconds += now() - t0;
+            t0 = now();
+            negative = bdd_cedge_not(negative);
+            not_seconds += now() - t0;
+        }
+        printf("{\"bench\":\"cedge\",\"image\":\"%s\",\"width\":%d,\"height\":%d,\"status\":\"%s\","
+               "\"nodes\":%d,\"cedge_nodes\":%d,\"ratio\":%.3f,\"from_bdd_seconds\":%.6f,\"to_bdd_seconds\":%.6f,"
+               "\"negate_map_seconds\":%.9f,\"negate_cedge_seconds\":%.9f}\n",
+               images[i], w, h, back == root ? "ok" : "mismatch", nodes, cedge_nodes,
+               (double) cedge_nodes / nodes, from_seconds, to_seconds,
+               map_seconds / repeat, not_seconds / repeat);
+        fflush(stdout);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+/*
+ * Comparison of variable orders (see order.h): for each image, the BDD is
+ * built in each of the four named orders and in the order found by
+ * bdd_order_search, and the number of nodes, the serialized size, the time
+ * to build it and the time to decode it are reported, along with the time
+ * the search took.  The images are the samples of the resource directory
+ * tiled over a square raster.  Results are printed one JSON object per line
+ * on the standard output.
+ *
+ * Usage: order_bench [SIZE] [RSRC_DIR]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "image.h"
+#include "order.h"
+#include "planes.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int tile_sample(const char *dir, const char *name, int size, unsigned char *raster) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.pgm", dir, name);
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return -1;
+    static unsigned char sample[1 << 20];
+    int w, h;
+    int err = img_read_pgm(f, &w, &h, sample, sizeof(sample));
+    fclose(f);
+    if (err)
+        return -1;
+    for (int r = 0; r < size; r++)
+        for (int c = 0; c < size; c++)
+            raster[(size_t) r * size + c] = sample[(r % h) * w + (c % w)];
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int size = argc > 1 ? atoi(argv[1]) : 1024;
+    const char *dir = argc > 2 ? argv[2] : "rsrc";
+    if (size <= 1 || size > 4096) {
+        fprintf(stderr, "usage: %s [SIZE<=4096] [RSRC_DIR]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *images[] = { "M", "checker", "cour25", "stone" };
+    const char *kinds[] = { "interleaved", "columns_first", "row_blocks", "column_blocks", "search" };
+    unsigned char *raster = malloc((size_t) size * size);
+    unsigned char *decoded = malloc((size_t) size * size);
+    if (raster == NULL || decoded == NULL)
+        return EXIT_FAILURE;
+    int level = bdd_min_level(size, size);
+    for (int i = 0; i < 4; i++) {
+        if (tile_sample(dir, images[i], size, raster)) {
+            fprintf(stderr, "could not read image %s\n", images[i]);
+            continue;
+        }
+        for (int kind = BDD_ORDER_INTERLEAVED; kind <= BDD_ORDER_SEARCH; kind++) {
+            double search_seconds = 0;
+            int order;
+            if (kind == BDD_ORDER_SEARCH) {
+                double t0 = now();
+                order = bdd_order_search(size, size, raster, NULL);
+                search_seconds = now() - t0;
+            } else {
+                order = bdd_order_of_kind(kind, level);
+            }
+            bdd_reset_nodes();
+            double t0 = now();
+            BDD_NODE *root = order == -1 ? NULL : bdd_from_raster_ordered(size, size, raster, order);
+            double build_seconds = now() - t0;
+            if (root == NULL) {
+                printf("{\"bench\":\"order\",\"image\":\"%s\",\"size\":%d,\"order\":\"%s\",\"status\":\"failed\"}\n",
+                       images[i], size, kinds[kind]);
+                continue;
+            }
+            int nodes = current_bdd_node_index - BDD_NUM_LEAVES;
+            long bytes = bdd_serialized_size(root);
+            t0 = now();
+            bdd_to_raster_ordered(root, size, size, decoded, order);
+            double decode_seconds = now() - t0;
+            printf("{\"bench\":\"order\",\"image\":\"%s\",\"size\":%d,\"order\":\"%s\",\"status\":\"ok\","
+                   "\"nodes\":%d,\"bytes\":%ld,\"build_seconds\":%.6f,\"decode_seconds\":%.6f,"
+                   "\"search_seconds\":%.6f}\n",
+                   images[i], size, kinds[kind], nodes, bytes, build_seconds, decode_seconds, search_seconds);
+            fflush(stdout);
+        }
+    }
+    free(raster);
+    free(decoded);
+    return EXIT_SUCCESS;
+}
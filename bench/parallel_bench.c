@@ -0,0 +1,143 @@
+/*
+ * Benchmark of the operations on a single large image that are split across
+ * threads, against the number of threads.  For each size, a "noisy" image is
+ * made of a smooth gradient with random-noise tiles scattered over it, with
+ * as many noise pixels as the node table can hold, so that the BDD is large
+ * and irregular.  The BDD is then built, decoded back into a raster and
+ * serialized, with 1, 2, 4, ... up to MAX_THREADS threads, checking that the
+ * results do not depend on the number of threads.  Results are printed one
+ * JSON object per line on the standard output, with the speedup over one
+ * thread.
+ *
+ * Usage: parallel_bench [-s SIZES] [-t MAX_THREADS] [-r REPEAT]
+ *   SIZES        comma-separated edge lengths (default 4096,8192; at most 8192)
+ *   MAX_THREADS  largest number of threads (default: the number of online CPUs)
+ *   REPEAT       runs per thread count; the fastest is reported (default 1)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "pool.h"
+
+#define TILE 64
+#define NOISE_PIXELS (1 << 19)  /* About a third of the node table once built */
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* A gradient with about NOISE_PIXELS pixels of noise, in TILE x TILE tiles picked at random. */
+static void make_noisy(unsigned char *raster, int size) {
+    unsigned int tiles = (unsigned int) (size / TILE) * (size / TILE);
+    unsigned int noisy = NOISE_PIXELS / (TILE * TILE);
+    unsigned int seed = 1234;
+    for (int r = 0; r < size; r++) {
+        for (int c = 0; c < size; c++) {
+            unsigned int tile = (unsigned int) (r / TILE) * (size / TILE) + c / TILE;
+            seed = seed * 1103515245 + 12345;
+            int noise = (tile * 2654435761u) % tiles < noisy;
+            raster[(size_t) r * size + c] = noise ? (unsigned char) (seed >> 16) : (unsigned char) ((r + c) * 255 / (2 * size));
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    char *sizes = "4096,8192";
+    int max_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int repeat = 1;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+            sizes = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+            max_threads = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+            repeat = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-s SIZES] [-t MAX_THREADS] [-r REPEAT]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (max_threads <= 0 || repeat <= 0)
+        return EXIT_FAILURE;
+
+    for (char *p = sizes; p != NULL && *p != '\0'; ) {
+        int size = atoi(p);
+        p = strchr(p, ',');
+        p = p != NULL ? p + 1 : NULL;
+        if (size < TILE || size > 8192)
+            continue;
+        unsigned char *raster = malloc((size_t) size * size);
+        if (raster == NULL)
+            return EXIT_FAILURE;
+        make_noisy(raster, size);
+
+        unsigned char *decoded = malloc((size_t) size * size);
+        if (decoded == NULL)
+            return EXIT_FAILURE;
+        char *serial1 = NULL;
+        size_t serial1_size = 0;
+        for (int op = 0; op < 3; op++) {
+            double base = 0;
+            for (int threads = 1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+                pool_set_threads(threads);
+                double best = -1;
+                BDD_NODE *root = NULL;
+                char *serial = NULL;
+                size_t serial_size = 0;
+                for (int rep = 0; rep < repeat; rep++) {
+                    if (op == 0 || root == NULL) {
+                        bdd_reset_nodes();
+                        root = op == 0 ? NULL : bdd_from_raster(size, size, raster);
+                    }
+                    free(serial);
+                    FILE *out = open_memstream(&serial, &serial_size);
+                    double start = now();
+                    if (op == 0) {
+                        root = bdd_from_raster(size, size, raster);
+                    } else if (op == 1 && root != NULL) {
+                        bdd_to_raster(root, size, size, decoded);
+                    } else if (root != NULL) {
+                        bdd_serialize(root, out);
+                        fflush(out);
+                    }
+                    double seconds = now() - start;
+                    fclose(out);
+                    if (best < 0 || seconds < best)
+                        best = seconds;
+                }
+                int ok = root != NULL;
+                if (op == 1)
+                    ok = ok && memcmp(raster, decoded, (size_t) size * size) == 0;
+                if (op == 2 && threads == 1) {
+                    serial1 = serial;
+                    serial1_size = serial_size;
+                    serial = NULL;
+                } else if (op == 2) {
+                    ok = ok && serial_size == serial1_size && memcmp(serial, serial1, serial_size) == 0;
+                }
+                free(serial);
+                if (threads == 1)
+                    base = best;
+                static const char *ops[] = { "bdd_from_raster", "bdd_to_raster", "bdd_serialize" };
+                printf("{\"bench\":\"parallel\",\"image\":\"noisy\",\"size\":%d,\"op\":\"%s\","
+                       "\"threads\":%d,\"status\":\"%s\",\"seconds\":%.6f,\"mpix_per_s\":%.2f,\"nodes\":%d,"
+                       "\"speedup\":%.2f}\n", size, ops[op], threads, ok ? "ok" : "failed", best,
+                       (double) size * size / best / 1e6, current_bdd_node_index - BDD_NUM_LEAVES, base / best);
+                fflush(stdout);
+                if (threads == max_threads)
+                    break;
+            }
+        }
+        free(serial1);
+        free(decoded);
+        free(raster);
+    }
+    return EXIT_SUCCESS;
+}
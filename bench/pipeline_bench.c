@@ -0,0 +1,156 @@
+/*
+ * Benchmark of end-to-end latency of conversions from a slow pipe, with and
+ * without --pipeline.  A noisy image (a gradient with random-noise tiles) is
+ * fed through a pipe by a child process at a limited rate, and converted
+ * from PGM to birp and from birp back to PGM, with the output discarded.
+ * The time is measured from the start of the transfer to the end of the
+ * conversion, so it includes the time spent waiting for the input.  Results
+ * are printed one JSON object per line on the standard output.
+ *
+ * Usage: pipeline_bench [-s SIZE] [-m MB_PER_S] [-r REPEAT]
+ *   SIZE      edge length of the image (default 4096; at most 8192)
+ *   MB_PER_S  rate at which the pipe is fed (default 64)
+ *   REPEAT    runs per conversion; the fastest is reported (default 1)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "birp2.h"
+#include "image.h"
+
+#define TILE 64
+#define NOISE_PIXELS (1 << 19)
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void make_noisy(unsigned char *raster, int size) {
+    unsigned int tiles = (unsigned int) (size / TILE) * (size / TILE);
+    unsigned int noisy = NOISE_PIXELS / (TILE * TILE);
+    unsigned int seed = 1234;
+    for (int r = 0; r < size; r++) {
+        for (int c = 0; c < size; c++) {
+            unsigned int tile = (unsigned int) (r / TILE) * (size / TILE) + c / TILE;
+            seed = seed * 1103515245 + 12345;
+            int noise = (tile * 2654435761u) % tiles < noisy;
+            raster[(size_t) r * size + c] = noise ? (unsigned char) (seed >> 16) : (unsigned char) ((r + c) * 255 / (2 * size));
+        }
+    }
+}
+
+/* Write data to fd at about rate bytes per second, in 64 KB chunks. */
+static void feed(int fd, const char *data, size_t size, double rate) {
+    double start = now();
+    for (size_t done = 0; done < size; ) {
+        size_t chunk = size - done < 65536 ? size - done : 65536;
+        ssize_t count = write(fd, data + done, chunk);
+        if (count <= 0)
+            break;
+        done += count;
+        double ahead = start + done / rate - now();
+        if (ahead > 0) {
+            struct timespec ts = { (time_t) ahead, (long) ((ahead - (time_t) ahead) * 1e9) };
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+
+/* Run a conversion with its input fed from a slow pipe; returns the seconds taken, or -1. */
+static double run(int (*convert)(FILE *, FILE *), const char *data, size_t size, double rate, int options) {
+    int fds[2];
+    if (pipe(fds) == -1)
+        return -1;
+    double start = now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        feed(fds[1], data, size, rate);
+        _exit(0);
+    }
+    close(fds[1]);
+    FILE *in = fdopen(fds[0], "r");
+    FILE *out = fopen("/dev/null", "w");
+    bdd_reset_nodes();
+    global_options = options;
+    int status = convert(in, out);
+    fclose(in);
+    fclose(out);
+    waitpid(pid, NULL, 0);
+    return status == 0 ? now() - start : -1;
+}
+
+int main(int argc, char **argv) {
+    int size = 4096;
+    double mb_per_s = 64;
+    int repeat = 1;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+            size = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-m") == 0) {
+            mb_per_s = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+            repeat = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-s SIZE] [-m MB_PER_S] [-r REPEAT]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (size < TILE || size > 8192 || mb_per_s <= 0 || repeat <= 0)
+        return EXIT_FAILURE;
+
+    /* The two inputs, as they would arrive on the pipe */
+    unsigned char *raster = malloc((size_t) size * size);
+    if (raster == NULL)
+        return EXIT_FAILURE;
+    make_noisy(raster, size);
+    char *pgm = NULL, *birp = NULL;
+    size_t pgm_size = 0, birp_size = 0;
+    FILE *f = open_memstream(&pgm, &pgm_size);
+    img_write_pgm(raster, size, size, f);
+    fclose(f);
+    f = open_memstream(&birp, &birp_size);
+    BDD_NODE *root = bdd_from_raster(size, size, raster);
+    if (root == NULL)
+        return EXIT_FAILURE;
+    img_write_birp(root, size, size, f);
+    fclose(f);
+    free(raster);
+
+    struct { const char *name; int (*convert)(FILE *, FILE *); const char *input; size_t input_size; int options; } runs[] = {
+        { "pgm_to_birp", pgm_to_birp, pgm, pgm_size, 0x21 },
+        { "birp_to_pgm", birp_to_pgm, birp, birp_size, 0x12 },
+    };
+    double rate = mb_per_s * 1e6;
+    for (int i = 0; i < 2; i++) {
+        double base = 0;
+        for (int pipelined = 0; pipelined < 2; pipelined++) {
+            double best = -1;
+            for (int rep = 0; rep < repeat; rep++) {
+                double seconds = run(runs[i].convert, runs[i].input, runs[i].input_size, rate,
+                                     runs[i].options | (pipelined ? PIPELINE_OPTION : 0));
+                if (seconds >= 0 && (best < 0 || seconds < best))
+                    best = seconds;
+            }
+            if (!pipelined)
+                base = best;
+            printf("{\"bench\":\"pipeline\",\"image\":\"noisy\",\"size\":%d,\"op\":\"%s\",\"pipelined\":%s,"
+                   "\"input_bytes\":%zu,\"feed_mb_per_s\":%.1f,\"feed_seconds\":%.6f,\"status\":\"%s\","
+                   "\"seconds\":%.6f,\"speedup\":%.2f}\n", size, runs[i].name, pipelined ? "true" : "false",
+                   runs[i].input_size, mb_per_s, runs[i].input_size / rate, best >= 0 ? "ok" : "failed",
+                   best, base / best);
+            fflush(stdout);
+        }
+    }
+    free(pgm);
+    free(birp);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+/*
+ * Comparison of the encodings of birp output (see planes.h): one BDD with a
+ * leaf per pixel value, bit planes, and bit planes of Gray codes.  For each
+ * image, each encoding is written to memory and read back (recombining the
+ * planes), and its size, the time to encode it (from the BDD) and the time
+ * to decode it (to a BDD) are reported.  The images are stone from the
+ * resource directory, and synthetic ones: a diagonal gradient, the same
+ * gradient with noise of +-2 grey levels, and a smooth field of waves.
+ * Results are printed one JSON object per line on the standard output.
+ *
+ * Usage: planes_bench [SIZE] [RSRC_DIR]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "image.h"
+#include "planes.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int generate(const char *dir, const char *image, int size, unsigned char *raster) {
+    if (strcmp(image, "stone") == 0) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/stone.pgm", dir);
+        FILE *f = fopen(path, "r");
+        if (f == NULL)
+            return -1;
+        static unsigned char sample[1 << 20];
+        int w, h;
+        int err = img_read_pgm(f, &w, &h, sample, sizeof(sample));
+        fclose(f);
+        if (err)
+            return -1;
+        for (int r = 0; r < size; r++)
+            for (int c = 0; c < size; c++)
+                raster[(size_t) r * size + c] = sample[(r % h) * w + (c % w)];
+        return 0;
+    }
+    unsigned int seed = 42;
+    for (int r = 0; r < size; r++) {
+        for (int c = 0; c < size; c++) {
+            int v = (int) (((long) (r + c) * 255) / (2 * size - 2));
+            if (strcmp(image, "noisy_gradient") == 0) {
+                seed = seed * 1103515245 + 12345;
+                v += (int) ((seed >> 16) % 5) - 2;
+            } else if (strcmp(image, "waves") == 0) {
+                v = (int) (128 + 60 * sin(r * 0.05) + 60 * cos(c * 0.031 + r * 0.01));
+            }
+            raster[(size_t) r * size + c] = v < 0 ? 0 : v > 255 ? 255 : v;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int size = argc > 1 ? atoi(argv[1]) : 512;
+    const char *dir = argc > 2 ? argv[2] : "rsrc";
+    if (size <= 1 || size > 4096) {
+        fprintf(stderr, "usage: %s [SIZE<=4096] [RSRC_DIR]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *images[] = { "stone", "gradient", "noisy_gradient", "waves" };
+    const char *encodings[] = { "nodes", "planes", "gray" };
+    unsigned char *raster = malloc((size_t) size * size);
+    if (raster == NULL)
+        return EXIT_FAILURE;
+    for (int i = 0; i < 4; i++) {
+        if (generate(dir, images[i], size, raster)) {
+            fprintf(stderr, "could not generate image %s\n", images[i]);
+            continue;
+        }
+        for (int encoding = BDD_ENCODING_NODES; encoding <= BDD_ENCODING_GRAY; encoding++) {
+            bdd_reset_nodes();
+            BDD_NODE *root = bdd_from_raster(size, size, raster);
+            if (root == NULL) {
+                printf("{\"bench\":\"planes\",\"image\":\"%s\",\"size\":%d,\"encoding\":\"%s\","
+                       "\"status\":\"node_table_full\"}\n", images[i], size, encodings[encoding]);
+                continue;
+            }
+            char *buf = NULL;
+            size_t len = 0;
+            FILE *mem = open_memstream(&buf, &len);
+            double t0 = now();
+            int written = img_write_birp_encoded(root, size, size, encoding, mem, NULL);
+            double encode_seconds = now() - t0;
+            fclose(mem);
+            /* Decode into a fresh table, as a reader would */
+            bdd_reset_nodes();
+            mem = fmemopen(buf, len, "r");
+            int w, h;
+            t0 = now();
+            BDD_NODE *decoded = written == -1 ? NULL : img_read_birp(mem, &w, &h);
+            double decode_seconds = now() - t0;
+            fclose(mem);
+            free(buf);
+            const char *status = decoded == NULL ? "failed" : "ok";
+            printf("{\"bench\":\"planes\",\"image\":\"%s\",\"size\":%d,\"encoding\":\"%s\",\"status\":\"%s\","
+                   "\"bytes\":%zu,\"raw_bytes\":%zu,\"encode_seconds\":%.6f,\"decode_seconds\":%.6f}\n",
+                   images[i], size, encodings[encoding], status, len, (size_t) size * size,
+                   encode_seconds, decode_seconds);
+            fflush(stdout);
+        }
+    }
+    free(raster);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/*
+ * Comparison of the quadtree engine (see quad.h) with the binary BDD
+ * engine: for each image, the time to build it from a raster, decode it,
+ * rotate it 90 degrees and serialize it (to /dev/null) with each engine,
+ * along with the number of nodes and the bytes they take, and the time to
+ * convert between the two.  Both engines run on one thread, since only the
+ * binary one has parallel paths.  The images are the samples of the
+ * resource directory tiled over a square raster; each operation is timed on
+ * a fresh node table and the fastest of REPEAT runs is reported.  Results
+ * are printed one JSON object per line on the standard output.
+ *
+ * Usage: quad_bench [SIZE] [REPEAT] [RSRC_DIR]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "image.h"
+#include "pool.h"
+#include "quad.h"
+
+#define OPS 4
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int tile_sample(const char *dir, const char *name, int size, unsigned char *raster) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s.pgm", dir, name);
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return -1;
+    static unsigned char sample[1 << 20];
+    int w, h;
+    int err = img_read_pgm(f, &w, &h, sample, sizeof(sample));
+    fclose(f);
+    if (err)
+        return -1;
+    for (int r = 0; r < size; r++)
+        for (int c = 0; c < size; c++)
+            raster[(size_t) r * size + c] = sample[(r % h) * w + (c % w)];
+    return 0;
+}
+
+static void keep_best(double *best, double seconds) {
+    if (*best < 0 || seconds < *best)
+        *best = seconds;
+}
+
+int main(int argc, char **argv) {
+    int size = argc > 1 ? atoi(argv[1]) : 1024;
+    int repeat = argc > 2 ? atoi(argv[2]) : 3;
+    const char *dir = argc > 3 ? argv[3] : "rsrc";
+    if (size <= 1 || size > 4096 || repeat <= 0) {
+        fprintf(stderr, "usage: %s [SIZE<=4096] [REPEAT] [RSRC_DIR]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *images[] = { "M", "checker", "cour25", "stone" };
+    const char *ops[OPS] = { "build", "decode", "rotate", "serialize" };
+    unsigned char *raster = malloc((size_t) size * size);
+    unsigned char *decoded = malloc((size_t) size * size);
+    FILE *null = fopen("/dev/null", "w");
+    if (raster == NULL || decoded == NULL || null == NULL)
+        return EXIT_FAILURE;
+    pool_set_threads(1);
+    for (int i = 0; i < 4; i++) {
+        if (tile_sample(dir, images[i], size, raster)) {
+            fprintf(stderr, "could not read image %s\n", images[i]);
+            continue;
+        }
+        double binary[OPS] = { -1, -1, -1, -1 }, quadtree[OPS] = { -1, -1, -1, -1 };
+        double to_quad = -1, to_binary = -1;
+        int binary_nodes = 0, quad_nodes = 0, ok = 1;
+        for (int rep = 0; rep < repeat && ok; rep++) {
+            bdd_reset_nodes();
+            double t0 = now();
+            BDD_NODE *root = bdd_from_raster(size, size, raster);
+            keep_best(&binary[0], now() - t0);
+            t0 = now();
+            int quad = bdd_quad_from_raster(size, size, raster);
+            keep_best(&quadtree[0], now() - t0);
+            if (root == NULL || quad == -1) {
+                ok = 0;
+                break;
+            }
+            binary_nodes = bdd_count_nodes(root, NULL);
+            quad_nodes = bdd_quad_count_nodes(quad);
+            t0 = now();
+            bdd_to_raster(root, size, size, decoded);
+            keep_best(&binary[1], now() - t0);
+            t0 = now();
+            bdd_quad_to_raster(quad, size, size, decoded);
+            keep_best(&quadtree[1], now() - t0);
+            t0 = now();
+            bdd_serialize(root, null);
+            keep_best(&binary[3], now() - t0);
+            t0 = now();
+            bdd_quad_serialize(quad, null);
+            keep_best(&quadtree[3], now() - t0);
+            t0 = now();
+            ok = bdd_rotate(root, root->level) != NULL;
+            keep_best(&binary[2], now() - t0);
+            t0 = now();
+            ok = ok && bdd_quad_rotate(quad) != -1;
+            keep_best(&quadtree[2], now() - t0);
+            /* Conversions, each into a table that does not yet hold the result */
+            bdd_reset_nodes();
+            root = bdd_from_raster(size, size, raster);
+            t0 = now();
+            quad = bdd_quad_from_bdd(root);
+            keep_best(&to_quad, now() - t0);
+            bdd_reset_nodes();
+            quad = bdd_quad_from_raster(size, size, raster);
+            t0 = now();
+            ok = ok && quad != -1 && bdd_quad_to_bdd(quad) != NULL;
+            keep_best(&to_binary, now() - t0);
+        }
+        if (!ok) {
+            printf("{\"bench\":\"quad\",\"image\":\"%s\",\"size\":%d,\"status\":\"failed\"}\n", images[i], size);
+            continue;
+        }
+        for (int op = 0; op < OPS; op++) {
+            printf("{\"bench\":\"quad\",\"image\":\"%s\",\"size\":%d,\"op\":\"%s\",\"status\":\"ok\","
+                   "\"binary_seconds\":%.6f,\"quad_seconds\":%.6f,\"speedup\":%.2f}\n",
+                   images[i], size, ops[op], binary[op], quadtree[op], binary[op] / quadtree[op]);
+        }
+        printf("{\"bench\":\"quad\",\"image\":\"%s\",\"size\":%d,\"op\":\"convert\",\"status\":\"ok\","
+               "\"binary_nodes\":%d,\"binary_bytes\":%zu,\"quad_nodes\":%d,\"quad_bytes\":%zu,"
+               "\"to_quad_seconds\":%.6f,\"to_binary_seconds\":%.6f}\n",
+               images[i], size, binary_nodes, binary_nodes * sizeof(BDD_NODE), quad_nodes,
+               quad_nodes * sizeof(QUAD_NODE), to_quad, to_binary);
+        fflush(stdout);
+    }
+    fclose(null);
+    free(raster);
+    free(decoded);
+    return EXIT_SUCCESS;
+}
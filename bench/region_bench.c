@@ -0,0 +1,124 @@
+/*
+ * Benchmark of rectangle-sum queries answered from the BDD (bdd_region_sum)
+ * against a baseline that decodes the raster once and sums pixels directly,
+ * and of small rectangles painted into the BDD one at a time (bdd_fill_rect)
+ * against decoding, painting the raster and rebuilding the BDD.
+ * Results are printed one JSON object per line on the standard output.
+ *
+ * Usage: region_bench [SIZE] [QUERIES]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "const.h"
+#include "region.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv) {
+    int size = argc > 1 ? atoi(argv[1]) : 1024;
+    int nqueries = argc > 2 ? atoi(argv[2]) : 10000;
+    if (size <= 0 || size > 8192 || nqueries <= 0) {
+        fprintf(stderr, "usage: %s [SIZE<=8192] [QUERIES]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (raster_reserve((size_t) size * size) == NULL)
+        return EXIT_FAILURE;
+    /* Smooth gradient with flat blocks: a typical mix of shared and unshared subtrees. */
+    for (int r = 0; r < size; r++) {
+        for (int c = 0; c < size; c++) {
+            int flat = ((r / 64) + (c / 64)) % 3 == 0;
+            raster_data[r * size + c] = flat ? 128 : (unsigned char) ((r + c) / 16);
+        }
+    }
+    BDD_NODE *root = bdd_from_raster(size, size, raster_data);
+    if (root == NULL) {
+        fprintf(stderr, "bdd_from_raster failed\n");
+        return EXIT_FAILURE;
+    }
+
+    int *q = malloc(4 * sizeof(int) * nqueries);
+    unsigned char *decoded = malloc((size_t) size * size);
+    if (q == NULL || decoded == NULL)
+        return EXIT_FAILURE;
+    srand(1);
+    for (int i = 0; i < nqueries; i++) {
+        q[4 * i] = rand() % size;
+        q[4 * i + 1] = rand() % size;
+        q[4 * i + 2] = 1 + rand() % (size / 4 + 1);
+        q[4 * i + 3] = 1 + rand() % (size / 4 + 1);
+    }
+
+    double t0 = now();
+    long long check_bdd = 0;
+    for (int i = 0; i < nqueries; i++)
+        check_bdd += bdd_region_sum(root, size, size, q[4 * i], q[4 * i + 1], q[4 * i + 2], q[4 * i + 3], NULL);
+    double t_bdd = now() - t0;
+
+    t0 = now();
+    bdd_to_raster(root, size, size, decoded);
+    double t_decode = now() - t0;
+    t0 = now();
+    long long check_raster = 0;
+    for (int i = 0; i < nqueries; i++) {
+        int r1 = q[4 * i] + q[4 * i + 2] < size ? q[4 * i] + q[4 * i + 2] : size;
+        int c1 = q[4 * i + 1] + q[4 * i + 3] < size ? q[4 * i + 1] + q[4 * i + 3] : size;
+        for (int r = q[4 * i]; r < r1; r++)
+            for (int c = q[4 * i + 1]; c < c1; c++)
+                check_raster += decoded[r * size + c];
+    }
+    double t_raster = now() - t0;
+
+    if (check_bdd != check_raster) {
+        fprintf(stderr, "mismatch: bdd %lld raster %lld\n", check_bdd, check_raster);
+        return EXIT_FAILURE;
+    }
+    printf("{\"bench\":\"region_sum\",\"impl\":\"bdd\",\"size\":%d,\"queries\":%d,"
+           "\"seconds\":%.6f,\"qps\":%.1f}\n", size, nqueries, t_bdd, nqueries / t_bdd);
+    printf("{\"bench\":\"region_sum\",\"impl\":\"raster\",\"size\":%d,\"queries\":%d,"
+           "\"seconds\":%.6f,\"decode_seconds\":%.6f,\"qps\":%.1f}\n",
+           size, nqueries, t_raster, t_decode, nqueries / t_raster);
+
+    /* Paint small rectangles, as when annotating or redacting a stored image */
+    int nedits = nqueries < 1000 ? nqueries : 1000;
+    for (int i = 0; i < nedits; i++) {
+        q[4 * i + 2] = 1 + q[4 * i + 2] % 16;
+        q[4 * i + 3] = 1 + q[4 * i + 3] % 16;
+    }
+    t0 = now();
+    BDD_NODE *painted = root;
+    for (int i = 0; i < nedits && painted != NULL; i++)
+        painted = bdd_fill_rect(painted, size, size, q[4 * i], q[4 * i + 1], q[4 * i + 2], q[4 * i + 3],
+                                (unsigned char) i);
+    double t_paint = now() - t0;
+
+    t0 = now();
+    bdd_to_raster(root, size, size, decoded);
+    for (int i = 0; i < nedits; i++) {
+        int r1 = q[4 * i] + q[4 * i + 2] < size ? q[4 * i] + q[4 * i + 2] : size;
+        int c1 = q[4 * i + 1] + q[4 * i + 3] < size ? q[4 * i + 1] + q[4 * i + 3] : size;
+        for (int r = q[4 * i]; r < r1; r++)
+            for (int c = q[4 * i + 1]; c < c1; c++)
+                decoded[r * size + c] = (unsigned char) i;
+    }
+    BDD_NODE *rebuilt = bdd_from_raster(size, size, decoded);
+    double t_rebuild = now() - t0;
+
+    if (painted == NULL || painted != rebuilt) {
+        fprintf(stderr, "mismatch: painted and rebuilt images differ\n");
+        return EXIT_FAILURE;
+    }
+    printf("{\"bench\":\"paint\",\"impl\":\"bdd\",\"size\":%d,\"edits\":%d,"
+           "\"seconds\":%.6f,\"eps\":%.1f}\n", size, nedits, t_paint, nedits / t_paint);
+    printf("{\"bench\":\"paint\",\"impl\":\"raster\",\"size\":%d,\"edits\":%d,"
+           "\"seconds\":%.6f,\"eps\":%.1f}\n", size, nedits, t_rebuild, nedits / t_rebuild);
+    free(q);
+    free(decoded);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,50 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+/* Most worker threads accepted by -j. */
+#define BATCH_JOBS_MAX 256
+
+/* Set by validargs from -d DIR, -j N and the input files that follow the options. */
+extern char *batch_output_dir;
+extern char **batch_inputs;
+extern int batch_input_count;
+extern int batch_jobs;
+
+/**
+ * Convert a number of files in one run, performing on each the conversion,
+ * transformation or query selected by global_options, as birp_convert does
+ * for the standard input.  Each input is either a file or a directory, in
+ * which case the files in it whose names end in the input format's extension
+ * (".pgm" or ".birp") are converted, in name order.  The result for each file
+ * is written to the output directory, which is created if necessary, under
+ * the input's name with the extension of the output format (".pgm", ".birp",
+ * ".asc", or ".txt" for queries).
+ *
+ * The node table is kept from one file to the next, so that subtrees common
+ * to several images (identical tiles, or unchanged regions of successive
+ * frames) are only built once.  If the table fills up, it is emptied and the
+ * file is converted again.
+ *
+ * With more than one job, the files are converted concurrently by a pool of
+ * worker threads, each with its own context (and so its own node table).
+ * Files are dealt out to the workers in turn, and a worker that runs out
+ * steals files queued for another, so that a few very large images do not
+ * hold up the rest.
+ *
+ * For each file a line is written to the log giving its status, the time
+ * taken, the number of nodes it added and the size of the table, and a
+ * summary line follows the last file.  The lines are in the order of the
+ * files whatever the number of jobs.
+ *
+ * @param inputs  The names of the input files and directories.
+ * @param count  The number of names in inputs.
+ * @param output_dir  The directory into which to write the results.
+ * @param jobs  The number of files to convert at once.
+ * @param log  The stream to which to write the per-file report.
+ * @return  0 if every file was converted successfully, -1 otherwise.
+ */
+int birp_batch(char **inputs, int count, char *output_dir, int jobs, FILE *log);
+
+#endif
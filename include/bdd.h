@@ -9,13 +9,21 @@
 
 /*
  * Definition of BDD node structure type.
+ * Node indices are less than BDD_NODES_MAX (2^20), so the level is packed
+ * into the spare high bits of the left child index, making a node 8 bytes
+ * rather than 12.  Fields are accessed as before, e.g. node->level.
  */
 typedef struct bdd_node {
-    char level;
-    int left;
+    unsigned int level : 7;
+    unsigned int left : 25;
     int right;
 } BDD_NODE;
 
+/*
+ * The tables below live in the current context; see context.h.
+ */
+#include "context.h"
+
 /*
  * Each BDD node represents a function on some number of boolean arguments.
  * We refer to the number of arguments as the "level" of the node.
@@ -42,20 +50,32 @@ typedef struct bdd_node {
  * to leaf nodes, which are not stored explicitly, but whose values are given
  * by their indices.  So the first entry that can actually be used to store
  * a non-leaf node is at index BDD_NUM_LEAVES.
+ *
+ * Address space for BDD_NODES_MAX nodes is reserved on first use, but memory
+ * is only committed as nodes are inserted, so BDD_NODE pointers stay valid
+ * while small images use little memory.  The array is NULL until the first
+ * BDD is built or deserialized.
  */
 #define BDD_NODES_MAX (1<<20) // 1048576
-BDD_NODE bdd_nodes[BDD_NODES_MAX];
+#define bdd_nodes (birp_context -> nodes)
 
 /*
  * Open-addressed hash map mapping pairs (l, r) of BDD node indices
  * to BDD node indices.  Each node can be present at most once, so
  * there will be at most BDD_NODES_MAX entries in the table.
- * We define the table size to yield a load factor of no more than 0.5;
- * in particular the table will never be full.  So the table size must
- * be a prime number >= 2 * BDD_NODES_MAX.
+ * The table starts small and doubles, rehashing, whenever its load factor
+ * would exceed 0.5; in particular the table will never be full.  Its size,
+ * bdd_hash_size, is a power of two so that slots can be found by masking
+ * the hash rather than by division, and at most BDD_HASH_SIZE.
+ *
+ * Each entry is 32 bits: the index of the node in its low 20 bits, and
+ * a fingerprint of the node's hash in its high 12 bits, so that most
+ * non-matching entries are rejected without touching the node itself.
+ * An entry of 0 (a leaf index, which is never stored) marks an empty slot.
  */
-#define BDD_HASH_SIZE 2097169
-BDD_NODE *bdd_hash_map[BDD_HASH_SIZE];
+#define BDD_HASH_SIZE (1<<21) // 2097152
+#define bdd_hash_map (birp_context -> hash_map)
+#define bdd_hash_size (birp_context -> hash_size)
 
 /*
  * Map used in BDD serialization and deserialization.
@@ -65,8 +85,10 @@ BDD_NODE *bdd_hash_map[BDD_HASH_SIZE];
  * In deserialization, it is used to store the mapping from serial numbers
  * of BDD nodes in the input stream, to the indices of these nodes in the
  * BDD node table.
+ * It is allocated on demand and grown to cover the entries in use, which
+ * are cleared before each use by clear_bdd_index_map.
  */
-int bdd_index_map[BDD_NODES_MAX];
+#define bdd_index_map (birp_context -> index_map)
 
 /**
  * Determine the minimum number of levels required to cover a raster
@@ -157,7 +179,9 @@ BDD_NODE *bdd_deserialize(FILE *in);
  * to each entry of the array.  In general, this will require building
  * a new BDD, because the function need not be one-to-one and in that
  * case nodes that were distinct in the original BDD could map to the
- * same node in the new BDD.
+ * same node in the new BDD.  The function is called once for each of
+ * the 256 values, and the BDD is then mapped through the resulting table
+ * by bdd_map_lut (see lut.h).
  *
  * @param node  The BDD node that represents the input array.
  * @param func  The function to be applied to each entry.
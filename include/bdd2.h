@@ -2,29 +2,159 @@
 #ifndef BDD2_H
 #define BDD2_H
 
-int hash_function(int level, int left, int right);
-int insert_node(BDD_NODE node, int index, BDD_NODE *nodes_table, BDD_NODE **hash_map);
-int probe_from(int index, BDD_NODE **hash_map, BDD_NODE node);
+#include "pool.h"
+
+/*
+ * Macros that take a pointer to a BDD node and obtain pointers to its left
+ * and right child nodes, taking into account the fact that a node N at level l
+ * also implicitly represents nodes at levels l' > l whose left and right children
+ * are equal (to N).
+ *
+ * You might find it useful to define macros to do other commonly occurring things;
+ * such as converting between BDD node pointers and indices in the BDD node table.
+ */
+#define LEFT(np, l) ((l) > (np)->level ? (np) : bdd_nodes + (np)->left)
+#define RIGHT(np, l) ((l) > (np)->level ? (np) : bdd_nodes + (np)->right)
+
+/*
+ * Number of rows and columns covered by a node interpreted at level l:
+ * even levels cover squares, odd levels cover rectangles twice as wide as tall.
+ */
+#define LEVEL_ROWS(l) (1 << ((l) / 2))
+#define LEVEL_COLS(l) (1 << (((l) + 1) / 2))
+
+/*
+ * Sizes in which the node store and the maps that parallel it start out;
+ * all of them grow on demand up to BDD_NODES_MAX entries.
+ */
+#define BDD_NODES_INITIAL 4096
+#define BDD_HASH_INITIAL (1 << 13)
+
+#define current_bdd_node_index (birp_context -> current_node_index)
+#define bdd_nodes_committed (birp_context -> nodes_committed)  // Entries of bdd_nodes backed by memory.
+#define bdd_index_map_size (birp_context -> index_map_size)  // Entries allocated in bdd_index_map.
+
+/*
+ * Layout of bdd_hash_map entries: node index in the low bits, fingerprint
+ * (the top bits of the node's hash) in the remaining high bits.
+ */
+#define BDD_HASH_INDEX_BITS 20
+#define BDD_HASH_INDEX_MASK ((1u << BDD_HASH_INDEX_BITS) - 1)
+#define BDD_HASH_FINGERPRINT(hash) ((hash) & ~BDD_HASH_INDEX_MASK)
+
+/*
+ * Value claiming an empty slot of bdd_hash_map while a node is being added
+ * to it by bdd_lookup_concurrent.  Index 1 is a leaf, which is never stored
+ * in the map, so this is never a real entry.
+ */
+#define BDD_HASH_BUSY 1u
+
+/*
+ * bdd_from_raster and bdd_to_raster work on images of at least
+ * BDD_PARALLEL_MIN_LEVEL levels (512 x 512) on the shared thread pool,
+ * splitting them into tasks down to BDD_PARALLEL_TASK_LEVEL levels
+ * (128 x 128 pixels per task).
+ */
+#define BDD_PARALLEL_MIN_LEVEL 18
+#define BDD_PARALLEL_TASK_LEVEL 14
+
+/*
+ * Images are decoded into rasters of at most RASTER_SIZE_MAX bytes, that is
+ * 8192 x 8192 pixels, which a BDD of BDD_RASTER_LEVEL_MAX levels covers; a
+ * BDD above it is rejected rather than decoded.
+ */
+#define BDD_RASTER_LEVEL_MAX 26
+
+unsigned int hash_function(int level, int left, int right);
+/*
+ * bdd_lookup for use while several threads add nodes to the current context,
+ * whose concurrent flag bdd_lookup then follows.  The node store and unique
+ * table must already be large enough for every node that can be added (see
+ * bdd_prepare_concurrent), since neither can grow while shared.  An empty
+ * slot is claimed by a compare-and-swap to BDD_HASH_BUSY, and filled with the
+ * new node's index once the node has been written, so each node is added
+ * exactly once and no thread sees a partly written node.
+ */
+int bdd_lookup_concurrent(int level, int left, int right);
+/*
+ * Commit the node store and grow the unique table so that a BDD of a
+ * specified level can be built without growing either.  Returns 0 on
+ * success, -1 on error.
+ */
+int bdd_prepare_concurrent(int level);
+int bdd_from_raster_parallel(POOL *pool, int w, int h, unsigned char *raster, int curr_level, int row_min, int row_max, int col_min, int col_max);
+int insert_node(BDD_NODE node, int index, BDD_NODE *nodes_table, unsigned int *slot, unsigned int fingerprint);
+/*
+ * Reserve address space for the node store and allocate an initial unique
+ * table, if that has not been done already.  Returns 0 on success, -1 on error.
+ */
+int bdd_store_init();
+/*
+ * Commit memory for at least count entries of bdd_nodes, growing
+ * geometrically.  Returns 0 on success, -1 on error.
+ */
+int bdd_nodes_commit(int count);
+/*
+ * Double the unique table and rehash every node into it, keeping the
+ * load factor at most 0.5.  Returns 0 on success, -1 on error.
+ */
+int bdd_hash_grow();
+/*
+ * Discard every non-leaf node, emptying the node table and the hash map,
+ * so that subsequent images start from a fresh table.  Any BDD_NODE pointers
+ * obtained before the reset are invalidated.
+ */
+void bdd_reset_nodes();
 int bdd_node_to_index(BDD_NODE *node);
 BDD_NODE* index_to_bdd_node(int index);
 int bdd_from_raster_recurse(int w, int h, unsigned char *raster, int curr_level, int row_min, int row_max, int col_min, int col_max);
+void bdd_to_raster_recurse(BDD_NODE *node, int level, int row, int col, int w, int h, unsigned char *raster);
+/*
+ * bdd_to_raster_recurse split into tasks for a pool: the halves of a region
+ * are decoded concurrently into disjoint parts of the raster, reading the
+ * node table without changing it.
+ */
+void bdd_to_raster_parallel(POOL *pool, BDD_NODE *node, int level, int row, int col, int w, int h, unsigned char *raster);
 
 int bdd_serialize_recurse(BDD_NODE *node, FILE *out, int serial_num);
+/*
+ * bdd_serialize for a large BDD, on a pool: the DAG is divided into the
+ * subtrees below BDD_PARALLEL_TASK_LEVEL, which are listed concurrently, a
+ * sequential pass numbers the nodes in the order of bdd_serialize_recurse,
+ * and the parts are then encoded concurrently into one buffer, which is
+ * written out.  The output is the same byte for byte.  Returns 0 on success,
+ * or -1 if memory runs out, in which case nothing has been written but
+ * bdd_index_map must be cleared again.
+ */
+int bdd_serialize_parallel(POOL *pool, BDD_NODE *node, FILE *out);
 void output_serial_number(int serial_num, FILE *out);
 
-int build_new_node(int level, FILE *in);
+int build_new_node(int level, int serial_num, FILE *in);
 int build_serial_num(FILE *in);
 
 int build_traversal_instructions(int num_bits, int r, int c);
 int bdd_apply_recurse(BDD_NODE *node, int level, int instructions);
 
-int bdd_map_recurse(BDD_NODE *node, unsigned char (*func)(unsigned char));
-
 int bdd_zoom_in(BDD_NODE *node, int factor);
 int bdd_zoom_out(BDD_NODE *node, int factor);
 
-int bdd_rotate_recurse(BDD_NODE *root, int level, int row_min, int row_max, int col_min, int col_max);
+/*
+ * Count the distinct nodes reachable from a node, including leaves, which
+ * is the number of instructions bdd_serialize would emit for it.
+ * If leavesp is non-NULL, the number of distinct leaves is stored there.
+ */
+int bdd_count_nodes(BDD_NODE *node, int *leavesp);
+int bdd_count_nodes_recurse(BDD_NODE *node, int *leavesp);
 
-void clear_bdd_index_map();
+/*
+ * Make bdd_index_map hold at least count entries, zeroing any new ones.
+ * Returns 0 on success, -1 if count exceeds BDD_NODES_MAX or on error.
+ */
+int bdd_index_map_reserve(int count);
+/*
+ * Zero the entries of bdd_index_map for all existing nodes, allocating
+ * them if needed.  Returns 0 on success, -1 on error.
+ */
+int clear_bdd_index_map();
 
 #endif
\ No newline at end of file
@@ -2,20 +2,149 @@
 #ifndef BIRP2_H
 #define BIRP2_H
 
+#include "mapped.h"
+
+/* Extended options, set by validargs alongside the bits in global_options. */
+#define REGION_QUERY_OPTION (0x00001000)
+#define BOUNDING_BOX_OPTION (0x00002000)  // Background value in bits 16-23.
+#define LOSSY_OPTION (0x00004000)  // Tolerance in bits 16-23.
+#define LOSSY_MEAN_OPTION (0x00008000)  // Tolerance bounds mean rather than max error.
+#define STATS_OPTION (0x01000000)  // Report instrumentation on stderr after the run.
+#define TRACE_OPTION (0x02000000)  // Write a Chrome trace of the run to trace_path.
+#define BATCH_OPTION (0x04000000)  // Convert the files named on the command line (see batch.h).
+#define PIPELINE_OPTION (0x08000000)  // Overlap reading, converting and writing (see pipeline.h).
+#define EDIT_OPTION (0x10000000)  // Paint the rectangles listed in edit_script_path.
+#define ENCODING_OPTIONS (0x60000000)  // Encoding of birp output, a BDD_ENCODING value (see planes.h).
+#define ENCODING_SHIFT 29
+/* Options that affect how the program runs, but not how an image is processed. */
+#define RUN_OPTIONS (STATS_OPTION | TRACE_OPTION | BATCH_OPTION | PIPELINE_OPTION)
+
+#define region_query_path (birp_context -> region_query_path)  // File of "ROW COL HEIGHT WIDTH" lines for -q.
+#define edit_script_path (birp_context -> edit_script_path)  // File of "ROW COL HEIGHT WIDTH VALUE" lines for -e.
+extern char *trace_path;  // Chrome trace-event file written for --trace.
+extern char *input_path;  // File read by --input instead of the standard input.
+extern char *output_path;  // File written by --output instead of the standard output.
+extern int order_kind;  // Variable order of birp output for --order, a BDD_ORDER kind (see order.h).
+extern unsigned char *point_lut;  // Fused table of the point options (--gamma and the like), see lut.h.
+
+/**
+ * Read a serialized BDD from an input stream and answer the rectangle-sum
+ * queries listed in the file named by region_query_path, one per line.
+ * For each query, a line "SUM COUNT MEAN" is written to the output stream,
+ * where COUNT is the number of pixels in the query rectangle after clipping
+ * it to the image.
+ *
+ * @param in  Stream from which to read the serialized BDD.
+ * @param out  Stream to which to write the query results.
+ * @return  0 if successful, -1 if any error occurs.
+ */
+int birp_region_query(FILE *in, FILE *out);
+
+/**
+ * Read a serialized BDD from an input stream and write the bounding box of
+ * the pixels that differ from the background value given in global_options,
+ * as a line "ROW COL HEIGHT WIDTH" ("0 0 0 0" if there are none).
+ *
+ * @param in  Stream from which to read the serialized BDD.
+ * @param out  Stream to which to write the bounding box.
+ * @return  0 if successful, -1 if any error occurs.
+ */
+int birp_bounding_box(FILE *in, FILE *out);
+
+/**
+ * Read a serialized BDD from an input stream, paint the rectangles listed
+ * in the file named by edit_script_path, one "ROW COL HEIGHT WIDTH VALUE"
+ * per line and in order, each with bdd_fill_rect, and write the edited
+ * BDD to the output stream.  The image is never decoded.
+ *
+ * @param in  Stream from which to read the serialized BDD.
+ * @param out  Stream to which to write the edited BDD.
+ * @return  0 if successful, -1 if any error occurs.
+ */
+int birp_edit(FILE *in, FILE *out);
+
+/**
+ * Read an image from an input stream and write the result to an output
+ * stream, performing the conversion, transformation or query selected by
+ * global_options.
+ *
+ * @param in  Stream from which to read the input image.
+ * @param out  Stream to which to write the output.
+ * @return  0 if successful, -1 if any error occurs.
+ */
+int birp_convert(FILE *in, FILE *out);
+
 int check_help_argument(char **argv);
 int check_input_output_format(char **argv, int args_remaining);
 int check_additional_args(char **argv);
 int check_additional_args_with_parameter(char **argv);
+int check_transformation_args(char **argv, int args_remaining);
+int check_extended_args(char **argv, int args_remaining);
+/*
+ * The transform (see dihedral.h) selected by a chainable option such as
+ * --hflip, or -1 if the argument is not one of them.
+ */
+int dihedral_argument(char *arg);
+/*
+ * The number of arguments taken by a chainable point option such as --gamma
+ * or -n, itself included, or 0 if the argument is not one of them; and the
+ * parsing of one, which folds it into point_lut and returns the number of
+ * arguments consumed, or -1.  A -n or -t with nothing to chain to is left
+ * as the transformation it is (0 is returned), and becomes the start of the
+ * table if a tone adjustment follows it.
+ */
+int point_argument(char *arg);
+int check_point_args(char **argv, int args_remaining);
+int validate_extended_options();
 void set_global_options_transformation_bits(int value);
 int validate_number(char *str);
 int string_to_int(char *str);
+/* A nonnegative decimal such as "2.2", or -1 if the string is not one. */
+double string_to_decimal(char *str);
 int compare_strings(char *str1, char *str2);
 
+/*
+ * Read a PGM image into raster_data, sized from its header, or map it in
+ * place if the input is a regular file, in which case the caller must
+ * release the map with mapped_pgm_close.  Returns the raster, or NULL if
+ * any error occurs.
+ */
+unsigned char *read_pgm_raster(FILE *in, int *wp, int *hp, MAPPED_PGM *map);
 int write_ascii_to_output(unsigned char *raster, int width, int height, FILE *out);
 
 unsigned char complement(unsigned char byte);
 unsigned char threshold(unsigned char byte);
+/* -n, -t or the point options (transformation 0x1, 0x2 or 0x7) as one table lookup per leaf. */
+BDD_NODE *apply_point_transformation(BDD_NODE *root, int transformation);
 BDD_NODE *apply_zoom_transformation(BDD_NODE *root, int *wp, int *hp);
+BDD_NODE *apply_crop_transformation(BDD_NODE *root, int *wp, int *hp);
+BDD_NODE *apply_dihedral_transformation(BDD_NODE *root, int *wp, int *hp);
+/*
+ * Record the symmetry selected in global_options, if any, as a view of a
+ * root that is to be decoded rather than written, updating *wp and *hp.
+ */
+void apply_dihedral_view(BDD_NODE *root, int *wp, int *hp);
+/*
+ * The zoom, crop and dihedral transformations with explicit parameters,
+ * updating the dimensions in *wp and *hp.  Return the new root, or NULL on
+ * error.  Unlike bdd_dihedral, dihedral_transformation keeps the image in
+ * the top left corner of its square, and exchanges the width and height of
+ * a transposed image.
+ */
+BDD_NODE *zoom_transformation(BDD_NODE *root, int factor, int *wp, int *hp);
+BDD_NODE *crop_transformation(BDD_NODE *root, int background, int *wp, int *hp);
+BDD_NODE *dihedral_transformation(BDD_NODE *root, int transform, int *wp, int *hp);
+BDD_NODE *apply_lossy_encoding(unsigned char *raster, int w, int h);
+/*
+ * Build the BDD of a raster in the variable order selected by --order,
+ * searching for it if need be (and then reporting it on the standard
+ * error), and set *orderp to the order.  Returns the root, or NULL on error.
+ */
+BDD_NODE *apply_order_encoding(unsigned char *raster, int w, int h, int *orderp);
+/* The name of an encoding (see planes.h), as given to --encoding. */
+const char *encoding_name(int encoding);
+/* Write a birp image in the encoding selected by --encoding (see planes.h); 0 if successful, -1 if not. */
+int write_birp_output(BDD_NODE *root, int w, int h, FILE *out);
 int negate_eight_bit_value(int value);
 
 #endif
\ No newline at end of file
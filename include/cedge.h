@@ -0,0 +1,75 @@
+#ifndef CEDGE_H
+#define CEDGE_H
+
+#include "bdd.h"
+
+/*
+ * Bilevel images, whose pixels are all 0 or 255 (as after -t), as BDDs with
+ * complemented edges.  Such a BDD has the single leaf 0, and an edge is an
+ * int holding the index of the node it points to, shifted left by one, with
+ * BDD_CEDGE_COMPLEMENT set if the image below it is to be inverted.  An
+ * image and its negative are then the same nodes reached through edges that
+ * differ in one bit, so negation creates nothing, and a region that recurs
+ * inverted elsewhere in the image is stored once.  So that each image still
+ * has only one representation, the left edge of a node is never
+ * complemented: a complement there is moved to the edges that point to the
+ * node.
+ *
+ * The nodes share the node table of the current context with ordinary
+ * nodes, from which they are kept apart by having BDD_CEDGE_LEVEL added to
+ * their level, and like them are discarded by bdd_reset_nodes.
+ */
+#define BDD_CEDGE_COMPLEMENT (0x1)
+#define BDD_CEDGE_LEVEL (0x40)
+#define BDD_CEDGE_BLACK (0)                       // The edge to the leaf: every pixel 0.
+#define BDD_CEDGE_WHITE (BDD_CEDGE_COMPLEMENT)    // Every pixel 255.
+
+/**
+ * Negate the image reached through an edge, which takes constant time.
+ *
+ * @param edge  The edge.
+ * @return  The edge to the negative image.
+ */
+#define bdd_cedge_not(edge) ((edge) ^ BDD_CEDGE_COMPLEMENT)
+
+/**
+ * Find or create the node with given level and children, first moving a
+ * complement on the left edge up to the returned edge.
+ *
+ * @param level  The level of the node, as for an ordinary node.
+ * @param left  The edge to its left child.
+ * @param right  The edge to its right child.
+ * @return  The edge to the node, or -1 if the node table is full.
+ */
+int bdd_cedge_lookup(int level, int left, int right);
+
+/**
+ * Convert a BDD whose leaves are all 0 or 255 into one with complemented
+ * edges.
+ *
+ * @param node  The BDD node that represents the image.
+ * @return  The edge that represents the image, or -1 if the image has
+ * another value or the node table is full.
+ */
+int bdd_cedge_from_bdd(BDD_NODE *node);
+
+/**
+ * Convert a BDD with complemented edges back into an ordinary BDD, with
+ * leaves 0 and 255, that can be decoded, serialized or transformed.
+ *
+ * @param edge  The edge that represents the image.
+ * @return  The BDD node that represents the image, or NULL if the node
+ * table is full or any other error occurs.
+ */
+BDD_NODE *bdd_cedge_to_bdd(int edge);
+
+/**
+ * Count the nodes reachable through an edge, including the leaf, for
+ * comparison with bdd_count_nodes.
+ *
+ * @param edge  The edge.
+ * @return  The number of nodes, or -1 if memory cannot be allocated.
+ */
+int bdd_cedge_count_nodes(int edge);
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef CEDGE2_H
+#define CEDGE2_H
+
+#define CEDGE_INDEX(edge) ((edge) >> 1)
+#define CEDGE_MAKE(index, complement) (((index) << 1) | (complement))
+
+int bdd_cedge_from_bdd_recurse(BDD_NODE *node);
+int bdd_cedge_to_bdd_recurse(int edge);
+int bdd_cedge_count_nodes_recurse(int edge);
+
+#endif
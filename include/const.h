@@ -12,19 +12,81 @@
 
 #define USAGE(program_name, retcode) do { \
 fprintf(stderr, "USAGE: %s %s\n", program_name, \
-"[-h] [-i FORMAT] [-o FORMAT] [-n|-r|-t THRESHOLD|-z FACTOR|-Z FACTOR]\n" \
+"[-h] [-i FORMAT] [-o FORMAT] [-n|-r|-t THRESHOLD|-z FACTOR|-Z FACTOR|-c BG]\n" \
+"       [--hflip|--vflip|--transpose|--antitranspose|--rotate90|--rotate180|--rotate270]...\n" \
+"       [--gamma G|--levels LO HI|--posterize N|--invert LO HI|--clamp LO HI]...\n" \
+"       [-q FILE|-b BG|-e FILE] [-l TOLERANCE|-L TOLERANCE] [--encoding ENCODING]\n" \
+"       [--order ORDER]\n" \
+"       [--stats] [--trace FILE] [--threads N] [--pipeline]\n" \
+"       [--input FILE] [--output FILE] [-d DIR [-j N] FILE...]\n" \
 "   -h       Help: displays this help menu.\n" \
 "   -i       Input format: `pgm` or `birp` (default `birp`)\n" \
 "   -o       Output format: `pgm`, `birp`, or `ascii` (default `birp`)\n\n" \
-"In all cases, the program reads image data from the standard input and writes\n" \
-"image data to the standard output.  If the input and output formats are both `birp`,\n" \
-"then one of the following transformations may be specified (the default is an\n" \
-"identity transformation; *i.e.* the image is passed unchanged):\n" \
+"In all cases, the program reads image data from the standard input (or the FILE\n" \
+"given by --input) and writes image data to the standard output (or the FILE given\n" \
+"by --output), mapping regular PGM files into memory rather than copying them.\n" \
+"If the input and output formats are both `birp`, then one of the following\n" \
+"transformations may be specified (the default is an identity transformation;\n" \
+"*i.e.* the image is passed unchanged):\n" \
 "   -n\tComplement each pixel value\n" \
 "   -r\tRotate the image 90-degrees counterclockwise\n" \
 "   -t\tApply a threshold filter (with THRESHOLD in [0, 255]) to the image\n" \
 "   -z\tZoom out (by FACTOR in [0, 16]), producing a smaller raster\n" \
 "   -Z\tZoom in, (by FACTOR in [0, 16]), producing a larger raster\n" \
+"   -c\tCrop to the bounding box of pixels differing from background BG in [0, 255]\n" \
+"Instead, any sequence of the following may be given, applied in order in one pass\n" \
+"(with birp input and any output format; only birp output builds new nodes):\n" \
+"   --hflip, --vflip             Mirror the image left to right, or top to bottom\n" \
+"   --transpose, --antitranspose Mirror the image about its main or other diagonal\n" \
+"   --rotate90, --rotate180, --rotate270\n" \
+"                                Rotate the image counterclockwise by that many degrees\n" \
+"Or any sequence of these tone adjustments (birp to birp), fused into one table\n" \
+"with any -n and -t among them:\n" \
+"   --gamma G          Map v to 255 * (v / 255)^G, for G in (0, 16] such as 2.2\n" \
+"   --levels LO HI     Stretch [LO, HI] to [0, 255], clipping values outside it\n" \
+"   --posterize N      Reduce to N equally spaced values, N in [2, 256]\n" \
+"   --invert LO HI     Map v in [LO, HI] to LO + HI - v, leaving other values\n" \
+"   --clamp LO HI      Limit values to [LO, HI]\n\n" \
+"Additional modes (birp input only):\n" \
+"   -q\tAnswer rectangle-sum queries listed in FILE, one \"ROW COL HEIGHT WIDTH\"\n" \
+"     \tper line, writing \"SUM COUNT MEAN\" per query to the standard output\n" \
+"   -b\tPrint \"ROW COL HEIGHT WIDTH\" of the pixels differing from background BG\n" \
+"   -e\tPaint the rectangles listed in FILE, one \"ROW COL HEIGHT WIDTH VALUE\" per\n" \
+"     \tline and in order, without decoding the image (birp output only)\n\n" \
+"Lossy encoding (pgm input, birp output only):\n" \
+"   -l\tMerge subtrees so no pixel changes by more than TOLERANCE in [0, 255]\n" \
+"   -L\tMerge subtrees whose mean absolute error is at most TOLERANCE\n" \
+"     \tNode counts, sizes and PSNR are reported on the standard error\n" \
+"\n" \
+"Encoding (birp output only; birp input of either encoding is always accepted):\n" \
+"   --encoding  `nodes` (the default) for one leaf per pixel value, `planes` for\n" \
+"               eight bit planes, `gray` for bit planes of Gray codes, or `auto`\n" \
+"               for the smallest, reporting the size of each on the standard error\n" \
+"   --order     Variable order (pgm input, birp output only): `interleaved` (the\n" \
+"               default) alternates row and column splits, `columns-first` starts\n" \
+"               with a column split, `row-blocks` and `column-blocks` split pairs of\n" \
+"               rows or columns at a time, and `search` tries them all and swaps\n" \
+"               adjacent splits while that saves nodes, reporting the order found\n" \
+"               (slower); other orders are stored in the file and honoured on reading\n" \
+"\n" \
+"Batch mode:\n" \
+"   -d\tConvert each FILE (or each file with the input format's extension in a\n" \
+"     \tdirectory FILE) into DIR, instead of the standard input and output,\n" \
+"     \tsharing one node table; per-file timings are reported on the standard error\n" \
+"   -j\tConvert N files at once in separate threads (N in [1, 256]; not with\n" \
+"     \t--stats or --trace)\n" \
+"\n" \
+"Threads:\n" \
+"   --threads   Use N threads (in [1, 256]; default: the number of CPUs) to build,\n" \
+"               decode and write each large image\n" \
+"   --pipeline  Read, convert and write at the same time in separate threads, for\n" \
+"               pgm to birp and birp to pgm\n" \
+"\n" \
+"Instrumentation:\n" \
+"   --stats  After the run, report per-phase times, node table usage, probe\n" \
+"            lengths, memo hits and bytes read/written on the standard error\n" \
+"   --trace  Write a Chrome trace-event timeline of the run to FILE, for\n" \
+"            chrome://tracing or Perfetto\n" \
 ); \
 exit(retcode); \
 } while(0)
@@ -32,7 +94,7 @@ exit(retcode); \
 /* Options info, set by validargs. */
 #define HELP_OPTION (0x80000000)
 
-int global_options;  // Bitmap specifying mode of program operation.
+#define global_options (birp_context -> options)  // Bitmap specifying mode of program operation.
 
 /*
  * The following global variables have been provided for you.
@@ -42,14 +104,25 @@ int global_options;  // Bitmap specifying mode of program operation.
  * inspect the contents of these variables.
  */
 
-/* Space for a 64-megapixel 8-bit grayscale image. */
+/*
+ * Space for an 8-bit grayscale image of up to 64 megapixels.  It is
+ * allocated by raster_reserve, sized from the image header, so that small
+ * images use little memory; it is NULL until then.
+ */
 #define RASTER_SIZE_MAX (8192 * 8192 * sizeof(unsigned char))
-unsigned char raster_data[RASTER_SIZE_MAX];
+#define raster_data (birp_context -> raster)
+
+/**
+ * Make raster_data hold at least a specified number of bytes, reallocating
+ * it if it is smaller.  The contents are not preserved when it grows.
+ *
+ * @param size  The number of bytes required, at most RASTER_SIZE_MAX.
+ * @return  raster_data, or NULL if size is too large or memory cannot be
+ * allocated.
+ */
+unsigned char *raster_reserve(size_t size);
 
-/* See bdd.h for more information about these arrays. */
-extern BDD_NODE bdd_nodes[BDD_NODES_MAX];
-extern BDD_NODE *bdd_hash_map[BDD_HASH_SIZE];
-extern int bdd_index_map[BDD_NODES_MAX];
+/* See bdd.h for bdd_nodes, bdd_hash_map and bdd_index_map, and context.h for where they live. */
 
 /*
  * Below this line are prototypes for functions that MUST occur in your program.
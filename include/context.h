@@ -0,0 +1,90 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <stddef.h>
+
+struct bdd_node;
+struct quad_node;
+
+/*
+ * A transform recorded against a root rather than applied to it (see
+ * dihedral.h), so that decoding the root yields the transformed image.
+ */
+struct bdd_view {
+    struct bdd_node *root;     // NULL if there is no view.
+    int transform;
+    int width;                 // Of the untransformed image.
+    int height;
+};
+
+/*
+ * All of the state needed to process images: the node store and the tables
+ * that parallel it, the raster buffer and the options.  The names used
+ * throughout the program for this state (bdd_nodes, bdd_hash_map,
+ * current_bdd_node_index, raster_data, global_options, ...) are macros that
+ * refer to the fields of the calling thread's current context, birp_context.
+ * Threads using different contexts therefore never share nodes or buffers,
+ * so several images can be processed concurrently in one process.
+ *
+ * BDD_NODE pointers belong to the context in which they were created, and
+ * must only be used while that context is current.  The instrumentation
+ * enabled by --stats and --trace is process-wide rather than per context.
+ */
+typedef struct birp_context {
+    struct bdd_node *nodes;    // bdd_nodes
+    int nodes_committed;       // bdd_nodes_committed
+    int current_node_index;    // current_bdd_node_index
+    int concurrent;            // Set while several threads add nodes (see bdd_lookup_concurrent).
+    unsigned int *hash_map;    // bdd_hash_map
+    int hash_size;             // bdd_hash_size
+    int *index_map;            // bdd_index_map
+    int index_map_size;        // bdd_index_map_size
+    long long *sum_table;      // bdd_sum_table
+    int sum_table_size;        // bdd_sum_table_size
+    unsigned char *raster;     // raster_data
+    size_t raster_capacity;
+    int options;               // global_options
+    char *region_query_path;   // region_query_path
+    char *edit_script_path;    // edit_script_path
+    struct bdd_view view;      // bdd_view
+    struct quad_node *quad_nodes;  // bdd_quad_nodes
+    int quad_nodes_size;       // Entries allocated in bdd_quad_nodes.
+    int quad_count;            // Quadtree nodes in bdd_quad_nodes, after the leaves.
+    unsigned int *quad_hash_map;
+    int quad_hash_size;
+} BIRP_CONTEXT;
+
+/*
+ * The context used by the calling thread.  Every thread starts out using
+ * a single default context, which is what the command-line program uses.
+ */
+extern _Thread_local BIRP_CONTEXT *birp_context;
+
+/**
+ * Create a new, empty context.  No memory is committed for nodes or rasters
+ * until the context is first used to build or read an image.
+ *
+ * @return  The new context, or NULL if memory cannot be allocated.
+ */
+BIRP_CONTEXT *birp_context_create();
+
+/**
+ * Free a context and everything it holds.  The context must not be current
+ * in any thread, and BDD_NODE pointers obtained from it become invalid.
+ * Destroying the default context just empties it.
+ *
+ * @param ctx  The context to free.
+ */
+void birp_context_destroy(BIRP_CONTEXT *ctx);
+
+/**
+ * Make a context current for the calling thread, so that subsequent calls
+ * to the bdd_*, img_* and conversion functions on this thread use its state.
+ *
+ * @param ctx  The context to use, or NULL for the default context.
+ * @return  The context that was current before the call, so that it can be
+ * restored.
+ */
+BIRP_CONTEXT *birp_context_use(BIRP_CONTEXT *ctx);
+
+#endif
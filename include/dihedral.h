@@ -0,0 +1,118 @@
+#ifndef DIHEDRAL_H
+#define DIHEDRAL_H
+
+#include "bdd.h"
+
+/*
+ * The eight symmetries of a square image (flips, transposes and rotations by
+ * multiples of 90 degrees), each encoded as a combination of three bits.
+ * A transform maps each pixel (r, c) of its result to the pixel (R, C) of
+ * the original image obtained by first exchanging r and c if
+ * BDD_DIHEDRAL_TRANSPOSE is set, then mirroring the row if
+ * BDD_DIHEDRAL_FLIP_ROWS is set and the column if BDD_DIHEDRAL_FLIP_COLS is
+ * set.  Any sequence of transforms is again one of the eight, so a chain of
+ * them is applied in a single pass.
+ */
+#define BDD_DIHEDRAL_FLIP_ROWS (0x1)
+#define BDD_DIHEDRAL_FLIP_COLS (0x2)
+#define BDD_DIHEDRAL_TRANSPOSE (0x4)
+
+#define BDD_DIHEDRAL_IDENTITY (0x0)
+#define BDD_DIHEDRAL_VFLIP (BDD_DIHEDRAL_FLIP_ROWS)  // Upside down.
+#define BDD_DIHEDRAL_HFLIP (BDD_DIHEDRAL_FLIP_COLS)  // Left to right.
+#define BDD_DIHEDRAL_ROTATE_180 (BDD_DIHEDRAL_FLIP_ROWS | BDD_DIHEDRAL_FLIP_COLS)
+#define BDD_DIHEDRAL_ROTATE_90 (BDD_DIHEDRAL_TRANSPOSE | BDD_DIHEDRAL_FLIP_COLS)  // Counterclockwise.
+#define BDD_DIHEDRAL_ROTATE_270 (BDD_DIHEDRAL_TRANSPOSE | BDD_DIHEDRAL_FLIP_ROWS)
+#define BDD_DIHEDRAL_ANTI_TRANSPOSE (BDD_DIHEDRAL_TRANSPOSE | BDD_DIHEDRAL_FLIP_ROWS | BDD_DIHEDRAL_FLIP_COLS)
+
+/**
+ * Combine two transforms into the one that has the effect of applying the
+ * first and then the second.
+ *
+ * @param first  The transform applied first.
+ * @param second  The transform applied second.
+ * @return  The combined transform.
+ */
+int bdd_dihedral_compose(int first, int second);
+
+/**
+ * Given a BDD node that represents a 2^d x 2^d image, construct a new BDD
+ * node that represents the image transformed by one of the eight
+ * symmetries of the square.  Rather than moving pixels, the transform
+ * rewrites the structure of the BDD: within each pair of levels (a row
+ * level 2k and the column level 2k-1 below it) a flip exchanges the
+ * children at the row or column level, and a transpose exchanges the roles
+ * of the two levels.  Each node is rewritten once, so the cost is
+ * proportional to the number of nodes rather than of pixels.  As with
+ * bdd_rotate, a node at an odd level is taken to represent the enclosing
+ * square at the next even level.
+ *
+ * @param node  The BDD node to transform.
+ * @param transform  The transform, a combination of the BDD_DIHEDRAL bits.
+ * @return  The BDD node resulting from the transformation, or NULL if the
+ * node table is full or any other error occurs.
+ */
+BDD_NODE *bdd_dihedral(BDD_NODE *node, int transform);
+
+/*
+ * The view of the current context: a transform that bdd_to_raster and
+ * bdd_apply apply on the fly when they are given its root, so that an image
+ * that is only to be decoded is never transformed into new nodes.  Like
+ * dihedral_transformation (see birp2.h), a view keeps the image in the top
+ * left corner, with its width and height exchanged if it is transposed;
+ * pixels outside the transformed image are 0.
+ */
+typedef struct bdd_view BDD_VIEW;
+#define bdd_view (birp_context -> view)
+
+/**
+ * Record a transform of an image as the view of the current context,
+ * replacing any earlier view.
+ *
+ * @param root  The BDD node that represents the untransformed image.
+ * @param transform  The transform, a combination of the BDD_DIHEDRAL bits.
+ * @param wp  The width of the untransformed image, replaced by that of the
+ * transformed one.
+ * @param hp  The height, likewise.
+ */
+void bdd_view_set(BDD_NODE *root, int transform, int *wp, int *hp);
+
+/**
+ * Forget the view of the current context, if any.  Nodes are unaffected.
+ */
+void bdd_view_clear();
+
+/**
+ * Determine whether a node is decoded through the view of the current context.
+ *
+ * @param node  The BDD node.
+ * @return  Nonzero if the node is the root of a view that is not the identity.
+ */
+int bdd_view_active(BDD_NODE *node);
+
+/**
+ * Decode some rows of the transformed image of the view of the current
+ * context into a w x h raster, by traversing the untransformed BDD and
+ * storing each uniform region at its transformed position.  Pixels of the
+ * raster outside the transformed image are set to 0.
+ *
+ * @param w  The width of the raster.
+ * @param h  The height of the raster.
+ * @param raster  The raster, in row-major order.
+ * @param row_min  The first row to decode.
+ * @param row_max  The row just past the last one to decode.
+ */
+void bdd_view_to_raster(int w, int h, unsigned char *raster, int row_min, int row_max);
+
+/**
+ * Find the pixel of the untransformed image of the view of the current
+ * context that a pixel of the transformed image shows.
+ *
+ * @param rp  The row of the pixel, replaced by that in the untransformed image.
+ * @param cp  The column, likewise.
+ * @return  0 if successful, -1 if the pixel lies outside the transformed
+ * image, in which case its value is 0.
+ */
+int bdd_view_map(int *rp, int *cp);
+
+#endif
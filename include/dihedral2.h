@@ -0,0 +1,20 @@
+#ifndef DIHEDRAL2_H
+#define DIHEDRAL2_H
+
+int bdd_dihedral_recurse(BDD_NODE *node, int transform);
+int bdd_dihedral_quadrant(BDD_NODE *node, int level, int transform, int out_row, int out_col);
+
+/*
+ * Decode the part of a node at (row, col) of the untransformed image that
+ * lies within the rectangle [row_min, row_max) x [col_min, col_max) into
+ * the raster, of width w, at its position in the view.
+ */
+void bdd_view_to_raster_recurse(BDD_NODE *node, int level, int row, int col, int row_min, int row_max,
+                                int col_min, int col_max, int w, unsigned char *raster);
+/*
+ * Set the pixels of the raster onto which the view maps a rectangle of the
+ * untransformed image to a value.
+ */
+void bdd_view_fill(int row_min, int row_max, int col_min, int col_max, int value, int w, unsigned char *raster);
+
+#endif
@@ -27,6 +27,34 @@
  */
 int img_read_pgm(FILE *in, int *wp, int *hp, unsigned char *raster, size_t size);
 
+/**
+ * Read the magic and header of an image in PGM format from an input stream,
+ * storing the width and height of the raster using the "wp" and "hp"
+ * pointers, and leaving the stream positioned at the start of the raster
+ * data.  Together with img_read_pgm_raster, this allows the raster to be
+ * allocated once its size is known.
+ *
+ * @param in  The stream from which to read PGM input.
+ * @param wp  Pointer to a variable into which to store the raster width.
+ * @param hp  Pointer to a variable into which to store the raster height.
+ * @param return  0 if the header was read successfully; -1 if any error
+ * occurred.
+ */
+int img_read_pgm_header(FILE *in, int *wp, int *hp);
+
+/**
+ * Read the w x h raster data of an image in PGM format, whose header has
+ * already been read by img_read_pgm_header, into an array in row-major order.
+ *
+ * @param in  The stream from which to read PGM input.
+ * @param w  Width of the image raster.
+ * @param h  Height of the image raster.
+ * @param raster  Pointer to an array of at least w x h bytes.
+ * @param return  0 if the raster was read successfully; -1 if any error
+ * occurred.
+ */
+int img_read_pgm_raster(FILE *in, int w, int h, unsigned char *raster);
+
 /**
  * Write an image to an output stream in PGM format.  The stream
  * is flushed (but not closed) after the image has been written.
@@ -48,13 +76,29 @@ int img_write_pgm(unsigned char *raster, int w, int h, FILE *out);
  * @param wp  Pointer to a variable into which to store the raster width.
  * @param hp  Pointer to a variable into which to store the raster height.
  * @param return  A pointer to the root node of the BDD that represents
- * the image raster, if the image was read successfully; NULL if any error
+ * the image raster, if the image was read successfully (images written as
+ * bit planes are recombined); NULL if any error
  * occurred.  Examples of errors are formatting errors in the BIRP file,
  * I/O errors in reading the BIRP file, and the BDD nodes table having
  * insufficient size for the deserialized BDD.
  */
 BDD_NODE *img_read_birp(FILE *in, int *wp, int *hp);
 
+/**
+ * Read an image in BIRP format as img_read_birp does, but leave a BDD
+ * written in another variable order (see order.h) in that order rather than
+ * rebuilding it, so that it can be decoded directly with
+ * bdd_to_raster_ordered.
+ *
+ * @param in  The stream from which to read BIRP input.
+ * @param wp  Pointer to a variable into which to store the raster width.
+ * @param hp  Pointer to a variable into which to store the raster height.
+ * @param orderp  Pointer to a variable into which to store the order.
+ * @param return  A pointer to the root node of the BDD, or NULL if any
+ * error occurred.
+ */
+BDD_NODE *img_read_birp_ordered(FILE *in, int *wp, int *hp, int *orderp);
+
 /**
  * Write an image to an output stream in BIRP format.  The stream
  * is flushed (but not closed) after the image has been written.
@@ -67,4 +111,34 @@ BDD_NODE *img_read_birp(FILE *in, int *wp, int *hp);
  */
 int img_write_birp(BDD_NODE *node, int w, int h, FILE *out);
 
+/**
+ * Write an image whose BDD was built in a given variable order (see
+ * order.h) to an output stream in BIRP format.  Unless the order is that of
+ * bdd_from_raster, in which case the output is as from img_write_birp, the
+ * header is followed by 'o' and the order in four bytes, least significant
+ * first, and then by the serialized BDD.
+ *
+ * @param node  Pointer to the root node of the BDD.
+ * @param w  Width of the image raster.
+ * @param h  Height of the image raster.
+ * @param order  The order of the levels of the BDD.
+ * @param out  Stream to which to write the BIRP data.
+ */
+int img_write_birp_ordered(BDD_NODE *node, int w, int h, int order, FILE *out);
+
+/**
+ * Write an image split into bit planes (see planes.h) to an output stream
+ * in BIRP format, which img_read_birp recombines.  The header is followed
+ * by 'p', by 'b' or by 'g' if the planes hold Gray codes, and by a byte
+ * holding the level of the image, and then by the serialized planes.
+ *
+ * @param planes  The root of the planes, as returned by bdd_to_planes.
+ * @param w  Width of the image raster.
+ * @param h  Height of the image raster.
+ * @param level  The level of the image, as given to bdd_to_planes.
+ * @param gray  Nonzero if the planes hold Gray codes.
+ * @param out  Stream to which to write the BIRP data.
+ */
+int img_write_birp_planes(BDD_NODE *planes, int w, int h, int level, int gray, FILE *out);
+
 #endif
@@ -0,0 +1,186 @@
+#ifndef LIBBIRP_H
+#define LIBBIRP_H
+
+/*
+ * The libbirp library interface, for converting and transforming images
+ * in-process rather than by running bin/birp once per image.  Link with
+ * lib/libbirp.a or lib/libbirp.so (and -lm -lpthread).
+ *
+ * Every function that builds or reads a BDD takes the context in which its
+ * nodes are kept.  A context is used by one thread at a time, but separate
+ * contexts can be used from separate threads concurrently.  Nodes accumulate
+ * in a context until birp_context_reset is called, so that identical parts
+ * of successive images are shared; a long-running caller should reset the
+ * context between batches of images, or when a call fails because the node
+ * table is full.
+ *
+ * Functions that return int return 0 on success and -1 on any error.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+typedef struct birp_context BIRP_CONTEXT;
+
+/*
+ * An image held as a BDD in a context.  The root belongs to that context, and
+ * becomes invalid when the context is reset or destroyed.
+ */
+typedef struct birp_image {
+    struct bdd_node *root;
+    int width;
+    int height;
+} BIRP_IMAGE;
+
+/**
+ * Create a new, empty context.
+ *
+ * @return  The new context, or NULL if memory cannot be allocated.
+ */
+BIRP_CONTEXT *birp_context_create();
+
+/**
+ * Free a context and all of the images in it.
+ *
+ * @param ctx  The context to free.
+ */
+void birp_context_destroy(BIRP_CONTEXT *ctx);
+
+/**
+ * Discard all of the images in a context, keeping its memory for reuse.
+ *
+ * @param ctx  The context to reset.
+ */
+void birp_context_reset(BIRP_CONTEXT *ctx);
+
+/**
+ * Read the header of a PGM image, leaving the stream positioned at the start
+ * of the raster data, so that a raster of the right size can be allocated.
+ *
+ * @param in  The stream from which to read PGM input.
+ * @param wp  Pointer to a variable into which to store the image width.
+ * @param hp  Pointer to a variable into which to store the image height.
+ */
+int birp_pgm_read_header(FILE *in, int *wp, int *hp);
+
+/**
+ * Read the raster data of a PGM image whose header has been read by
+ * birp_pgm_read_header.
+ *
+ * @param in  The stream from which to read PGM input.
+ * @param w  Width of the image.
+ * @param h  Height of the image.
+ * @param raster  Array of at least w x h bytes, filled in row-major order.
+ */
+int birp_pgm_read_raster(FILE *in, int w, int h, unsigned char *raster);
+
+/**
+ * Write a raster to a stream in PGM format, and flush the stream.
+ *
+ * @param raster  Array of w x h bytes in row-major order.
+ * @param w  Width of the image.
+ * @param h  Height of the image.
+ * @param out  The stream to which to write.
+ */
+int birp_pgm_write(const unsigned char *raster, int w, int h, FILE *out);
+
+/**
+ * Build the BDD for a raster.
+ *
+ * @param ctx  The context in which to build the image.
+ * @param raster  Array of w x h bytes in row-major order, not retained.
+ * @param w  Width of the image.
+ * @param h  Height of the image.
+ * @param image  Set to the new image.
+ */
+int birp_image_from_raster(BIRP_CONTEXT *ctx, const unsigned char *raster, int w, int h,
+                           BIRP_IMAGE *image);
+
+/**
+ * Unpack an image into a raster.
+ *
+ * @param ctx  The context that holds the image.
+ * @param image  The image to unpack.
+ * @param raster  Array into which to store the pixels in row-major order.
+ * @param size  Size of the array, which must be at least width x height bytes.
+ */
+int birp_image_to_raster(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, unsigned char *raster,
+                         size_t size);
+
+/**
+ * Read an image in BIRP format.
+ *
+ * @param ctx  The context in which to build the image.
+ * @param in  The stream from which to read BIRP input.
+ * @param image  Set to the image read.
+ */
+int birp_image_read(BIRP_CONTEXT *ctx, FILE *in, BIRP_IMAGE *image);
+
+/**
+ * Write an image in BIRP format, and flush the stream.
+ *
+ * @param ctx  The context that holds the image.
+ * @param image  The image to write.
+ * @param out  The stream to which to write.
+ */
+int birp_image_write(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, FILE *out);
+
+/* Encodings of BIRP output for birp_image_write_encoded, as for --encoding. */
+#define BIRP_ENCODING_NODES 0  // One leaf per pixel value, as written by birp_image_write.
+#define BIRP_ENCODING_PLANES 1  // Eight bit planes.
+#define BIRP_ENCODING_GRAY 2  // Eight bit planes of Gray codes.
+#define BIRP_ENCODING_AUTO 3  // Whichever of the three is smallest.
+
+/**
+ * Write an image in BIRP format in a specified encoding, and flush the
+ * stream.  birp_image_read accepts every encoding.
+ *
+ * @param ctx  The context that holds the image.
+ * @param image  The image to write.
+ * @param encoding  One of the BIRP_ENCODING values.
+ * @param out  The stream to which to write.
+ */
+int birp_image_write_encoded(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int encoding, FILE *out);
+
+/*
+ * Transformations, as performed by the corresponding bin/birp options.  Each
+ * builds a new image in the same context, leaving the original image intact;
+ * result may point to the same BIRP_IMAGE as image.
+ */
+
+/** Replace every pixel value v by 255 - v (-n). */
+int birp_image_complement(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, BIRP_IMAGE *result);
+
+/** Replace pixel values at least value (0-255) by 255, and others by 0 (-t). */
+int birp_image_threshold(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int value,
+                         BIRP_IMAGE *result);
+
+/**
+ * Replace every pixel value v by lut[v], where lut holds 256 values, in one
+ * walk over the nodes (none if lut is the identity).  lut.h builds and fuses
+ * such tables for gamma, levels, posterize, invert and clamp (--gamma and the
+ * like); a chain of them costs one call.
+ */
+int birp_image_lut(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, const unsigned char *lut,
+                   BIRP_IMAGE *result);
+
+/** Scale by 2^factor, where a negative factor zooms out (-Z and -z). */
+int birp_image_zoom(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int factor, BIRP_IMAGE *result);
+
+/** Rotate by 90 degrees counterclockwise within the enclosing square (-r). */
+int birp_image_rotate(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, BIRP_IMAGE *result);
+
+/**
+ * Flip, transpose or rotate by a multiple of 90 degrees (--hflip and the
+ * like), in one pass over the nodes.  The transform combines 1 (mirror the
+ * rows), 2 (mirror the columns) and 4 (transpose, applied first), as in
+ * dihedral.h; a transposed image has its width and height exchanged.
+ */
+int birp_image_dihedral(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int transform,
+                        BIRP_IMAGE *result);
+
+/** Crop to the bounding box of the pixels other than background (-c). */
+int birp_image_crop(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int background,
+                    BIRP_IMAGE *result);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef LOSSY_H
+#define LOSSY_H
+
+#include "bdd.h"
+
+/*
+ * Error metrics for lossy encoding.  With LOSSY_METRIC_MAX, every pixel of
+ * the decoded image is within the tolerance of the original pixel.  With
+ * LOSSY_METRIC_MEAN, the mean absolute error over each merged subtree is
+ * within the tolerance, which merges more aggressively.
+ */
+#define LOSSY_METRIC_MAX 0
+#define LOSSY_METRIC_MEAN 1
+
+/**
+ * Build a BDD approximating a w x h raster, merging subtrees that are
+ * within a specified tolerance of one another.  The raster is built
+ * bottom-up as in bdd_from_raster, but before a node is hash-consed the
+ * following cheaper replacements are tried, each checked against the
+ * original pixels of the node's region:
+ *
+ *   - a single leaf holding the midpoint (or mean) of the region;
+ *   - either child reused for both halves, which removes the node;
+ *   - a previously built node with a similar mean at the same level.
+ *
+ * The first replacement within tolerance is used, so errors never
+ * accumulate beyond the tolerance across levels.  Pixels outside the raster
+ * are treated as zero, as in bdd_from_raster.  A tolerance of 0 with
+ * LOSSY_METRIC_MAX yields exactly the BDD built by bdd_from_raster.
+ *
+ * @param w  The width of the raster.
+ * @param h  The height of the raster.
+ * @param raster  The raster, stored in row-major order.
+ * @param tolerance  The largest permitted error, in grey levels.
+ * @param metric  LOSSY_METRIC_MAX or LOSSY_METRIC_MEAN.
+ * @return  The root of the approximating BDD, or NULL if any error occurs.
+ */
+BDD_NODE *bdd_from_raster_lossy(int w, int h, unsigned char *raster, int tolerance, int metric);
+
+/**
+ * Compute the peak signal-to-noise ratio between two w x h rasters.
+ *
+ * @param original  The reference raster.
+ * @param decoded  The approximating raster.
+ * @param w  The width of the rasters.
+ * @param h  The height of the rasters.
+ * @return  The PSNR in decibels, or a negative value if the rasters are
+ * identical (infinite PSNR).
+ */
+double raster_psnr(unsigned char *original, unsigned char *decoded, int w, int h);
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef LOSSY2_H
+#define LOSSY2_H
+
+int bdd_from_raster_lossy_recurse(int level, int row, int col, int *minp, int *maxp, long long *sump);
+long long bdd_lossy_error(BDD_NODE *node, int level, int row, int col, long long limit);
+
+#endif
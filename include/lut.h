@@ -0,0 +1,85 @@
+#ifndef LUT_H
+#define LUT_H
+
+#include "bdd.h"
+
+/*
+ * Point operations, which replace each pixel value by a function of that
+ * value alone, as lookup tables: BDD_LUT_SIZE bytes, each the new value of
+ * the pixel value that indexes it.  Each of the lut_* operations below
+ * applies itself to the values already in a table, so that a sequence of
+ * operations applied to a table that starts out as the identity leaves it
+ * holding their composition, and the whole sequence costs one walk over the
+ * nodes with bdd_map_lut.
+ */
+#define BDD_LUT_SIZE 256
+
+/**
+ * Make a table the identity, which leaves every value unchanged.
+ *
+ * @param lut  The table.
+ */
+void lut_identity(unsigned char *lut);
+
+/**
+ * Determine whether a table is the identity.
+ *
+ * @param lut  The table.
+ * @return  Nonzero if every value maps to itself.
+ */
+int lut_is_identity(unsigned char *lut);
+
+/**
+ * Follow a table by another: each value v becomes next[v].
+ *
+ * @param lut  The table, updated in place.
+ * @param next  The table applied second.
+ */
+void lut_compose(unsigned char *lut, unsigned char *next);
+
+/** Follow a table by v -> 255 - v (-n). */
+void lut_complement(unsigned char *lut);
+
+/** Follow a table by v -> 255 if v >= threshold, and 0 otherwise (-t). */
+void lut_threshold(unsigned char *lut, int threshold);
+
+/**
+ * Follow a table by the gamma curve v -> 255 * (v / 255)^gamma, rounded.
+ * A gamma above 1 darkens the midtones and one below 1 lightens them.
+ */
+void lut_gamma(unsigned char *lut, double gamma);
+
+/**
+ * Follow a table by a contrast stretch that maps low to 0 and high to 255
+ * linearly, rounding, with values below low becoming 0 and values above high
+ * becoming 255.  Requires low < high.
+ */
+void lut_levels(unsigned char *lut, int low, int high);
+
+/**
+ * Follow a table by a reduction to a number of equally spaced values,
+ * from 0 to 255, each value becoming the one for its band of the range.
+ * Requires 2 <= levels <= 256.
+ */
+void lut_posterize(unsigned char *lut, int levels);
+
+/** Follow a table by v -> low + high - v for values in [low, high], leaving the others. */
+void lut_invert_range(unsigned char *lut, int low, int high);
+
+/** Follow a table by v -> min(max(v, low), high).  Requires low <= high. */
+void lut_clamp(unsigned char *lut, int low, int high);
+
+/**
+ * Given a BDD node, construct a new BDD node that represents the image
+ * with each pixel value v replaced by lut[v].  As with bdd_map, each node
+ * is visited once; unlike it, no function is called per leaf, and the
+ * original node is returned at once if the table is the identity.
+ *
+ * @param node  The BDD node to transform.
+ * @param lut  The table of new values.
+ * @return  The BDD node resulting from the transformation, or NULL if the
+ * node table is full or any other error occurs.
+ */
+BDD_NODE *bdd_map_lut(BDD_NODE *node, unsigned char *lut);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef LUT2_H
+#define LUT2_H
+
+int bdd_map_lut_recurse(BDD_NODE *node, unsigned char *lut);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef MAPPED_H
+#define MAPPED_H
+
+#include <stdio.h>
+
+/*
+ * PGM images read or written in place, by mapping a regular file into
+ * memory, so that the raster is neither copied through stdio buffers nor
+ * moved a byte at a time.  Streams that cannot be mapped (pipes, terminals,
+ * the counting streams of --stats, or output files opened for writing only)
+ * are left to the stdio paths in image.c.
+ */
+typedef struct mapped_pgm {
+    unsigned char *base;    // Start of the mapping, NULL if there is none.
+    size_t length;          // Bytes mapped.
+    unsigned char *raster;  // The pixels, w x h in row-major order, within the mapping.
+    int w;
+    int h;
+} MAPPED_PGM;
+
+/**
+ * Map a PGM image from a stream that is a regular file not yet read from,
+ * and parse its header.  The stream is left at the end of the image, as if
+ * it had been read.
+ *
+ * @param in  The input stream.
+ * @param map  Set to the mapping, or to no mapping if none is made.
+ * @return  0 if the image was mapped, -1 if it is invalid (which has been
+ * reported on the standard error), or 1 if the stream cannot be mapped, in
+ * which case it has not been read and the caller should read it with
+ * img_read_pgm.
+ */
+int mapped_pgm_read(FILE *in, MAPPED_PGM *map);
+
+/**
+ * Size a stream that is an empty regular file, open for reading and
+ * writing, for a w x h PGM image, write the header and map the raster, so
+ * that the caller can store the pixels directly into the file.
+ *
+ * @param out  The output stream.
+ * @param w  The width of the image.
+ * @param h  The height of the image.
+ * @param map  Set to the mapping, or to no mapping if none is made.
+ * @return  0 if the image was mapped, -1 if the stream cannot be mapped, in
+ * which case nothing has been written and the caller should use
+ * img_write_pgm.
+ */
+int mapped_pgm_create(FILE *out, int w, int h, MAPPED_PGM *map);
+
+/**
+ * Unmap an image mapped by mapped_pgm_read or mapped_pgm_create, if any.
+ * The pixels of an output image are then in the file.
+ *
+ * @param map  The mapping.
+ * @return  0 if successful, -1 if the mapping could not be released.
+ */
+int mapped_pgm_close(MAPPED_PGM *map);
+
+#endif
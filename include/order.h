@@ -0,0 +1,98 @@
+#ifndef ORDER_H
+#define ORDER_H
+
+#include "bdd.h"
+
+/*
+ * Variable orders.  The levels of a BDD for a 2^d x 2^d image each split
+ * its region in half, and the order in which they split rows and columns
+ * determines how many nodes the image takes: bdd_from_raster always
+ * alternates, with even levels splitting rows and odd levels columns, but
+ * an image made of horizontal strips, say, shares more if all of the rows
+ * are split first.  An order is an int whose bit l-1 is set if level l
+ * splits columns, so that exactly d of the 2d bits are set; within each
+ * axis the most significant bit is always split first, so that every node
+ * still stands for a rectangle.
+ */
+#define BDD_ORDER_INTERLEAVED 0  // Row bit, then column bit, as bdd_from_raster.
+#define BDD_ORDER_COLUMNS_FIRST 1  // Column bit, then row bit.
+#define BDD_ORDER_ROW_BLOCKS 2  // All of the row bits, then all of the column bits.
+#define BDD_ORDER_COLUMN_BLOCKS 3  // All of the column bits, then all of the row bits.
+#define BDD_ORDER_SEARCH 4  // Whichever order bdd_order_search finds.
+
+/**
+ * Give the order of one of the named kinds for an image of a given level.
+ *
+ * @param kind  BDD_ORDER_INTERLEAVED, BDD_ORDER_COLUMNS_FIRST,
+ * BDD_ORDER_ROW_BLOCKS or BDD_ORDER_COLUMN_BLOCKS.
+ * @param level  The level of the image, as given by bdd_min_level.
+ * @return  The order.
+ */
+int bdd_order_of_kind(int kind, int level);
+
+/**
+ * Determine whether an int is an order for an image of a given level.
+ *
+ * @param order  The int.
+ * @param level  The level of the image, as given by bdd_min_level.
+ * @return  Nonzero if it is.
+ */
+int bdd_order_valid(int order, int level);
+
+/**
+ * Construct the BDD of a w x h raster with its levels in a given order,
+ * treating pixels outside the raster as 0, as bdd_from_raster does.  The
+ * nodes are hash-consed with all others, but only the functions that take
+ * an order decode them correctly.
+ *
+ * @param w  The width of the raster.
+ * @param h  The height of the raster.
+ * @param raster  The raster, stored in row-major order.
+ * @param order  The order, valid for bdd_min_level(w, h).
+ * @return  The root of the BDD, or NULL if the node table is full or any
+ * other error occurs.
+ */
+BDD_NODE *bdd_from_raster_ordered(int w, int h, unsigned char *raster, int order);
+
+/**
+ * Decode a BDD built with its levels in a given order into a w x h raster.
+ *
+ * @param node  The root of the BDD.
+ * @param w  The width of the raster.
+ * @param h  The height of the raster.
+ * @param raster  The raster, stored in row-major order.
+ * @param order  The order, valid for bdd_min_level(w, h).
+ */
+void bdd_to_raster_ordered(BDD_NODE *node, int w, int h, unsigned char *raster, int order);
+
+/**
+ * Rebuild a BDD built with its levels in a given order as the BDD of the
+ * same image in the order of bdd_from_raster, which the other operations
+ * expect.  The image is decoded into a temporary raster.
+ *
+ * @param node  The root of the BDD.
+ * @param w  The width of the image.
+ * @param h  The height of the image.
+ * @param order  The order, valid for bdd_min_level(w, h).
+ * @return  The root of the rebuilt BDD, or NULL if any error occurs.
+ */
+BDD_NODE *bdd_order_standardize(BDD_NODE *node, int w, int h, int order);
+
+/**
+ * Find an order in which a raster takes few nodes.  Each of the four named
+ * orders is tried, and then, starting from the best of them, adjacent row
+ * and column levels are swapped one pair at a time (a local form of
+ * sifting) for as long as a swap removes nodes.  Each order tried builds
+ * the whole BDD, in a separate context, so that the nodes of rejected
+ * orders do not fill the node table of the current one.
+ *
+ * @param w  The width of the raster.
+ * @param h  The height of the raster.
+ * @param raster  The raster, stored in row-major order.
+ * @param nodesp  If not NULL, set to the number of nodes (excluding leaves)
+ * the raster takes in the order found.
+ * @return  The order found, or -1 if no order could be tried.
+ */
+int bdd_order_search(int w, int h, unsigned char *raster, int *nodesp);
+
+#endif
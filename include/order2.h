@@ -0,0 +1,16 @@
+#ifndef ORDER2_H
+#define ORDER2_H
+
+/* The number of rows and columns of the region of a node at level l, in an order. */
+#define ORDER_COLS(order, l) (1 << __builtin_popcount((order) & ((1u << (l)) - 1)))
+#define ORDER_ROWS(order, l) (1 << ((l) - __builtin_popcount((order) & ((1u << (l)) - 1))))
+#define ORDER_SPLITS_COLS(order, l) (((order) >> ((l) - 1)) & 1)
+
+/* Passes of adjacent swaps made by bdd_order_search, at most. */
+#define ORDER_SEARCH_PASSES 4
+
+int bdd_from_raster_ordered_recurse(int level, int row, int col);
+void bdd_to_raster_ordered_recurse(BDD_NODE *node, int level, int row, int col);
+int order_count_nodes(int w, int h, unsigned char *raster, int order);
+
+#endif
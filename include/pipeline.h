@@ -0,0 +1,145 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+/*
+ * Staged conversions, in which a reader thread, the thread doing the
+ * conversion and a writer thread run at the same time, so that the time
+ * spent waiting for a slow disk or pipe overlaps with building, decoding and
+ * serializing the BDD.  Used for pgm_to_birp and birp_to_pgm when
+ * PIPELINE_OPTION is set (--pipeline).
+ */
+
+/* Bytes moved by a stage's thread in one call to fread or fwrite. */
+#define PIPE_CHUNK (1 << 16)
+/* Bytes buffered by a stream between the conversion and its thread. */
+#define PIPE_STREAM_CAPACITY (1 << 20)
+/* Rows of each band decoded before it is handed to the writer, at least. */
+#define PIPE_BAND_BYTES (1 << 18)
+
+/*
+ * A raster moved between a file and memory by a thread, in order, while
+ * another thread works on the part already moved (when reading) or hands
+ * over the part it has finished (when writing).
+ */
+typedef struct pipe_raster {
+    FILE *file;
+    unsigned char *data;
+    size_t size;
+    size_t ready;       // Bytes read into data, or finished and ready to write.
+    size_t written;     // Bytes written out, when writing.
+    int writing;
+    int finished;       // Set when no more bytes will be made ready.
+    int error;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_t thread;
+} PIPE_RASTER;
+
+/*
+ * A stream buffered in a bounded ring between the thread using it, through
+ * a FILE opened with fopencookie, and a thread reading ahead from, or
+ * writing behind to, the underlying stream.
+ */
+typedef struct pipe_stream {
+    FILE *file;
+    unsigned char *ring;
+    size_t head;        // Total bytes taken out of the ring.
+    size_t tail;        // Total bytes put into the ring.
+    int writing;
+    int closing;
+    int eof;
+    int error;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    pthread_t thread;
+} PIPE_STREAM;
+
+/**
+ * Start a thread reading a raster of a specified size from a stream.
+ *
+ * @param raster  The state of the transfer, to be passed to the other functions.
+ * @param file  The stream, positioned at the first pixel.
+ * @param data  Where to store the pixels.
+ * @param size  The number of bytes to read.
+ * @return  0 if the thread was started, -1 otherwise.
+ */
+int pipe_raster_read(PIPE_RASTER *raster, FILE *file, unsigned char *data, size_t size);
+
+/**
+ * Start a thread writing a raster to a stream as its bytes are made ready
+ * by pipe_raster_ready.
+ *
+ * @param raster  The state of the transfer, to be passed to the other functions.
+ * @param file  The stream.
+ * @param data  The pixels, to be filled in order.
+ * @param size  The number of bytes to write.
+ * @return  0 if the thread was started, -1 otherwise.
+ */
+int pipe_raster_write(PIPE_RASTER *raster, FILE *file, unsigned char *data, size_t size);
+
+/**
+ * Wait until the first bytes of a raster being read have arrived.
+ *
+ * @param raster  The transfer started by pipe_raster_read.
+ * @param bytes  The number of bytes needed.
+ * @return  0 once they have, -1 if the input ended or failed first.
+ */
+int pipe_raster_wait(PIPE_RASTER *raster, size_t bytes);
+
+/**
+ * Hand the first bytes of a raster being written over to the writer.
+ *
+ * @param raster  The transfer started by pipe_raster_write.
+ * @param bytes  The number of bytes, from the start, that are finished.
+ */
+void pipe_raster_ready(PIPE_RASTER *raster, size_t bytes);
+
+/**
+ * Wait for the thread of a transfer to finish, abandoning any bytes not yet
+ * made ready, and release it.
+ *
+ * @param raster  The transfer.
+ * @return  0 if the whole raster was moved, -1 otherwise.
+ */
+int pipe_raster_finish(PIPE_RASTER *raster);
+
+/**
+ * Open a stream that reads ahead from another on a separate thread.
+ * Closing the new stream stops the thread, which may by then have read
+ * more of the underlying stream than was read from the new one.
+ *
+ * @param stream  The state of the stream, which must outlive it.
+ * @param file  The underlying stream.
+ * @return  The new stream, or NULL if it cannot be opened.
+ */
+FILE *pipe_stream_read(PIPE_STREAM *stream, FILE *file);
+
+/**
+ * Open a stream that writes behind to another on a separate thread.
+ * Closing the new stream waits until everything has been written and
+ * flushed, and fails if any of it could not be.
+ *
+ * @param stream  The state of the stream, which must outlive it.
+ * @param file  The underlying stream.
+ * @return  The new stream, or NULL if it cannot be opened.
+ */
+FILE *pipe_stream_write(PIPE_STREAM *stream, FILE *file);
+
+/**
+ * pgm_to_birp with the raster read on one thread while the BDD is built
+ * from the rows already read, and the serialized BDD written behind on
+ * another.
+ */
+int pgm_to_birp_pipelined(FILE *in, FILE *out);
+
+/**
+ * birp_to_pgm with the input read ahead on one thread while it is
+ * deserialized, and the raster decoded in bands of rows, each written out
+ * on another thread while the next is decoded.
+ */
+int birp_to_pgm_pipelined(FILE *in, FILE *out);
+
+#endif
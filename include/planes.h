@@ -0,0 +1,89 @@
+#ifndef PLANES_H
+#define PLANES_H
+
+#include <stdio.h>
+
+#include "bdd.h"
+
+/*
+ * Images as bit planes: BDD_PLANES binary BDDs, the k-th holding bit k of
+ * each pixel value (or of its Gray code, v ^ (v >> 1), so that neighbouring
+ * values differ in one plane only), as leaves 0 and 1.  On photographic
+ * images, whose nodes are nearly all distinct, the high planes are smooth
+ * and share well even when the pixel values do not.  The planes of a
+ * 2^d x 2^d image, whose nodes have levels up to 2d, are kept under a
+ * single root with three further levels 2d+1, 2d+2 and 2d+3 that select
+ * the plane by the bits of its number, so that they are hash-consed,
+ * serialized and counted together.
+ */
+#define BDD_PLANES 8
+
+/* How birp output is encoded (see img_write_birp_encoded). */
+#define BDD_ENCODING_NODES 0  // One BDD with a leaf per pixel value, as by img_write_birp.
+#define BDD_ENCODING_PLANES 1  // Bit planes of the pixel values.
+#define BDD_ENCODING_GRAY 2  // Bit planes of the Gray codes of the pixel values.
+#define BDD_ENCODING_AUTO 3  // Whichever of the three serializes to the fewest bytes.
+
+/**
+ * Split an image into its bit planes.
+ *
+ * @param node  The BDD node that represents the image.
+ * @param level  The level of the image, at least that of the node.
+ * @param gray  Nonzero to split the Gray codes of the pixel values.
+ * @return  The root of the planes, or NULL if the node table is full or
+ * the level leaves no room for the three levels that select the plane.
+ */
+BDD_NODE *bdd_to_planes(BDD_NODE *node, int level, int gray);
+
+/**
+ * Find one plane under the root of the planes.
+ *
+ * @param planes  The root of the planes.
+ * @param level  The level of the image, as given to bdd_to_planes.
+ * @param bit  The number of the plane, from 0 for the least significant bit.
+ * @return  The BDD node that represents the plane, with leaves 0 and 1.
+ */
+BDD_NODE *bdd_plane(BDD_NODE *planes, int level, int bit);
+
+/**
+ * Recombine bit planes into the image they were split from, by walking all
+ * of the planes at once and stopping wherever all of them are leaves, so
+ * that uniform regions cost one visit whatever their size.  Tuples of nodes
+ * already combined are found again through a cache.
+ *
+ * @param planes  The root of the planes.
+ * @param level  The level of the image, as given to bdd_to_planes.
+ * @param gray  Nonzero if the planes hold Gray codes.
+ * @return  The BDD node that represents the image, or NULL if the node
+ * table is full or any other error occurs.
+ */
+BDD_NODE *bdd_from_planes(BDD_NODE *planes, int level, int gray);
+
+/**
+ * Compute the number of bytes bdd_serialize writes for a BDD.
+ *
+ * @param node  The BDD node.
+ * @return  The number of bytes, or -1 if memory cannot be allocated.
+ */
+long bdd_serialized_size(BDD_NODE *node);
+
+/**
+ * Write an image to an output stream in BIRP format, in a specified
+ * encoding.  With BDD_ENCODING_AUTO, both kinds of planes are built and
+ * the smallest of the three encodings is written; planes that do not fit
+ * in the node table are not considered.
+ *
+ * @param node  The BDD node that represents the image.
+ * @param w  Width of the image raster.
+ * @param h  Height of the image raster.
+ * @param encoding  One of the BDD_ENCODING values.
+ * @param out  Stream to which to write the BIRP data.
+ * @param sizes  If not NULL, with BDD_ENCODING_AUTO, set to the number of
+ * bytes of the image in each of the three encodings (indexed by their
+ * BDD_ENCODING values), or -1 for planes that could not be built.
+ * @return  The encoding written (never BDD_ENCODING_AUTO), or -1 if any
+ * error occurs.
+ */
+int img_write_birp_encoded(BDD_NODE *node, int w, int h, int encoding, FILE *out, long *sizes);
+
+#endif
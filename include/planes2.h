@@ -0,0 +1,22 @@
+#ifndef PLANES2_H
+#define PLANES2_H
+
+#define PLANES_CACHE_SIZE (1 << 16)
+
+/* An entry of the cache of bdd_from_planes: a tuple of plane nodes at a level, and their image. */
+typedef struct planes_cache_entry {
+    int level;  // -1 if the entry is empty.
+    int index;
+    int *planes;  // BDD_PLANES node indices.
+} PLANES_CACHE_ENTRY;
+
+/*
+ * The block of a node at a level that holds an image of that level, as a
+ * root above it stands for a larger square with the image in its corner.
+ */
+BDD_NODE *planes_image(BDD_NODE *node, int level);
+unsigned char gray_decode(unsigned char code);
+int bdd_from_planes_recurse(BDD_NODE **planes, int level, int gray);
+PLANES_CACHE_ENTRY *planes_cache_find(BDD_NODE **planes, int level);
+
+#endif
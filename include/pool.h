@@ -0,0 +1,122 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ * A fixed-size pool of worker threads with work stealing.  Each worker has
+ * its own deque of tasks: it pushes and pops tasks at the bottom of its own
+ * deque, so that a task and the subtasks it spawns run on the same thread
+ * with warm caches, and when its deque is empty it steals from the top of
+ * another worker's deque, where the oldest (and typically largest) tasks
+ * are.  Tasks submitted from outside the pool are dealt out to the workers
+ * in turn.
+ *
+ * Tasks are counted in groups, so that a thread can wait for a set of tasks
+ * to finish.  A thread waiting for a group runs other queued tasks while it
+ * waits, which allows tasks to submit subtasks and wait for them without
+ * tying up a worker.
+ */
+
+typedef void (*POOL_FUNC)(void *arg);
+
+typedef struct pool_task {
+    POOL_FUNC func;
+    void *arg;
+    struct pool_group *group;
+} POOL_TASK;
+
+typedef struct pool_deque {
+    pthread_mutex_t lock;
+    POOL_TASK *tasks;  // Ring buffer of capacity entries.
+    int capacity;
+    long top;          // Next task to be stolen.
+    long bottom;       // One past the last task pushed.
+} POOL_DEQUE;
+
+typedef struct pool {
+    int num_threads;
+    pthread_t *threads;
+    POOL_DEQUE *deques;      // One per worker.
+    atomic_int queued;       // Tasks in all deques.
+    atomic_uint next;        // Worker to receive the next external submission.
+    int shutdown;
+    pthread_mutex_t lock;    // Protects sleeping, with wakeup.
+    pthread_cond_t wakeup;   // Signalled when a task is queued or a group finishes.
+} POOL;
+
+typedef struct pool_group {
+    atomic_int pending;  // Tasks submitted and not yet finished.
+} POOL_GROUP;
+
+/**
+ * Start a pool of worker threads.
+ *
+ * @param num_threads  The number of workers, at least 1.
+ * @return  The pool, or NULL if it cannot be created.
+ */
+POOL *pool_create(int num_threads);
+
+/**
+ * Wait for all queued tasks to finish, then stop the workers and free the pool.
+ *
+ * @param pool  The pool to destroy.
+ */
+void pool_destroy(POOL *pool);
+
+/**
+ * Queue a task to be run by the pool.  When called from a worker, the task
+ * goes onto that worker's own deque.
+ *
+ * @param pool  The pool in which to run the task.
+ * @param group  The group in which to count the task, which must have been
+ * zeroed before its first use.
+ * @param func  The function to run.
+ * @param arg  The argument to pass to func.
+ * @return  0 if successful, -1 if memory for the task cannot be allocated.
+ */
+int pool_submit(POOL *pool, POOL_GROUP *group, POOL_FUNC func, void *arg);
+
+/**
+ * Wait until every task in a group has finished, running queued tasks in
+ * the meantime.
+ *
+ * @param pool  The pool running the tasks.
+ * @param group  The group for which to wait.
+ */
+void pool_wait(POOL *pool, POOL_GROUP *group);
+
+/**
+ * The index of the calling worker within its pool.
+ *
+ * @return  A value in [0, num_threads) in a worker thread, or -1 in any
+ * other thread.
+ */
+int pool_worker_index();
+
+/**
+ * Set the number of threads with which single operations on large images
+ * (such as building one BDD) are run, counting the thread that starts the
+ * operation, which works alongside the pool.  The default is the number of
+ * online CPUs.  This must not be called while such an operation is running.
+ *
+ * @param num_threads  The number of threads; 1 makes every operation sequential.
+ */
+void pool_set_threads(int num_threads);
+
+/**
+ * @return  The number of threads set by pool_set_threads.
+ */
+int pool_threads();
+
+/**
+ * The process-wide pool used to parallelize single operations, with
+ * pool_threads() - 1 workers, created on first use.
+ *
+ * @return  The pool, or NULL if pool_threads() is 1 or the pool cannot be
+ * created, in which case the operation should run sequentially.
+ */
+POOL *pool_shared();
+
+#endif
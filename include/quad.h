@@ -0,0 +1,141 @@
+#ifndef QUAD_H
+#define QUAD_H
+
+#include <stdio.h>
+
+#include "bdd.h"
+
+/*
+ * Square images as quadtrees: a node at level k covers a 2^k x 2^k square
+ * and has four children, one per quadrant, each covering a square at level
+ * k - 1.  A quadtree node thus does the work of a BDD node at level 2k and
+ * the two at level 2k - 1 below it, so a walk to a pixel takes half as many
+ * steps.  As with BDDs, indices below BDD_NUM_LEAVES are the leaves, whose
+ * values are their indices, a node whose four children are equal is never
+ * created (the child stands for it), and so a node at level k also stands
+ * for any larger square tiled with copies of it, so that every image has
+ * exactly one representation.
+ *
+ * The nodes live in a unique table of their own in the current context,
+ * apart from the BDD nodes, and are discarded with them by bdd_reset_nodes.
+ * Since the table moves as it grows, nodes are referred to by index rather
+ * than by pointer.  Images are built and walked by one thread at a time.
+ */
+#define BDD_QUAD_NODES_MAX (1 << 20)
+
+/* Quadrants of a node, as numbered by QUAD_NODE_CHILD. */
+#define BDD_QUAD_TOP_LEFT (0)
+#define BDD_QUAD_TOP_RIGHT (1)
+#define BDD_QUAD_BOTTOM_LEFT (2)
+#define BDD_QUAD_BOTTOM_RIGHT (3)
+
+typedef struct quad_node {
+    int level;
+    int top_left;
+    int top_right;
+    int bottom_left;
+    int bottom_right;
+} QUAD_NODE;
+
+/* The child of a node in quadrant q, one of the BDD_QUAD constants. */
+#define QUAD_NODE_CHILD(np, q) \
+    ((q) == BDD_QUAD_TOP_LEFT ? (np) -> top_left : (q) == BDD_QUAD_TOP_RIGHT ? (np) -> top_right : \
+     (q) == BDD_QUAD_BOTTOM_LEFT ? (np) -> bottom_left : (np) -> bottom_right)
+
+#define bdd_quad_nodes (birp_context -> quad_nodes)
+
+/**
+ * Look up, in the quadtree table, the node with a given level and
+ * children, inserting it if it does not already exist.
+ *
+ * @param level  The level of the node, at least 1.
+ * @param top_left  The index of its top left child.
+ * @param top_right  The index of its top right child.
+ * @param bottom_left  The index of its bottom left child.
+ * @param bottom_right  The index of its bottom right child.
+ * @return  The index of the node, or of the child if all four are equal,
+ * or -1 if the table is full or memory cannot be allocated.
+ */
+int bdd_quad_lookup(int level, int top_left, int top_right, int bottom_left, int bottom_right);
+
+/**
+ * Discard every quadtree node, emptying the table.
+ */
+void bdd_quad_reset();
+
+/**
+ * Construct the quadtree of a w x h raster, padded with 0 to the smallest
+ * enclosing square whose side is a power of two, as bdd_from_raster does.
+ *
+ * @param w  The width of the raster.
+ * @param h  The height of the raster.
+ * @param raster  The raster, in row-major order.
+ * @return  The index of the root, or -1 if the table is full or any other
+ * error occurs.
+ */
+int bdd_quad_from_raster(int w, int h, unsigned char *raster);
+
+/**
+ * Decode a quadtree into a w x h raster, by storing each uniform square at
+ * once.
+ *
+ * @param quad  The index of the root, at level bdd_min_level(w, h) / 2 or below.
+ * @param w  The width of the raster.
+ * @param h  The height of the raster.
+ * @param raster  The raster, in row-major order.
+ */
+void bdd_quad_to_raster(int quad, int w, int h, unsigned char *raster);
+
+/**
+ * Convert a BDD into a quadtree.  Each quadtree node is made from a BDD
+ * node at an even level and the nodes at the odd level below it, which are
+ * read through the LEFT and RIGHT macros so that skipped levels are handled.
+ * A node at an odd level is taken to represent the enclosing square at the
+ * next even level, as in bdd_rotate.
+ *
+ * @param node  The BDD node that represents the image.
+ * @return  The index of the quadtree node, or -1 if the table is full or
+ * any other error occurs.
+ */
+int bdd_quad_from_bdd(BDD_NODE *node);
+
+/**
+ * Convert a quadtree back into a BDD, with a node at level 2k for each
+ * quadtree node at level k and nodes at level 2k - 1 for its halves.
+ *
+ * @param quad  The index of the quadtree node.
+ * @return  The BDD node that represents the same image, or NULL if the
+ * node table is full or any other error occurs.
+ */
+BDD_NODE *bdd_quad_to_bdd(int quad);
+
+/**
+ * Rotate the image of a quadtree 90 degrees counterclockwise, as
+ * bdd_rotate does, by moving each node's children one quadrant round.
+ *
+ * @param quad  The index of the quadtree node.
+ * @return  The index of the rotated node, or -1 if the table is full or any
+ * other error occurs.
+ */
+int bdd_quad_rotate(int quad);
+
+/**
+ * Serialize a quadtree in the format of bdd_serialize, into which it is
+ * translated as it is written, so that the output is byte for byte that of
+ * bdd_serialize on bdd_quad_to_bdd(quad) and is read by bdd_deserialize.
+ *
+ * @param quad  The index of the quadtree node.
+ * @param out  The output stream.
+ * @return  0 if successful, -1 if memory cannot be allocated.
+ */
+int bdd_quad_serialize(int quad, FILE *out);
+
+/**
+ * Count the distinct quadtree nodes reachable from a node, including leaves.
+ *
+ * @param quad  The index of the quadtree node.
+ * @return  The number of nodes, or -1 if memory cannot be allocated.
+ */
+int bdd_quad_count_nodes(int quad);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef QUAD2_H
+#define QUAD2_H
+
+#include <stdio.h>
+
+#define bdd_quad_count (birp_context -> quad_count)
+#define bdd_quad_hash_map (birp_context -> quad_hash_map)
+#define bdd_quad_hash_size (birp_context -> quad_hash_size)
+
+/* Index just past the last quadtree node. */
+#define QUAD_END (BDD_NUM_LEAVES + bdd_quad_count)
+
+/*
+ * Index of the child in quadrant q of a node interpreted at level l, taking
+ * into account the fact that a node below level l (or a leaf) stands for
+ * the square tiled with copies of it.  The table may move whenever a node
+ * is inserted, so this is evaluated afresh rather than through a pointer.
+ */
+#define QUAD_CHILD(index, q, l) \
+    ((index) < BDD_NUM_LEAVES || (l) > (bdd_quad_nodes + (index)) -> level ? \
+     (index) : QUAD_NODE_CHILD(bdd_quad_nodes + (index), q))
+
+/*
+ * A node at an odd BDD level met by bdd_quad_serialize, as the half of a
+ * quadtree node, with the serial number it was written under; 0 marks an
+ * empty slot of the open-addressed table that holds them.
+ */
+typedef struct quad_half {
+    int level;
+    int left;
+    int right;
+    int serial;
+} QUAD_HALF;
+
+unsigned int quad_hash_function(int level, int top_left, int top_right, int bottom_left, int bottom_right);
+/*
+ * Make room for one more node in the table and keep the load factor of the
+ * unique table at most 0.5.  Returns 0 on success, -1 on error.
+ */
+int quad_store_reserve();
+int quad_hash_grow();
+int bdd_quad_from_raster_recurse(int w, int h, unsigned char *raster, int level, int row, int col);
+void bdd_quad_to_raster_recurse(int quad, int level, int row, int col, int w, int h, unsigned char *raster);
+int bdd_quad_from_bdd_recurse(BDD_NODE *node);
+int bdd_quad_to_bdd_recurse(int quad);
+int bdd_quad_rotate_recurse(int quad);
+int bdd_quad_serialize_recurse(int quad, FILE *out, int serial_num, int *serialp);
+int bdd_quad_serialize_half(int level, int left, int right, FILE *out, int serial_num, int *serialp);
+int bdd_quad_count_nodes_recurse(int quad);
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include "bdd.h"
+
+/*
+ * A rectangle of pixels, given by its first row and column and by the
+ * (exclusive) row and column just past its last pixel.  A box with
+ * row_min >= row_max or col_min >= col_max is empty.
+ */
+typedef struct bdd_box {
+    int row_min;
+    int col_min;
+    int row_max;
+    int col_max;
+} BDD_BOX;
+
+/*
+ * Cache of per-node subtree sums, indexed like the bdd_nodes array.
+ * Entry i holds the sum of all pixel values in the square (or, for odd
+ * levels, the 2:1 rectangle) represented by node i at its own level,
+ * or -1 if that sum has not been computed yet.  Nodes are never modified
+ * once inserted into the table, so entries remain valid for the lifetime
+ * of the node table.  The cache is allocated on first use.
+ */
+#define bdd_sum_table (birp_context -> sum_table)
+
+/**
+ * Obtain the sum of the pixel values represented by a BDD node, interpreted
+ * at its own level.  The sum is computed bottom-up on first use and cached
+ * in bdd_sum_table, so repeated calls cost O(1).
+ *
+ * @param node  The BDD node.
+ * @return  The sum of the values of the 2^level pixels covered by the node,
+ * or -1 if the sum cache could not be allocated.
+ */
+long long bdd_node_sum(BDD_NODE *node);
+
+/**
+ * Given a BDD node representing a w x h image, compute the sum of the pixel
+ * values inside the rectangle with top-left corner (row, col) and the given
+ * height and width.  The rectangle is clipped to the image bounds first.
+ * The BDD is traversed from the root, adding the cached sum of each node whose
+ * region is fully covered by the rectangle and skipping nodes whose region is
+ * disjoint from it, so that only partially covered quadrants are descended.
+ *
+ * @param node  The root of the BDD representing the image.
+ * @param w  The width of the image.
+ * @param h  The height of the image.
+ * @param row  Row index of the top-left corner of the rectangle.
+ * @param col  Column index of the top-left corner of the rectangle.
+ * @param height  Number of rows in the rectangle.
+ * @param width  Number of columns in the rectangle.
+ * @param countp  If non-NULL, pointer to a variable into which to store the
+ * number of pixels in the clipped rectangle.
+ * @return  The sum of the pixel values in the clipped rectangle, or -1 if
+ * the rectangle has negative size or any other error occurs.
+ */
+long long bdd_region_sum(BDD_NODE *node, int w, int h, int row, int col, int height, int width,
+                         long long *countp);
+
+/**
+ * Given a BDD node representing a w x h image, find the smallest rectangle
+ * containing every pixel whose value differs from a specified background
+ * value.  The bounding box of each node is computed once from the bounding
+ * boxes of its children, with uniform background subtrees contributing
+ * nothing, so the cost is proportional to the number of nodes rather than
+ * the number of pixels.  Only nodes straddling the right or bottom edge of
+ * the image are revisited with their position, so that the zero padding
+ * beyond the image is never counted as content.
+ *
+ * @param node  The root of the BDD representing the image.
+ * @param w  The width of the image.
+ * @param h  The height of the image.
+ * @param background  The background pixel value.
+ * @param rowp  Pointer to a variable into which to store the first row of the box.
+ * @param colp  Pointer to a variable into which to store the first column of the box.
+ * @param heightp  Pointer to a variable into which to store the height of the box.
+ * @param widthp  Pointer to a variable into which to store the width of the box.
+ * @return  1 if some pixel differs from the background, 0 if the image is
+ * entirely background (in which case the box is stored as 0 0 0 0),
+ * or -1 if any error occurs.
+ */
+int bdd_bounding_box(BDD_NODE *node, int w, int h, unsigned char background,
+                     int *rowp, int *colp, int *heightp, int *widthp);
+
+/**
+ * Given a BDD node representing a w x h image, construct a BDD representing
+ * the height x width sub-image whose top-left corner is at (row, col).
+ * The result is built directly from the source nodes: each block of the
+ * result overlaps a 2 x 2 grid of aligned source blocks at the same offset,
+ * so it is built once per distinct grid, and where the offset is zero the
+ * source block is reused as it is.  The cost thus follows the number of
+ * nodes rather than of pixels.
+ * Pixels of the sub-image lying outside the source image are zero.
+ *
+ * @param node  The root of the BDD representing the source image.
+ * @param w  The width of the source image.
+ * @param h  The height of the source image.
+ * @param row  Row of the source image at which the sub-image starts.
+ * @param col  Column of the source image at which the sub-image starts.
+ * @param height  Height of the sub-image.
+ * @param width  Width of the sub-image.
+ * @return  The root of the BDD representing the sub-image, or NULL if any
+ * error occurs.
+ */
+BDD_NODE *bdd_crop(BDD_NODE *node, int w, int h, int row, int col, int height, int width);
+
+/**
+ * Given a BDD node representing a w x h image, construct a BDD representing
+ * the same image with every pixel of a rectangle set to a value.  Only the
+ * nodes whose region the rectangle partly covers are rebuilt (through
+ * bdd_lookup, so that the result shares everything else with the original),
+ * regions it covers entirely become the value's leaf, and the rest of the
+ * original is reused as it is.  Painting a pixel therefore costs a number
+ * of node lookups proportional to the depth of the BDD, and painting a
+ * rectangle one proportional to its perimeter.  The rectangle is clipped to
+ * the image first, so that the zero padding beyond it is left alone.
+ *
+ * @param node  The root of the BDD representing the image.
+ * @param w  The width of the image.
+ * @param h  The height of the image.
+ * @param row  Row index of the top-left corner of the rectangle.
+ * @param col  Column index of the top-left corner of the rectangle.
+ * @param height  Number of rows in the rectangle.
+ * @param width  Number of columns in the rectangle.
+ * @param value  The new value of the pixels.
+ * @return  The root of the BDD representing the painted image (the original
+ * root if the clipped rectangle is empty), or NULL if the rectangle has
+ * negative size, the node table is full or any other error occurs.
+ */
+BDD_NODE *bdd_fill_rect(BDD_NODE *node, int w, int h, int row, int col, int height, int width,
+                        unsigned char value);
+
+/**
+ * Set one pixel of an image; bdd_fill_rect for a 1 x 1 rectangle.
+ */
+BDD_NODE *bdd_set_pixel(BDD_NODE *node, int w, int h, int row, int col, unsigned char value);
+
+#endif
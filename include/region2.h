@@ -0,0 +1,34 @@
+#ifndef REGION2_H
+#define REGION2_H
+
+#define bdd_sum_table_size (birp_context -> sum_table_size)  // Entries allocated in bdd_sum_table.
+
+long long bdd_level_sum(BDD_NODE *node, int level);
+long long bdd_region_sum_recurse(BDD_NODE *node, int level, int row, int col,
+                                 int row_min, int row_max, int col_min, int col_max);
+BDD_BOX bdd_local_box(BDD_NODE *node, int level, int background);
+void bdd_bounding_box_recurse(BDD_NODE *node, int level, int row, int col, int w, int h,
+                              int background, BDD_BOX *box);
+
+/*
+ * A window of the source cropped by bdd_crop: the grid of source blocks it
+ * overlaps, its level and clip bits in key, and the resulting node plus
+ * one, 0 marking an empty slot.
+ */
+typedef struct bdd_crop_entry {
+    int key;
+    int top_left;
+    int top_right;
+    int bottom_left;
+    int bottom_right;
+    int result;
+} BDD_CROP_ENTRY;
+#define BDD_CROP_CLIP_ROWS 0x1
+#define BDD_CROP_CLIP_COLS 0x2
+
+int bdd_crop_block(BDD_NODE *src, int src_level, int level, int row, int col);
+int bdd_crop_recurse(int level, int top_left, int top_right, int bottom_left, int bottom_right, int clip);
+int bdd_fill_rect_recurse(BDD_NODE *node, int level, int row, int col, int row_min, int row_max,
+                          int col_min, int col_max, unsigned char value);
+
+#endif
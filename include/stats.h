@@ -0,0 +1,97 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+/*
+ * Phases of a run, used to attribute wall-clock time.  Time is charged to
+ * whichever phase is current, so nested phases (for example serialization
+ * inside writing a birp file) are counted exclusively.
+ */
+#define STATS_PHASE_OTHER 0
+#define STATS_PHASE_READ 1       // Parsing input, including bdd_deserialize.
+#define STATS_PHASE_BUILD 2      // bdd_from_raster and lossy encoding.
+#define STATS_PHASE_TRANSFORM 3  // Transformations of a BDD into another BDD.
+#define STATS_PHASE_DECODE 4     // bdd_to_raster.
+#define STATS_PHASE_SERIALIZE 5  // bdd_serialize.
+#define STATS_PHASE_WRITE 6      // Formatting and flushing output.
+#define STATS_NUM_PHASES 7
+
+/* Probe lengths are bucketed by powers of two: 0, 1, 2-3, 4-7, ... */
+#define STATS_PROBE_BUCKETS 24
+
+/*
+ * Counters collected while stats_enabled is set.  They are only ever touched
+ * through the STATS macro, so a run without --stats pays one predictable
+ * branch per counter, and a build with -DNO_STATS pays nothing at all.
+ */
+typedef struct birp_stats {
+    double *phase_seconds;       // STATS_NUM_PHASES entries.
+    long long *probe_histogram;  // STATS_PROBE_BUCKETS entries.
+    long long nodes_created;     // bdd_lookup calls that inserted a node.
+    long long nodes_reused;      // bdd_lookup calls that found an existing node.
+    long long nodes_collapsed;   // bdd_lookup calls with equal children.
+    long long slots_probed;      // Unique-table slots examined by bdd_lookup.
+    long long nodes_examined;    // Nodes read because their fingerprint matched.
+    long long memo_lookups;      // Memo-table probes in map, zoom, serialize, sums.
+    long long memo_hits;         // Probes that found a previous result.
+    int peak_node_index;         // Largest current_bdd_node_index seen.
+    long long bytes_read;
+    long long bytes_written;
+} BIRP_STATS;
+
+extern int stats_enabled;
+extern BIRP_STATS birp_stats;
+
+#ifdef NO_STATS
+#define STATS(stmt) do { } while (0)
+#else
+#define STATS(stmt) do { if (stats_enabled) { stmt; } } while (0)
+#endif
+
+/**
+ * Turn on collection of statistics, clearing all counters and starting the
+ * clock in STATS_PHASE_OTHER.
+ *
+ * @return  0 if successful, -1 if memory for the counters cannot be allocated.
+ */
+int stats_enable();
+
+/**
+ * Make a phase current, charging the time elapsed since the last switch to
+ * the phase that was current until now.  Does nothing unless stats are enabled.
+ *
+ * @param phase  One of the STATS_PHASE_* values.
+ * @return  The phase that was current before the call, so that a nested
+ * phase can restore it.
+ */
+int stats_phase(int phase);
+
+/**
+ * Record the number of slots examined past the home slot by one probe of
+ * the unique table.
+ *
+ * @param probes  The probe length.
+ */
+void stats_record_probe(long long probes);
+
+/**
+ * Wrap a stream so that the bytes passing through it are added to
+ * birp_stats.bytes_read or birp_stats.bytes_written.
+ *
+ * @param stream  The underlying stream, which is not closed by the wrapper.
+ * @param mode  "r" to count bytes read or "w" to count bytes written.
+ * @return  The counting stream, or the underlying stream itself if stats are
+ * not enabled or the wrapper cannot be created.
+ */
+FILE *stats_counting_stream(FILE *stream, char *mode);
+
+/**
+ * Print all collected statistics to a stream, in a human-readable form.
+ * Any counting output stream should be flushed first.
+ *
+ * @param out  The stream to which to print, normally stderr.
+ */
+void stats_report(FILE *out);
+
+#endif
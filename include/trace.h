@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Number of events kept in the in-memory ring buffer.  Once it is full the
+ * oldest events are overwritten, so a long run keeps its most recent history
+ * and memory use stays fixed.
+ */
+#define TRACE_RING_SIZE (1 << 16)
+
+/*
+ * One begin ('B') or end ('E') event.  The name must be a string literal
+ * (or otherwise outlive the trace), since only the pointer is recorded.
+ */
+typedef struct trace_event {
+    const char *name;
+    double timestamp;  // Microseconds since trace_enable.
+    int nodes;         // current_bdd_node_index when the event was recorded.
+    char phase;
+} TRACE_EVENT;
+
+extern int trace_enabled;
+
+#ifdef NO_TRACE
+#define TRACE_BEGIN(name) do { } while (0)
+#define TRACE_END(name) do { } while (0)
+#else
+#define TRACE_BEGIN(name) do { if (trace_enabled) { trace_event(name, 'B'); } } while (0)
+#define TRACE_END(name) do { if (trace_enabled) { trace_event(name, 'E'); } } while (0)
+#endif
+
+/**
+ * Turn on tracing, allocating the ring buffer and starting the clock.
+ *
+ * @return  0 if successful, -1 if the ring buffer cannot be allocated.
+ */
+int trace_enable();
+
+/**
+ * Record an event in the ring buffer.  No I/O or allocation takes place,
+ * so this is cheap enough to leave on around every major operation.
+ *
+ * @param name  The name of the operation, which must outlive the trace.
+ * @param phase  'B' when the operation begins or 'E' when it ends.
+ */
+void trace_event(const char *name, char phase);
+
+/**
+ * Write the events in the ring buffer to a file in the Chrome trace-event
+ * JSON format, loadable in chrome://tracing or Perfetto.  Each event has the
+ * node count at that moment as an argument ("nodes_begin" or "nodes_end").
+ * End events whose begin event has been overwritten are dropped, as are
+ * begin events that never ended, so the timeline is always well nested.
+ *
+ * @param path  The name of the file to write.
+ * @return  0 if successful, -1 if the file cannot be written.
+ */
+int trace_write(char *path);
+
+#endif
@@ -0,0 +1,370 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "bdd.h"
+#include "bdd2.h"
+#include "const.h"
+#include "birp2.h"
+#include "batch.h"
+#include "stats.h"
+#include "trace.h"
+#include "pool.h"
+
+char *batch_output_dir = NULL;
+char **batch_inputs = NULL;
+int batch_input_count = 0;
+int batch_jobs = 1;
+
+static double batch_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+static char *input_extension() {
+    return (global_options & 0x0F) == 0x1 ? ".pgm" : ".birp";
+}
+
+static char *output_extension() {
+    int output = global_options & 0xF0;
+    if (global_options & (REGION_QUERY_OPTION | BOUNDING_BOX_OPTION)) {
+        return ".txt";
+    } else if (output == 0x10) {
+        return ".pgm";
+    } else if (output == 0x30) {
+        return ".asc";
+    }
+    return ".birp";
+}
+
+static int has_suffix(const char *name, const char *suffix) {
+    const char *n = name;
+    const char *s = suffix;
+    while (*n != '\0') {
+        n++;
+    }
+    while (*s != '\0') {
+        s++;
+    }
+    while (s > suffix) {
+        if (n == name) {
+            return 0;
+        }
+        n--;
+        s--;
+        if (*n != *s) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Join a directory and a name, with the extension of the name (if any)
+ * replaced by a new one unless that is NULL.  Returns a malloc'd string,
+ * or NULL if memory cannot be allocated.
+ */
+static char *batch_path(char *dir, char *name, char *extension) {
+    char *base = name;
+    char *dot = NULL;
+    for (char *p = name; *p != '\0'; p++) {
+        if (*p == '/') {
+            base = p + 1;
+            dot = NULL;
+        } else if (*p == '.') {
+            dot = p;
+        }
+    }
+    int stem = 0;
+    while (*(base + stem) != '\0') {
+        stem++;
+    }
+    if (extension != NULL && dot != NULL && dot != base) { /* A leading dot is not an extension */
+        stem = dot - base;
+    } else if (extension == NULL) {
+        extension = "";
+    }
+    int size = snprintf(NULL, 0, "%s/%.*s%s", dir, stem, base, extension) + 1;
+    char *path = malloc(size);
+    if (path != NULL) {
+        snprintf(path, size, "%s/%.*s%s", dir, stem, base, extension);
+    }
+    return path;
+}
+
+/*
+ * Convert one file into another, with the streams counted for --stats.
+ * Returns 0 on success, -1 on error.
+ */
+static int batch_convert_file(char *in_path, char *out_path) {
+    struct stat in_stat;
+    struct stat out_stat;
+    if (stat(in_path, &in_stat) == 0 && stat(out_path, &out_stat) == 0
+        && in_stat.st_dev == out_stat.st_dev && in_stat.st_ino == out_stat.st_ino) {
+        fprintf(stderr, "%s: output would overwrite the input\n", in_path);
+        return -1;
+    }
+    FILE *in = fopen(in_path, "r");
+    if (in == NULL) {
+        fprintf(stderr, "%s: cannot open\n", in_path);
+        return -1;
+    }
+    FILE *out = fopen(out_path, "w+"); /* Readable too, so that PGM output can be mapped */
+    if (out == NULL) {
+        fprintf(stderr, "%s: cannot create\n", out_path);
+        fclose(in);
+        return -1;
+    }
+    FILE *counted_in = stats_counting_stream(in, "r");
+    FILE *counted_out = stats_counting_stream(out, "w");
+    int status = birp_convert(counted_in, counted_out);
+    if (counted_out != out && fclose(counted_out) == EOF) {
+        status = -1;
+    }
+    if (counted_in != in) {
+        fclose(counted_in);
+    }
+    fclose(in);
+    if (fclose(out) == EOF) {
+        status = -1;
+    }
+    return status;
+}
+
+/*
+ * One input file, and the outcome of converting it.
+ */
+typedef struct batch_job {
+    struct batch *batch;
+    char *in_path;
+    char *out_path;
+    int status;
+    double elapsed;    // Milliseconds.
+    int new_nodes;     // Nodes added to the table by this file.
+    int table_nodes;   // Nodes in the table afterwards.
+    int reset;         // Whether the table had to be emptied for this file.
+    int done;          // Set, under lock, once a worker has finished the job.
+} BATCH_JOB;
+
+typedef struct batch {
+    BATCH_JOB *jobs;
+    int count;
+    int capacity;
+    char *output_dir;
+    int options;                // global_options, for the workers' contexts.
+    char *query_path;           // region_query_path, likewise.
+    char *edit_path;            // edit_script_path, likewise.
+    BIRP_CONTEXT **contexts;    // One per worker, each created by its worker.
+    pthread_mutex_t lock;
+    pthread_cond_t finished;    // Broadcast when a job is done.
+} BATCH;
+
+/*
+ * Add a job for an input file, taking ownership of its malloc'd name.
+ * Returns 0 on success, -1 if memory cannot be allocated.
+ */
+static int batch_add_job(BATCH *batch, char *in_path) {
+    if ((batch) -> count == (batch) -> capacity) {
+        int capacity = (batch) -> capacity == 0 ? 64 : 2 * (batch) -> capacity;
+        BATCH_JOB *jobs = realloc((batch) -> jobs, capacity * sizeof(BATCH_JOB));
+        if (jobs == NULL) {
+            free(in_path);
+            return -1;
+        }
+        (batch) -> jobs = jobs;
+        (batch) -> capacity = capacity;
+    }
+    char *out_path = batch_path((batch) -> output_dir, in_path, output_extension());
+    if (out_path == NULL) {
+        free(in_path);
+        return -1;
+    }
+    BATCH_JOB job = { .batch = batch, .in_path = in_path, .out_path = out_path, .status = -1 };
+    *((batch) -> jobs + (batch) -> count) = job;
+    (batch) -> count++;
+    return 0;
+}
+
+static int batch_filter(const struct dirent *entry) {
+    return *((entry) -> d_name) != '.' && has_suffix((entry) -> d_name, input_extension());
+}
+
+/*
+ * Add jobs for an input, which is a file or a directory of files.
+ * Returns 0 on success, -1 if the directory cannot be read.
+ */
+static int batch_collect(BATCH *batch, char *input) {
+    struct stat input_stat;
+    if (stat(input, &input_stat) != 0 || !S_ISDIR(input_stat.st_mode)) {
+        int size = snprintf(NULL, 0, "%s", input) + 1;
+        char *copy = malloc(size);
+        if (copy == NULL) {
+            return -1;
+        }
+        snprintf(copy, size, "%s", input);
+        return batch_add_job(batch, copy);
+    }
+    struct dirent **entries;
+    int count = scandir(input, &entries, batch_filter, alphasort);
+    if (count == -1) {
+        return -1;
+    }
+    int status = 0;
+    for (int i = 0; i < count; i++) {
+        struct dirent *entry = *(entries + i);
+        char *path = batch_path(input, (entry) -> d_name, NULL);
+        struct stat path_stat;
+        if (path == NULL) {
+            status = -1;
+        } else if (stat(path, &path_stat) == 0 && S_ISREG(path_stat.st_mode)) {
+            if (batch_add_job(batch, path) == -1) {
+                status = -1;
+            }
+        } else {
+            free(path);
+        }
+        free(entry);
+    }
+    free(entries);
+    return status;
+}
+
+/*
+ * Convert the file of a job using the current context, recording the outcome.
+ */
+static void batch_run_job(BATCH_JOB *job) {
+    TRACE_BEGIN("batch file");
+    double start = batch_now();
+    int nodes = current_bdd_node_index;
+    (job) -> status = batch_convert_file((job) -> in_path, (job) -> out_path);
+    if ((job) -> status == -1 && current_bdd_node_index >= BDD_NODES_MAX && nodes > BDD_NUM_LEAVES) {
+        bdd_reset_nodes(); /* Full of earlier images' nodes, so try again with a fresh table */
+        nodes = BDD_NUM_LEAVES;
+        (job) -> reset = 1;
+        (job) -> status = batch_convert_file((job) -> in_path, (job) -> out_path);
+    }
+    (job) -> elapsed = batch_now() - start;
+    (job) -> new_nodes = current_bdd_node_index - nodes;
+    (job) -> table_nodes = current_bdd_node_index;
+    TRACE_END("batch file");
+}
+
+static void batch_report(BATCH_JOB *job, FILE *log) {
+    fprintf(log, "batch: %s -> %s: %s, %.3f ms, %d new nodes, %d in table%s\n", (job) -> in_path,
+            (job) -> out_path, (job) -> status == 0 ? "ok" : "failed", (job) -> elapsed,
+            (job) -> new_nodes, (job) -> table_nodes, (job) -> reset ? " (table reset)" : "");
+}
+
+/*
+ * Run a job on a pool worker, in that worker's own context.
+ */
+static void batch_task(void *arg) {
+    BATCH_JOB *job = arg;
+    BATCH *batch = (job) -> batch;
+    BIRP_CONTEXT **context = (batch) -> contexts + pool_worker_index();
+    if (*context == NULL) {
+        *context = birp_context_create();
+    }
+    if (*context != NULL) {
+        BIRP_CONTEXT *previous = birp_context_use(*context);
+        global_options = (batch) -> options;
+        region_query_path = (batch) -> query_path;
+        edit_script_path = (batch) -> edit_path;
+        batch_run_job(job);
+        birp_context_use(previous);
+    }
+    pthread_mutex_lock(&(batch) -> lock);
+    (job) -> done = 1;
+    pthread_cond_broadcast(&(batch) -> finished);
+    pthread_mutex_unlock(&(batch) -> lock);
+}
+
+/*
+ * Run the jobs on a pool of worker threads, reporting each in order as soon
+ * as it and all the jobs before it are done.  Returns 0 on success, -1 if
+ * the pool cannot be started.
+ */
+static int batch_parallel(BATCH *batch, int num_threads, FILE *log) {
+    (batch) -> contexts = calloc(num_threads, sizeof(BIRP_CONTEXT *));
+    POOL *pool = (batch) -> contexts == NULL ? NULL : pool_create(num_threads);
+    if (pool == NULL) {
+        free((batch) -> contexts);
+        return -1;
+    }
+    int image_threads = pool_threads();
+    pool_set_threads(1); /* The files are the unit of parallelism, so each one is built sequentially */
+    pthread_mutex_init(&(batch) -> lock, NULL);
+    pthread_cond_init(&(batch) -> finished, NULL);
+    POOL_GROUP group;
+    atomic_init(&group.pending, 0);
+    for (int i = 0; i < (batch) -> count; i++) {
+        BATCH_JOB *job = (batch) -> jobs + i;
+        if (pool_submit(pool, &group, batch_task, job) == -1) {
+            (job) -> done = 1; /* Reported as failed */
+        }
+    }
+    for (int i = 0; i < (batch) -> count; i++) {
+        BATCH_JOB *job = (batch) -> jobs + i;
+        pthread_mutex_lock(&(batch) -> lock);
+        while (!(job) -> done) {
+            pthread_cond_wait(&(batch) -> finished, &(batch) -> lock);
+        }
+        pthread_mutex_unlock(&(batch) -> lock);
+        batch_report(job, log);
+    }
+    pool_wait(pool, &group);
+    pool_destroy(pool);
+    pool_set_threads(image_threads);
+    for (int i = 0; i < num_threads; i++) {
+        birp_context_destroy(*((batch) -> contexts + i));
+    }
+    free((batch) -> contexts);
+    pthread_mutex_destroy(&(batch) -> lock);
+    pthread_cond_destroy(&(batch) -> finished);
+    return 0;
+}
+
+int birp_batch(char **inputs, int count, char *output_dir, int jobs, FILE *log) {
+    if (mkdir(output_dir, 0777) == -1 && errno != EEXIST) {
+        fprintf(log, "batch: cannot create directory %s\n", output_dir);
+        return -1;
+    }
+    double start = batch_now();
+    BATCH batch = { .output_dir = output_dir, .options = global_options, .query_path = region_query_path,
+                    .edit_path = edit_script_path };
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        if (batch_collect(&batch, *(inputs + i)) == -1) {
+            fprintf(log, "batch: %s: cannot read all files\n", *(inputs + i));
+            failed++;
+        }
+    }
+    int num_threads = jobs < batch.count ? jobs : batch.count;
+    if (num_threads > 1) {
+        if (batch_parallel(&batch, num_threads, log) == -1) {
+            fprintf(log, "batch: cannot start %d threads\n", num_threads);
+            num_threads = 1;
+        }
+    }
+    for (int i = 0; i < batch.count; i++) {
+        BATCH_JOB *job = batch.jobs + i;
+        if (num_threads <= 1) { /* In order, in the caller's context */
+            batch_run_job(job);
+            batch_report(job, log);
+        }
+        if ((job) -> status == -1) {
+            failed++;
+        }
+        free((job) -> in_path);
+        free((job) -> out_path);
+    }
+    free(batch.jobs);
+    fprintf(log, "batch: %d files, %d failed, %.3f ms, %d threads\n", batch.count, failed,
+            batch_now() - start, num_threads > 1 ? num_threads : 1);
+    return failed == 0 ? 0 : -1;
+}
@@ -1,24 +1,24 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <sched.h>
+#include <stdatomic.h>
 
 #include "bdd.h"
 #include "debug.h"
 #include "bdd2.h"
 #include "my_math.h"
+#include "region.h"
+#include "dihedral.h"
+#include "lut.h"
+#include "quad.h"
+#include "stats.h"
+#include "trace.h"
+#include "pool.h"
 
-/*
- * Macros that take a pointer to a BDD node and obtain pointers to its left
- * and right child nodes, taking into account the fact that a node N at level l
- * also implicitly represents nodes at levels l' > l whose left and right children
- * are equal (to N).
- *
- * You might find it useful to define macros to do other commonly occurring things;
- * such as converting between BDD node pointers and indices in the BDD node table.
- */
-#define LEFT(np, l) ((l) > (np)->level ? (np) : bdd_nodes + (np)->left)
-#define RIGHT(np, l) ((l) > (np)->level ? (np) : bdd_nodes + (np)->right)
-
-int current_bdd_node_index = BDD_NUM_LEAVES;
+_Static_assert(BDD_NODES_MAX <= (1 << BDD_HASH_INDEX_BITS), "node indices must fit in hash map entries");
+_Static_assert(BDD_LEVELS_MAX < (1 << 7) && BDD_NODES_MAX <= (1 << 25), "levels and indices must fit in BDD_NODE");
 
 /**
  * Look up, in the node table, a BDD node having the specified level and children,
@@ -28,45 +28,225 @@ int current_bdd_node_index = BDD_NUM_LEAVES;
  * The function aborts if the arguments passed are out-of-bounds.
  */
 int bdd_lookup(int level, int left, int right) {
+    if ((birp_context) -> concurrent) {
+        return bdd_lookup_concurrent(level, left, right);
+    }
     if (left == right) {
+        STATS(birp_stats.nodes_collapsed++);
         return left;
     }
+    if ((current_bdd_node_index - BDD_NUM_LEAVES + 1) * 2 > bdd_hash_size && bdd_hash_grow() == -1) {
+        return -1;
+    }
     BDD_NODE new_node = {level, left, right};
-    int index = hash_function(level, left, right);
-    BDD_NODE curr_node;
-    BDD_NODE **hash_map = bdd_hash_map;
-    hash_map += index;
-    while (*hash_map != NULL) {
-        curr_node = **hash_map;
-        if (curr_node.level == level && curr_node.left == left && curr_node.right == right) {
-            return bdd_node_to_index(*hash_map);
+    unsigned int hash = hash_function(level, left, right);
+    unsigned int fingerprint = BDD_HASH_FINGERPRINT(hash);
+    unsigned int *slot = bdd_hash_map + (hash & (bdd_hash_size - 1));
+    long long probes = 0;
+    while (*slot != 0) {
+        STATS(birp_stats.slots_probed++);
+        if (BDD_HASH_FINGERPRINT(*slot) == fingerprint) { /* Only then is the node itself examined */
+            STATS(birp_stats.nodes_examined++);
+            int curr_index = *slot & BDD_HASH_INDEX_MASK;
+            BDD_NODE *curr_node = bdd_nodes + curr_index;
+            if ((curr_node) -> level == level && (curr_node) -> left == left && (curr_node) -> right == right) {
+                STATS(birp_stats.nodes_reused++; stats_record_probe(probes));
+                return curr_index;
+            }
         }
-        hash_map++;
-        if (hash_map >= (hash_map + BDD_HASH_SIZE)) {
-            hash_map = bdd_hash_map;
+        STATS(probes++);
+        slot++;
+        if (slot >= (bdd_hash_map + bdd_hash_size)) {
+            slot = bdd_hash_map;
         }
     }
-    int insert_index = insert_node(new_node, current_bdd_node_index, bdd_nodes, hash_map);
+    int insert_index = insert_node(new_node, current_bdd_node_index, bdd_nodes, slot, fingerprint);
+    STATS(if (insert_index != -1) { birp_stats.nodes_created++; stats_record_probe(probes); });
     return insert_index;
 }
 
-int hash_function(int level, int left, int right) {
-    int temp = level + left + right;
-    return (temp % BDD_HASH_SIZE);
+int bdd_lookup_concurrent(int level, int left, int right) {
+    if (left == right) {
+        STATS(__atomic_fetch_add(&birp_stats.nodes_collapsed, 1, __ATOMIC_RELAXED));
+        return left;
+    }
+    unsigned int hash = hash_function(level, left, right);
+    unsigned int fingerprint = BDD_HASH_FINGERPRINT(hash);
+    unsigned int *slot = bdd_hash_map + (hash & (bdd_hash_size - 1));
+    long long probes = 0;
+    while (1) {
+        unsigned int entry = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+        if (entry == 0) {
+            if (!__atomic_compare_exchange_n(slot, &entry, BDD_HASH_BUSY, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                continue; /* Another thread claimed the slot first, so look at what it put there */
+            }
+            int index = __atomic_fetch_add(&current_bdd_node_index, 1, __ATOMIC_RELAXED);
+            if (index >= BDD_NODES_MAX) {
+                __atomic_store_n(slot, 0, __ATOMIC_RELEASE);
+                return -1;
+            }
+            BDD_NODE node = {level, left, right};
+            *(bdd_nodes + index) = node;
+            __atomic_store_n(slot, index | fingerprint, __ATOMIC_RELEASE);
+            STATS(__atomic_fetch_add(&birp_stats.nodes_created, 1, __ATOMIC_RELAXED); stats_record_probe(probes));
+            return index;
+        }
+        if (entry == BDD_HASH_BUSY) { /* It may be this very node, so wait until it is filled */
+            sched_yield();
+            continue;
+        }
+        STATS(__atomic_fetch_add(&birp_stats.slots_probed, 1, __ATOMIC_RELAXED));
+        if (BDD_HASH_FINGERPRINT(entry) == fingerprint) {
+            STATS(__atomic_fetch_add(&birp_stats.nodes_examined, 1, __ATOMIC_RELAXED));
+            BDD_NODE *curr_node = bdd_nodes + (entry & BDD_HASH_INDEX_MASK);
+            if ((curr_node) -> level == level && (curr_node) -> left == left && (curr_node) -> right == right) {
+                STATS(__atomic_fetch_add(&birp_stats.nodes_reused, 1, __ATOMIC_RELAXED); stats_record_probe(probes));
+                return entry & BDD_HASH_INDEX_MASK;
+            }
+        }
+        STATS(probes++);
+        slot++;
+        if (slot >= (bdd_hash_map + bdd_hash_size)) {
+            slot = bdd_hash_map;
+        }
+    }
+}
+
+int bdd_prepare_concurrent(int level) {
+    long long nodes = current_bdd_node_index + (1LL << level); /* At most one per internal call of the build */
+    if (nodes > BDD_NODES_MAX) {
+        nodes = BDD_NODES_MAX;
+    }
+    if (nodes > bdd_nodes_committed && bdd_nodes_commit(nodes) == -1) {
+        return -1;
+    }
+    while (bdd_hash_size < 2 * nodes && bdd_hash_size < BDD_HASH_SIZE) {
+        if (bdd_hash_grow() == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Hash a node by packing its fields into 64 bits (indices need only 20 bits
+ * each) and mixing with the MurmurHash3 finalizer, so that nodes with nearby
+ * children spread over the whole table rather than clustering.
+ */
+unsigned int hash_function(int level, int left, int right) {
+    unsigned long long key = ((unsigned long long) level << 40) | ((unsigned long long) right << 20) | left;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (unsigned int) key;
 }
 
-int insert_node(BDD_NODE node, int index, BDD_NODE *nodes_table, BDD_NODE **hash_map) {
+int insert_node(BDD_NODE node, int index, BDD_NODE *nodes_table, unsigned int *slot, unsigned int fingerprint) {
     if (current_bdd_node_index >= BDD_NODES_MAX) {
         return -1;
     }
+    if (index >= bdd_nodes_committed && bdd_nodes_commit(index + 1) == -1) {
+        return -1;
+    }
     nodes_table += index;
     *nodes_table = node;
-    *hash_map = nodes_table;
-    /* printf("Index: %d\tLevel: %d\tLeft: %d\tRight: %d\n", index, node.level, node.left, node.right); */
+    *slot = index | fingerprint;
     current_bdd_node_index++;
     return index;
 }
 
+int bdd_store_init() {
+    if (bdd_nodes != NULL) {
+        return 0;
+    }
+    /* Reserve address space only; bdd_nodes_commit backs it as it fills */
+    void *space = mmap(NULL, BDD_NODES_MAX * sizeof(BDD_NODE), PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (space == MAP_FAILED) {
+        return -1;
+    }
+    bdd_hash_map = calloc(BDD_HASH_INITIAL, sizeof(unsigned int));
+    if (bdd_hash_map == NULL) {
+        munmap(space, BDD_NODES_MAX * sizeof(BDD_NODE));
+        return -1;
+    }
+    bdd_hash_size = BDD_HASH_INITIAL;
+    bdd_nodes = space;
+    if (bdd_nodes_commit(BDD_NODES_INITIAL) == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+int bdd_nodes_commit(int count) {
+    int committed = bdd_nodes_committed * 2; /* Double, so commits are amortized */
+    if (committed < count) {
+        committed = count;
+    }
+    if (committed > BDD_NODES_MAX) {
+        committed = BDD_NODES_MAX;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    size_t bytes = ((committed * sizeof(BDD_NODE) + page - 1) / page) * page;
+    if (mprotect(bdd_nodes, bytes, PROT_READ | PROT_WRITE) == -1) {
+        return -1;
+    }
+    bdd_nodes_committed = bytes / sizeof(BDD_NODE);
+    if (bdd_nodes_committed > BDD_NODES_MAX) {
+        bdd_nodes_committed = BDD_NODES_MAX;
+    }
+    return 0;
+}
+
+int bdd_hash_grow() {
+    if (bdd_hash_map == NULL) {
+        return bdd_store_init();
+    }
+    if (bdd_hash_size >= BDD_HASH_SIZE) {
+        return 0; /* Already large enough for BDD_NODES_MAX nodes */
+    }
+    int size = bdd_hash_size * 2;
+    unsigned int *map = calloc(size, sizeof(unsigned int));
+    if (map == NULL) {
+        return -1;
+    }
+    BDD_NODE *node = bdd_nodes + BDD_NUM_LEAVES;
+    for (int index = BDD_NUM_LEAVES; index < current_bdd_node_index; index++) {
+        unsigned int hash = hash_function((node) -> level, (node) -> left, (node) -> right);
+        unsigned int *slot = map + (hash & (size - 1));
+        while (*slot != 0) { /* Nodes are distinct, so only an empty slot is needed */
+            slot++;
+            if (slot >= map + size) {
+                slot = map;
+            }
+        }
+        *slot = index | BDD_HASH_FINGERPRINT(hash);
+        node++;
+    }
+    free(bdd_hash_map);
+    bdd_hash_map = map;
+    bdd_hash_size = size;
+    return 0;
+}
+
+void bdd_reset_nodes() {
+    STATS(if (current_bdd_node_index > birp_stats.peak_node_index) {
+            birp_stats.peak_node_index = current_bdd_node_index;
+        });
+    unsigned int *slot = bdd_hash_map;
+    for (int i = 0; i < bdd_hash_size; i++) {
+        *slot = 0;
+        slot++;
+    }
+    current_bdd_node_index = BDD_NUM_LEAVES;
+    free(bdd_sum_table); /* Cached sums describe the discarded nodes */
+    bdd_sum_table = NULL;
+    bdd_view_clear();
+    bdd_quad_reset();
+}
+
 int bdd_node_to_index(BDD_NODE *node) {
     return node - bdd_nodes;
 }
@@ -81,10 +261,23 @@ BDD_NODE* index_to_bdd_node(int index) {
 
 BDD_NODE *bdd_from_raster(int w, int h, unsigned char *raster) {
     int level = bdd_min_level(w, h);
-    if (level > BDD_LEVELS_MAX) {
+    if (level > BDD_LEVELS_MAX || bdd_store_init() == -1) {
         return NULL;
     }
-    int index = bdd_from_raster_recurse(w, h, raster, level, 0, power(2, level / 2), 0, power(2, level / 2));
+    TRACE_BEGIN("bdd_from_raster");
+    POOL *pool = level >= BDD_PARALLEL_MIN_LEVEL ? pool_shared() : NULL;
+    int index;
+    if (pool != NULL && bdd_prepare_concurrent(level) == 0) {
+        (birp_context) -> concurrent = 1;
+        index = bdd_from_raster_parallel(pool, w, h, raster, level, 0, power(2, level / 2), 0, power(2, level / 2));
+        (birp_context) -> concurrent = 0;
+        if (current_bdd_node_index > BDD_NODES_MAX) { /* Claimed by lookups that then failed */
+            current_bdd_node_index = BDD_NODES_MAX;
+        }
+    } else {
+        index = bdd_from_raster_recurse(w, h, raster, level, 0, power(2, level / 2), 0, power(2, level / 2));
+    }
+    TRACE_END("bdd_from_raster");
     if (index == -1) {
         return NULL;
     }
@@ -142,11 +335,146 @@ int bdd_from_raster_recurse(int w, int h, unsigned char *raster, int curr_level,
 
 
 
+/*
+ * One half of a region, built by a pool worker in the context of the thread
+ * that started the build.
+ */
+typedef struct bdd_build_task {
+    POOL *pool;
+    BIRP_CONTEXT *ctx;
+    int w;
+    int h;
+    unsigned char *raster;
+    int level;
+    int row_min;
+    int row_max;
+    int col_min;
+    int col_max;
+    int result;
+} BDD_BUILD_TASK;
+
+static void bdd_build_task(void *arg) {
+    BDD_BUILD_TASK *task = arg;
+    BIRP_CONTEXT *previous = birp_context_use((task) -> ctx);
+    (task) -> result = bdd_from_raster_parallel((task) -> pool, (task) -> w, (task) -> h, (task) -> raster,
+                                                (task) -> level, (task) -> row_min, (task) -> row_max,
+                                                (task) -> col_min, (task) -> col_max);
+    birp_context_use(previous);
+}
+
+int bdd_from_raster_parallel(POOL *pool, int w, int h, unsigned char *raster, int curr_level, int row_min, int row_max, int col_min, int col_max) {
+    if (curr_level <= BDD_PARALLEL_TASK_LEVEL) {
+        return bdd_from_raster_recurse(w, h, raster, curr_level, row_min, row_max, col_min, col_max);
+    }
+    /* The first half becomes a task for the pool, while this thread builds the second */
+    BDD_BUILD_TASK task = { pool, birp_context, w, h, raster, curr_level - 1, row_min, row_max, col_min, col_max, -1 };
+    if (curr_level % 2 == 0) { /* Top and bottom strips */
+        task.row_max = (row_min + row_max) / 2;
+        row_min = task.row_max;
+    } else { /* Left and right sub-squares */
+        task.col_max = (col_min + col_max) / 2;
+        col_min = task.col_max;
+    }
+    POOL_GROUP group;
+    atomic_init(&group.pending, 0);
+    if (pool_submit(pool, &group, bdd_build_task, &task) == -1) {
+        bdd_build_task(&task);
+    }
+    int right = bdd_from_raster_parallel(pool, w, h, raster, curr_level - 1, row_min, row_max, col_min, col_max);
+    pool_wait(pool, &group);
+    if (task.result == -1 || right == -1) {
+        return -1;
+    }
+    return bdd_lookup(curr_level, task.result, right);
+}
+
 void bdd_to_raster(BDD_NODE *node, int w, int h, unsigned char *raster) {
-    for (int row = 0; row < h; row++) {
-        for (int col = 0; col < w; col++) {
-            *(raster + (row * w) + col) = bdd_apply(node, row, col);
+    if (bdd_view_active(node)) { /* Decode through the transform rather than build it */
+        bdd_view_to_raster(w, h, raster, 0, h);
+        return;
+    }
+    int level = bdd_min_level(w, h);
+    if (bdd_node_to_index(node) >= BDD_NUM_LEAVES && (node) -> level > level) {
+        level = (node) -> level;
+    }
+    POOL *pool = level >= BDD_PARALLEL_MIN_LEVEL ? pool_shared() : NULL;
+    if (pool != NULL) {
+        bdd_to_raster_parallel(pool, node, level, 0, 0, w, h, raster);
+    } else {
+        bdd_to_raster_recurse(node, level, 0, 0, w, h, raster);
+    }
+}
+
+/*
+ * One half of a region, decoded by a pool worker in the context of the
+ * thread that started the decoding.
+ */
+typedef struct bdd_decode_task {
+    POOL *pool;
+    BIRP_CONTEXT *ctx;
+    BDD_NODE *node;
+    int level;
+    int row;
+    int col;
+    int w;
+    int h;
+    unsigned char *raster;
+} BDD_DECODE_TASK;
+
+static void bdd_decode_task(void *arg) {
+    BDD_DECODE_TASK *task = arg;
+    BIRP_CONTEXT *previous = birp_context_use((task) -> ctx);
+    bdd_to_raster_parallel((task) -> pool, (task) -> node, (task) -> level, (task) -> row, (task) -> col,
+                           (task) -> w, (task) -> h, (task) -> raster);
+    birp_context_use(previous);
+}
+
+void bdd_to_raster_parallel(POOL *pool, BDD_NODE *node, int level, int row, int col, int w, int h, unsigned char *raster) {
+    if (row >= h || col >= w) { /* Outside of raster */
+        return;
+    }
+    if (level <= BDD_PARALLEL_TASK_LEVEL) {
+        bdd_to_raster_recurse(node, level, row, col, w, h, raster);
+        return;
+    }
+    /* Split leaves too, so that large uniform regions are also filled in parallel */
+    BDD_DECODE_TASK task = { pool, birp_context, LEFT(node, level), level - 1, row, col, w, h, raster };
+    if (level % 2 == 0) { /* Top and bottom halves */
+        row += LEVEL_ROWS(level - 1);
+    } else { /* Left and right halves */
+        col += LEVEL_COLS(level - 1);
+    }
+    POOL_GROUP group;
+    atomic_init(&group.pending, 0);
+    if (pool_submit(pool, &group, bdd_decode_task, &task) == -1) {
+        bdd_decode_task(&task);
+    }
+    bdd_to_raster_parallel(pool, RIGHT(node, level), level - 1, row, col, w, h, raster);
+    pool_wait(pool, &group);
+}
+
+void bdd_to_raster_recurse(BDD_NODE *node, int level, int row, int col, int w, int h, unsigned char *raster) {
+    if (row >= h || col >= w) { /* Outside of raster */
+        return;
+    }
+    int node_index = bdd_node_to_index(node);
+    if (node_index < BDD_NUM_LEAVES) { /* Fill the uniform region, clipped to the raster */
+        int row_max = row + LEVEL_ROWS(level) < h ? row + LEVEL_ROWS(level) : h;
+        int col_max = col + LEVEL_COLS(level) < w ? col + LEVEL_COLS(level) : w;
+        for (int r = row; r < row_max; r++) {
+            unsigned char *pixel = raster + (r * w) + col;
+            for (int c = col; c < col_max; c++) {
+                *pixel = node_index;
+                pixel++;
+            }
         }
+        return;
+    }
+    bdd_to_raster_recurse(LEFT(node, level), level - 1, row, col, w, h, raster);
+    if (level % 2 == 0) { /* Top and bottom halves */
+        bdd_to_raster_recurse(RIGHT(node, level), level - 1, row + LEVEL_ROWS(level - 1), col, w, h, raster);
+    } else { /* Left and right halves */
+        bdd_to_raster_recurse(RIGHT(node, level), level - 1, row, col + LEVEL_COLS(level - 1), w, h, raster);
     }
 }
 
@@ -157,14 +485,27 @@ void bdd_to_raster(BDD_NODE *node, int w, int h, unsigned char *raster) {
 
 
 int bdd_serialize(BDD_NODE *node, FILE *out) {
-    clear_bdd_index_map();
-    bdd_serialize_recurse(node, out, 1);
-    return 0;
+    int phase = stats_phase(STATS_PHASE_SERIALIZE);
+    TRACE_BEGIN("bdd_serialize");
+    int status = clear_bdd_index_map();
+    POOL *pool = bdd_node_to_index(node) >= BDD_NUM_LEAVES && (node) -> level >= BDD_PARALLEL_MIN_LEVEL ? pool_shared() : NULL;
+    if (status == 0 && pool != NULL && bdd_serialize_parallel(pool, node, out) == -1) {
+        status = clear_bdd_index_map(); /* Undo the marks of the failed attempt, and fall back */
+        pool = NULL;
+    }
+    if (status == 0 && pool == NULL) {
+        bdd_serialize_recurse(node, out, 1);
+    }
+    TRACE_END("bdd_serialize");
+    stats_phase(phase);
+    return status;
 }
 
 int bdd_serialize_recurse(BDD_NODE *node, FILE *out, int serial_num) {
     int node_index = bdd_node_to_index(node);
+    STATS(birp_stats.memo_lookups++);
     if (*(bdd_index_map + node_index) != 0) { /* If node has already been serialized */
+        STATS(birp_stats.memo_hits++);
         return serial_num;
     }
     if (node_index <= 255) {
@@ -185,6 +526,242 @@ int bdd_serialize_recurse(BDD_NODE *node, FILE *out, int serial_num) {
     return new_serial_num + 1;
 }
 
+/*
+ * Bitmaps of the nodes listed by the part a thread is working on, one per
+ * thread that can list at once.  A list task claims a free one for its
+ * duration, rather than being given one by worker index: threads outside
+ * the pool that wait on it (the caller, or a caller serializing another
+ * image at the same time) also run tasks, and may be workers of another
+ * pool with indices of their own.
+ */
+typedef struct bdd_serial_seen {
+    unsigned char **maps;
+    atomic_int *busy;
+    int count;
+    size_t size;          // Bytes in each bitmap.
+} BDD_SERIAL_SEEN;
+
+/*
+ * A part of the serialized BDD: either a single node above the task level,
+ * or the subtree below a node at or under it, whose nodes a pool worker
+ * lists in depth-first post-order.  The stitch then keeps only the nodes
+ * that no earlier part has serialized, numbers them, and works out where
+ * in the output the part goes, so that the parts can be encoded at once.
+ */
+typedef struct bdd_serial_part {
+    BIRP_CONTEXT *ctx;
+    int root;
+    int subtree;          // Whether the nodes below root are to be listed.
+    int *nodes;
+    int count;
+    int capacity;
+    long offset;          // Of the part's first byte in the output.
+    unsigned char *out;
+    BDD_SERIAL_SEEN *seen;
+    int failed;
+} BDD_SERIAL_PART;
+
+typedef struct bdd_serial_plan {
+    BDD_SERIAL_PART *parts;
+    int count;
+    int capacity;
+} BDD_SERIAL_PLAN;
+
+static int bdd_serial_part_add(BDD_SERIAL_PART *part, int index) {
+    if ((part) -> count == (part) -> capacity) {
+        int capacity = (part) -> capacity == 0 ? 16 : (part) -> capacity * 2;
+        int *nodes = realloc((part) -> nodes, capacity * sizeof(int));
+        if (nodes == NULL) {
+            return -1;
+        }
+        (part) -> nodes = nodes;
+        (part) -> capacity = capacity;
+    }
+    *((part) -> nodes + (part) -> count) = index;
+    (part) -> count++;
+    return 0;
+}
+
+/*
+ * Divide the DAG below index into parts in the order in which
+ * bdd_serialize_recurse would reach them, marking each node made into a part
+ * with -1 in bdd_index_map so that it is only planned once.
+ */
+static int bdd_serial_plan_recurse(BDD_SERIAL_PLAN *plan, int index) {
+    if (*(bdd_index_map + index) != 0) {
+        return 0;
+    }
+    BDD_NODE *node = index_to_bdd_node(index);
+    int top = index >= BDD_NUM_LEAVES && (node) -> level > BDD_PARALLEL_TASK_LEVEL;
+    if (top && (bdd_serial_plan_recurse(plan, (node) -> left) == -1 ||
+                bdd_serial_plan_recurse(plan, (node) -> right) == -1)) {
+        return -1;
+    }
+    if ((plan) -> count == (plan) -> capacity) {
+        int capacity = (plan) -> capacity == 0 ? 64 : (plan) -> capacity * 2;
+        BDD_SERIAL_PART *parts = realloc((plan) -> parts, capacity * sizeof(BDD_SERIAL_PART));
+        if (parts == NULL) {
+            return -1;
+        }
+        (plan) -> parts = parts;
+        (plan) -> capacity = capacity;
+    }
+    BDD_SERIAL_PART *part = (plan) -> parts + (plan) -> count;
+    (plan) -> count++;
+    *part = (BDD_SERIAL_PART) { birp_context, index, !top && index >= BDD_NUM_LEAVES, NULL, 0, 0, 0, NULL, NULL, 0 };
+    *(bdd_index_map + index) = -1;
+    return bdd_serial_part_add(part, index);
+}
+
+static int bdd_serial_list_recurse(BDD_SERIAL_PART *part, unsigned char *seen, int index) {
+    if (*(seen + index / 8) & (1 << (index % 8))) {
+        return 0;
+    }
+    *(seen + index / 8) |= 1 << (index % 8);
+    BDD_NODE *node = index_to_bdd_node(index);
+    if (index >= BDD_NUM_LEAVES && (bdd_serial_list_recurse(part, seen, (node) -> left) == -1 ||
+                                    bdd_serial_list_recurse(part, seen, (node) -> right) == -1)) {
+        return -1;
+    }
+    return bdd_serial_part_add(part, index);
+}
+
+static void bdd_serial_list_task(void *arg) {
+    BDD_SERIAL_PART *part = arg;
+    BDD_SERIAL_SEEN *set = (part) -> seen;
+    int slot = 0;
+    while (slot < (set) -> count && atomic_exchange((set) -> busy + slot, 1) != 0) {
+        slot++;
+    }
+    /* More threads than bitmaps are listing at once: this one uses its own */
+    unsigned char *seen = slot < (set) -> count ? *((set) -> maps + slot) : calloc((set) -> size, 1);
+    if (seen == NULL) {
+        (part) -> failed = 1;
+        return;
+    }
+    BIRP_CONTEXT *previous = birp_context_use((part) -> ctx);
+    (part) -> count = 0; /* The root is listed again, last */
+    (part) -> failed = bdd_serial_list_recurse(part, seen, (part) -> root) == -1;
+    for (int i = 0; i < (part) -> count; i++) { /* Leave the bitmap empty for the next part */
+        int index = *((part) -> nodes + i);
+        *(seen + index / 8) = 0;
+    }
+    birp_context_use(previous);
+    if (slot < (set) -> count) {
+        atomic_store((set) -> busy + slot, 0);
+    } else {
+        free(seen);
+    }
+}
+
+/* Store a serial number as output_serial_number writes it, returning the position after it. */
+static unsigned char *store_serial_number(int serial_num, unsigned char *out) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        *out++ = (serial_num >> shift) & 0xFF;
+    }
+    return out;
+}
+
+static void bdd_serial_encode_task(void *arg) {
+    BDD_SERIAL_PART *part = arg;
+    BIRP_CONTEXT *previous = birp_context_use((part) -> ctx);
+    unsigned char *out = (part) -> out + (part) -> offset;
+    for (int i = 0; i < (part) -> count; i++) {
+        int index = *((part) -> nodes + i);
+        if (index < BDD_NUM_LEAVES) {
+            *out++ = '@';
+            *out++ = index;
+            continue;
+        }
+        BDD_NODE *node = index_to_bdd_node(index);
+        *out++ = (node) -> level + 64;
+        out = store_serial_number(*(bdd_index_map + (node) -> left), out);
+        out = store_serial_number(*(bdd_index_map + (node) -> right), out);
+    }
+    birp_context_use(previous);
+}
+
+int bdd_serialize_parallel(POOL *pool, BDD_NODE *node, FILE *out) {
+    BDD_SERIAL_PLAN plan = { NULL, 0, 0 };
+    int slots = (pool) -> num_threads + 1; /* The workers and the calling thread */
+    BDD_SERIAL_SEEN seen = { calloc(slots, sizeof(unsigned char *)), calloc(slots, sizeof(atomic_int)),
+                             slots, current_bdd_node_index / 8 + 1 };
+    unsigned char *buffer = NULL;
+    int status = seen.maps == NULL || seen.busy == NULL
+        || bdd_serial_plan_recurse(&plan, bdd_node_to_index(node)) == -1 ? -1 : 0;
+    for (int i = 0; status == 0 && i < slots; i++) {
+        atomic_init(seen.busy + i, 0);
+        *(seen.maps + i) = calloc(seen.size, 1);
+        status = *(seen.maps + i) == NULL ? -1 : 0;
+    }
+
+    /* List the nodes of each subtree concurrently, each part on its own */
+    POOL_GROUP group;
+    atomic_init(&group.pending, 0);
+    for (int i = 0; status == 0 && i < plan.count; i++) {
+        BDD_SERIAL_PART *part = plan.parts + i;
+        (part) -> seen = &seen;
+        if ((part) -> subtree && pool_submit(pool, &group, bdd_serial_list_task, part) == -1) {
+            bdd_serial_list_task(part);
+        }
+    }
+    pool_wait(pool, &group);
+
+    /* Stitch: number the nodes not serialized by an earlier part, in order, and place each part */
+    int serial_num = 1;
+    long size = 0;
+    for (int i = 0; status == 0 && i < plan.count; i++) {
+        BDD_SERIAL_PART *part = plan.parts + i;
+        status = (part) -> failed ? -1 : 0;
+        (part) -> offset = size;
+        int kept = 0;
+        for (int j = 0; j < (part) -> count; j++) {
+            int index = *((part) -> nodes + j);
+            STATS(birp_stats.memo_lookups++);
+            if (*(bdd_index_map + index) > 0) {
+                STATS(birp_stats.memo_hits++);
+                continue;
+            }
+            *(bdd_index_map + index) = serial_num;
+            serial_num++;
+            *((part) -> nodes + kept) = index;
+            kept++;
+            size += index < BDD_NUM_LEAVES ? 2 : 9;
+        }
+        (part) -> count = kept;
+    }
+
+    /* Encode the parts concurrently into their places in one buffer */
+    buffer = status == 0 ? malloc(size) : NULL;
+    status = buffer == NULL ? -1 : status;
+    atomic_init(&group.pending, 0);
+    for (int i = 0; status == 0 && i < plan.count; i++) {
+        BDD_SERIAL_PART *part = plan.parts + i;
+        (part) -> out = buffer;
+        if (!(part) -> subtree) {
+            bdd_serial_encode_task(part);
+        } else if ((part) -> count > 0 && pool_submit(pool, &group, bdd_serial_encode_task, part) == -1) {
+            bdd_serial_encode_task(part);
+        }
+    }
+    pool_wait(pool, &group);
+    if (status == 0) {
+        fwrite(buffer, 1, size, out);
+    }
+
+    free(buffer);
+    for (int i = 0; seen.maps != NULL && i < slots; i++) {
+        free(*(seen.maps + i));
+    }
+    free(seen.maps);
+    free(seen.busy);
+    for (int i = 0; i < plan.count; i++) {
+        free((plan.parts + i) -> nodes);
+    }
+    free(plan.parts);
+    return status;
+}
+
 void output_serial_number(int serial_num, FILE *out) {
     int mask = 0x000000FF;
     int curr_byte;
@@ -204,11 +781,16 @@ void output_serial_number(int serial_num, FILE *out) {
 
 
 BDD_NODE *bdd_deserialize(FILE *in) {
-    clear_bdd_index_map();
+    if (bdd_store_init() == -1) {
+        return NULL;
+    }
     int serial_num = 1;
     int curr_char = fgetc(in);
     int bdd_node_index;
     while (curr_char != EOF) {
+        if (bdd_index_map_reserve(serial_num + 1) == -1) { /* Also bounds the serial numbers */
+            return NULL;
+        }
         if (curr_char == '@') {
             curr_char = fgetc(in);
             if (curr_char == EOF) {
@@ -217,7 +799,7 @@ BDD_NODE *bdd_deserialize(FILE *in) {
             bdd_node_index = curr_char;
             *(bdd_index_map + serial_num) = curr_char; /* Map serial number to node index */
         } else if (curr_char >= 'A' && curr_char <= '`') {
-            bdd_node_index = build_new_node(curr_char - 64, in);
+            bdd_node_index = build_new_node(curr_char - 64, serial_num, in);
             if (bdd_node_index == -1) {
                 return NULL;
             }
@@ -231,13 +813,13 @@ BDD_NODE *bdd_deserialize(FILE *in) {
     return index_to_bdd_node(bdd_node_index);
 }
 
-int build_new_node(int level, FILE *in) {
+int build_new_node(int level, int serial_num, FILE *in) {
     int left_serial = build_serial_num(in);
-    if (left_serial == -1) {
+    if (left_serial < 1 || left_serial >= serial_num) { /* Children must precede their parent */
         return -1;
     }
     int right_serial = build_serial_num(in);
-    if (right_serial == -1) {
+    if (right_serial < 1 || right_serial >= serial_num) {
         return -1;
     }
     return bdd_lookup(level, *(bdd_index_map + left_serial), *(bdd_index_map + right_serial));
@@ -264,6 +846,9 @@ int build_serial_num(FILE *in) {
 
 
 unsigned char bdd_apply(BDD_NODE *node, int r, int c) {
+    if (bdd_view_active(node) && bdd_view_map(&r, &c) == -1) { /* Outside the transformed image */
+        return 0;
+    }
     int node_index = bdd_node_to_index(node);
     if (node_index <= 255) {
         return node_index;
@@ -317,32 +902,16 @@ int bdd_apply_recurse(BDD_NODE *node, int level, int instructions) {
 
 
 BDD_NODE *bdd_map(BDD_NODE *node, unsigned char (*func)(unsigned char)) {
-    clear_bdd_index_map();
-    int index = bdd_map_recurse(node, func);
-    if (index == -1) {
+    unsigned char *lut = malloc(BDD_LUT_SIZE);
+    if (lut == NULL) {
         return NULL;
     }
-    return index_to_bdd_node(index);
-    /* return index_to_bdd_node(bdd_map_recurse(node, func)); */
-}
-
-int bdd_map_recurse(BDD_NODE *node, unsigned char (*func)(unsigned char)) {
-    /* printf("\tIndex: %d\tLevel: %d\tLeft: %d\tRight: %d\n", bdd_node_to_index(node), (*node).level, (*node).left, (*node).right); */
-    int bdd_node_index = bdd_node_to_index(node);
-    if (*(bdd_index_map + bdd_node_index) != 0) { /* If node has already been mapped */
-        return *(bdd_index_map + bdd_node_index);
-    }
-    if (bdd_node_index <= 255) {
-        return func(bdd_node_index);
+    for (int v = 0; v < BDD_LUT_SIZE; v++) { /* Once per value, rather than once per leaf */
+        *(lut + v) = func(v);
     }
-    int left = bdd_map_recurse(index_to_bdd_node((node) -> left), func);
-    int right = bdd_map_recurse(index_to_bdd_node((node) -> right), func);
-    if (left == -1 || right == -1) {
-        return -1;
-    }
-    int new_index = bdd_lookup((node) -> level, left, right);
-    *(bdd_index_map + bdd_node_index) = new_index; /* Map old node to new node */
-    return new_index;
+    BDD_NODE *new_root = bdd_map_lut(node, lut);
+    free(lut);
+    return new_root;
 }
 
 
@@ -352,33 +921,8 @@ int bdd_map_recurse(BDD_NODE *node, unsigned char (*func)(unsigned char)) {
 
 
 BDD_NODE *bdd_rotate(BDD_NODE *node, int level) {
-    if (level % 2 == 1) {
-        level += 1;
-    }
-    int side_length = power(2, (level / 2));
-    int root_index = bdd_rotate_recurse(node, level, 0, side_length, 0, side_length);
-    if (root_index == -1) {
-        return NULL;
-    }
-    return index_to_bdd_node(root_index);
-}
-
-int bdd_rotate_recurse(BDD_NODE *root, int level, int row_min, int row_max, int col_min, int col_max) {
-    if (level == 0) {
-        return bdd_apply(root, row_min, col_min);
-    }
-    int row_middle = (row_min + row_max) / 2;
-    int col_middle = (col_min + col_max) / 2;
-    int top_left = bdd_rotate_recurse(root, level - 2, row_min, row_middle, col_min, col_middle);
-    int top_right = bdd_rotate_recurse(root, level - 2, row_min, row_middle, col_middle, col_max);
-    int bot_left = bdd_rotate_recurse(root, level - 2, row_middle, row_max, col_min, col_middle);
-    int bot_right = bdd_rotate_recurse(root, level - 2, row_middle, row_max, col_middle, col_max);
-    if (top_left == -1 || top_right == -1 || bot_left == -1 || bot_right == -1) {
-        return -1;
-    }
-    int left_index = bdd_lookup(level - 1, top_right, bot_right);
-    int right_index = bdd_lookup(level - 1, top_left, bot_left);
-    return bdd_lookup(level, left_index, right_index);
+    /* A structural rewrite of the nodes, as for the other symmetries of the square */
+    return bdd_dihedral(node, BDD_DIHEDRAL_ROTATE_90);
 }
 
 
@@ -386,7 +930,9 @@ int bdd_rotate_recurse(BDD_NODE *root, int level, int row_min, int row_max, int
 
 
 BDD_NODE *bdd_zoom(BDD_NODE *node, int level, int factor) {
-    clear_bdd_index_map();
+    if (clear_bdd_index_map() == -1) {
+        return NULL;
+    }
     /* printf("Building zoom bdd for factor %d...\n", factor); */
     int new_root_index;
     if (factor < 0) {
@@ -405,7 +951,9 @@ int bdd_zoom_in(BDD_NODE *node, int factor) {
     if (bdd_node_index <= 255) {
         return bdd_node_index;
     }
+    STATS(birp_stats.memo_lookups++);
     if (*(bdd_index_map + bdd_node_index) != 0) { /* If node has already been mapped */
+        STATS(birp_stats.memo_hits++);
         return *(bdd_index_map + bdd_node_index);
     }
     int left = bdd_zoom_in(index_to_bdd_node((node) -> left), factor);
@@ -430,7 +978,9 @@ int bdd_zoom_out(BDD_NODE *node, int factor) {
             return 255;
         }
     }
+    STATS(birp_stats.memo_lookups++);
     if (*(bdd_index_map + bdd_node_index) != 0) { /* If node has already been mapped */
+        STATS(birp_stats.memo_hits++);
         return *(bdd_index_map + bdd_node_index);
     }
     int left = bdd_zoom_out(index_to_bdd_node((node) -> left), factor);
@@ -443,12 +993,72 @@ int bdd_zoom_out(BDD_NODE *node, int factor) {
     return new_index;
 }
 
+int bdd_count_nodes(BDD_NODE *node, int *leavesp) {
+    if (clear_bdd_index_map() == -1) {
+        return -1;
+    }
+    int leaves = 0;
+    int total = bdd_count_nodes_recurse(node, &leaves);
+    if (leavesp != NULL) {
+        *leavesp = leaves;
+    }
+    return total;
+}
+
+int bdd_count_nodes_recurse(BDD_NODE *node, int *leavesp) {
+    int node_index = bdd_node_to_index(node);
+    if (*(bdd_index_map + node_index) != 0) { /* If node has already been counted */
+        return 0;
+    }
+    *(bdd_index_map + node_index) = 1;
+    if (node_index < BDD_NUM_LEAVES) {
+        *leavesp += 1;
+        return 1;
+    }
+    return 1 + bdd_count_nodes_recurse(index_to_bdd_node((node) -> left), leavesp)
+        + bdd_count_nodes_recurse(index_to_bdd_node((node) -> right), leavesp);
+}
 
-void clear_bdd_index_map() {
+int bdd_index_map_reserve(int count) {
+    if (count <= bdd_index_map_size) {
+        return 0;
+    }
+    if (count > BDD_NODES_MAX) {
+        return -1;
+    }
+    int size = bdd_index_map_size * 2; /* Double, so growth is amortized */
+    if (size < count) {
+        size = count;
+    }
+    if (size < BDD_NODES_INITIAL) {
+        size = BDD_NODES_INITIAL;
+    }
+    if (size > BDD_NODES_MAX) {
+        size = BDD_NODES_MAX;
+    }
+    int *map = realloc(bdd_index_map, size * sizeof(int));
+    if (map == NULL) {
+        return -1;
+    }
+    int *entry = map + bdd_index_map_size;
+    for (int i = bdd_index_map_size; i < size; i++) {
+        *entry = 0;
+        entry++;
+    }
+    bdd_index_map = map;
+    bdd_index_map_size = size;
+    return 0;
+}
+
+int clear_bdd_index_map() {
+    if (bdd_index_map_reserve(current_bdd_node_index) == -1) {
+        return -1;
+    }
+    /* Memoized operations only look up nodes that existed when they started */
     int *map = bdd_index_map;
-    for (int i = 0; i < BDD_NODES_MAX; i++) {
+    for (int i = 0; i < current_bdd_node_index; i++) {
         *map = 0;
         map++;
     }
-    return;
+    return 0;
 }
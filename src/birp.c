@@ -2,44 +2,248 @@
  * BIRP: Binary decision diagram Image RePresentation
  */
 
+#include <stdlib.h>
+
 #include "image.h"
 #include "bdd.h"
 #include "const.h"
 #include "debug.h"
 #include "birp2.h"
 #include "my_math.h"
+#include "region.h"
+#include "dihedral.h"
+#include "lut.h"
+#include "lossy.h"
+#include "planes.h"
+#include "order.h"
+#include "bdd2.h"
+#include "stats.h"
+#include "trace.h"
+#include "batch.h"
+#include "pool.h"
+#include "pipeline.h"
+#include "mapped.h"
+
+char *trace_path = NULL;
+char *input_path = NULL;
+char *output_path = NULL;
+unsigned char *point_lut = NULL;
+int order_kind = BDD_ORDER_INTERLEAVED;
+
+unsigned char *raster_reserve(size_t size) {
+    if (size > RASTER_SIZE_MAX) {
+        return NULL;
+    }
+    if (size <= (birp_context) -> raster_capacity && raster_data != NULL) {
+        return raster_data;
+    }
+    free(raster_data); /* Contents need not survive, so avoid realloc's copy */
+    raster_data = malloc(size > 0 ? size : 1);
+    (birp_context) -> raster_capacity = raster_data == NULL ? 0 : size;
+    return raster_data;
+}
+
+unsigned char *read_pgm_raster(FILE *in, int *wp, int *hp, MAPPED_PGM *map) {
+    TRACE_BEGIN("img_read_pgm");
+    unsigned char *raster = NULL;
+    int mapped = mapped_pgm_read(in, map);
+    if (mapped == 0) {
+        raster = (map) -> raster;
+        *wp = (map) -> w;
+        *hp = (map) -> h;
+    } else if (mapped == 1 && img_read_pgm_header(in, wp, hp) == 0) {
+        raster = raster_reserve(((size_t) *wp) * *hp);
+        if (raster != NULL && img_read_pgm_raster(in, *wp, *hp, raster) == -1) {
+            raster = NULL;
+        }
+    }
+    TRACE_END("img_read_pgm");
+    return raster;
+}
 
 int pgm_to_birp(FILE *in, FILE *out) {
+    if (global_options & PIPELINE_OPTION) {
+        return pgm_to_birp_pipelined(in, out);
+    }
     int temp_wp = 0;
     int temp_hp = 0;
     int *wp = &temp_wp;
     int *hp = &temp_hp;
-    unsigned char *raster = raster_data;
-    if (img_read_pgm(in, wp, hp, raster, RASTER_SIZE_MAX) == -1) {
+    STATS(stats_phase(STATS_PHASE_READ));
+    MAPPED_PGM map;
+    unsigned char *raster = read_pgm_raster(in, wp, hp, &map);
+    if (raster == NULL) {
         return -1;
     }
-    BDD_NODE *node_pointer = bdd_from_raster(*wp, *hp, raster);
+    STATS(stats_phase(STATS_PHASE_BUILD));
+    BDD_NODE *node_pointer;
+    int order = bdd_order_of_kind(BDD_ORDER_INTERLEAVED, bdd_min_level(*wp, *hp));
+    if (global_options & LOSSY_OPTION) {
+        node_pointer = apply_lossy_encoding(raster, *wp, *hp);
+    } else if (order_kind != BDD_ORDER_INTERLEAVED) {
+        node_pointer = apply_order_encoding(raster, *wp, *hp, &order);
+    } else {
+        node_pointer = bdd_from_raster(*wp, *hp, raster);
+    }
+    mapped_pgm_close(&map);
     if (node_pointer == NULL) {
         return - 1;
     }
-    return img_write_birp(node_pointer, *wp, *hp, out);
+    STATS(stats_phase(STATS_PHASE_WRITE));
+    TRACE_BEGIN("img_write_birp");
+    int status;
+    if (order_kind != BDD_ORDER_INTERLEAVED) {
+        status = img_write_birp_ordered(node_pointer, *wp, *hp, order, out);
+    } else {
+        status = write_birp_output(node_pointer, *wp, *hp, out);
+    }
+    TRACE_END("img_write_birp");
+    return status;
+}
+
+BDD_NODE *apply_order_encoding(unsigned char *raster, int w, int h, int *orderp) {
+    int level = bdd_min_level(w, h);
+    if (order_kind != BDD_ORDER_SEARCH) {
+        *orderp = bdd_order_of_kind(order_kind, level);
+        return bdd_from_raster_ordered(w, h, raster, *orderp);
+    }
+    TRACE_BEGIN("bdd_order_search");
+    int nodes;
+    int order = bdd_order_search(w, h, raster, &nodes);
+    TRACE_END("bdd_order_search");
+    if (order == -1) {
+        return NULL;
+    }
+    fprintf(stderr, "order: ");
+    for (int l = level; l > 0; l--) { /* From the root down, as the levels are split */
+        fputc((order >> (l - 1)) & 1 ? 'c' : 'r', stderr);
+    }
+    fprintf(stderr, ", %d nodes\n", nodes);
+    *orderp = order;
+    return bdd_from_raster_ordered(w, h, raster, order);
+}
+
+BDD_NODE *apply_lossy_encoding(unsigned char *raster, int w, int h) {
+    int tolerance = global_options & 0x00FF0000;
+    tolerance >>= 16;
+    int metric = (global_options & LOSSY_MEAN_OPTION) ? LOSSY_METRIC_MEAN : LOSSY_METRIC_MAX;
+    /* The exact image is measured in a scratch context, so that its nodes are freed before the lossy ones are made */
+    BIRP_CONTEXT *scratch = birp_context_create();
+    if (scratch == NULL) {
+        return NULL;
+    }
+    BIRP_CONTEXT *previous = birp_context_use(scratch);
+    BDD_NODE *exact_root = bdd_from_raster(w, h, raster);
+    int exact_nodes = exact_root == NULL ? -1 : bdd_count_nodes(exact_root, NULL);
+    long exact_bytes = exact_root == NULL ? -1 : bdd_serialized_size(exact_root);
+    birp_context_use(previous);
+    birp_context_destroy(scratch);
+    if (exact_nodes == -1 || exact_bytes == -1) {
+        return NULL;
+    }
+    BDD_NODE *root = bdd_from_raster_lossy(w, h, raster, tolerance, metric);
+    if (root == NULL) {
+        return NULL;
+    }
+    int nodes = bdd_count_nodes(root, NULL);
+    long bytes = bdd_serialized_size(root);
+    if (nodes == -1 || bytes == -1) {
+        return NULL;
+    }
+    unsigned char *decoded = malloc(((size_t) w) * h + 1);
+    if (decoded == NULL) {
+        return NULL;
+    }
+    bdd_to_raster(root, w, h, decoded);
+    double psnr = raster_psnr(raster, decoded, w, h);
+    free(decoded);
+    fprintf(stderr, "lossy: tolerance %d (%s error), nodes %d -> %d (%.2fx), bytes %ld -> %ld, ",
+            tolerance, metric == LOSSY_METRIC_MAX ? "max" : "mean", exact_nodes, nodes,
+            ((double) exact_nodes) / nodes, exact_bytes, bytes);
+    if (psnr < 0) {
+        fprintf(stderr, "PSNR inf dB\n");
+    } else {
+        fprintf(stderr, "PSNR %.2f dB\n", psnr);
+    }
+    return root;
+}
+
+const char *encoding_name(int encoding) {
+    if (encoding == BDD_ENCODING_PLANES) {
+        return "planes";
+    } else if (encoding == BDD_ENCODING_GRAY) {
+        return "gray";
+    }
+    return encoding == BDD_ENCODING_AUTO ? "auto" : "nodes";
+}
+
+int write_birp_output(BDD_NODE *root, int w, int h, FILE *out) {
+    int encoding = (global_options & ENCODING_OPTIONS) >> ENCODING_SHIFT;
+    if (encoding == BDD_ENCODING_NODES) {
+        return img_write_birp(root, w, h, out);
+    }
+    long *sizes = malloc(3 * sizeof(long)); /* Of each encoding but BDD_ENCODING_AUTO */
+    if (sizes == NULL) {
+        return -1;
+    }
+    int written = img_write_birp_encoded(root, w, h, encoding, out, sizes);
+    if (written != -1 && encoding == BDD_ENCODING_AUTO) {
+        fprintf(stderr, "encoding: nodes %ld bytes, planes %ld bytes, gray %ld bytes -> %s\n",
+                *sizes, *(sizes + 1), *(sizes + 2), encoding_name(written));
+    }
+    free(sizes);
+    return written == -1 ? -1 : 0;
 }
 
 int birp_to_pgm(FILE *in, FILE *out) {
+    if (global_options & PIPELINE_OPTION) {
+        return birp_to_pgm_pipelined(in, out);
+    }
     int temp_wp = 0;
     int temp_hp = 0;
     int *wp = &temp_wp;
     int *hp = &temp_hp;
-    BDD_NODE *root = img_read_birp(in, wp, hp);
+    STATS(stats_phase(STATS_PHASE_READ));
+    TRACE_BEGIN("img_read_birp");
+    int order;
+    BDD_NODE *root = img_read_birp_ordered(in, wp, hp, &order);
+    if (root != NULL && (global_options & 0xF00) == 0x600) { /* Views expect the usual order */
+        root = bdd_order_standardize(root, *wp, *hp, order);
+        order = bdd_order_of_kind(BDD_ORDER_INTERLEAVED, bdd_min_level(*wp, *hp));
+    }
+    TRACE_END("img_read_birp");
     if (root == NULL) {
         return -1;
     }
-    unsigned char *raster = raster_data;
-    if (((root) -> level) > 26) {
+    if (((root) -> level) > BDD_RASTER_LEVEL_MAX) {
+        return -1;
+    }
+    apply_dihedral_view(root, wp, hp);
+    MAPPED_PGM map;
+    unsigned char *raster;
+    if (mapped_pgm_create(out, *wp, *hp, &map) == 0) { /* Decode straight into the output file */
+        raster = (map).raster;
+    } else {
+        raster = raster_reserve(((size_t) *wp) * *hp);
+    }
+    if (raster == NULL) {
         return -1;
     }
-    bdd_to_raster(root, *wp, *hp, raster);
-    return img_write_pgm(raster, *wp, *hp, out);
+    STATS(stats_phase(STATS_PHASE_DECODE));
+    TRACE_BEGIN("bdd_to_raster");
+    bdd_to_raster_ordered(root, *wp, *hp, raster, order);
+    TRACE_END("bdd_to_raster");
+    bdd_view_clear();
+    STATS(stats_phase(STATS_PHASE_WRITE));
+    TRACE_BEGIN("img_write_pgm");
+    int status;
+    if ((map).base != NULL) {
+        status = mapped_pgm_close(&map);
+    } else {
+        status = img_write_pgm(raster, *wp, *hp, out);
+    }
+    TRACE_END("img_write_pgm");
+    return status;
 }
 
 
@@ -50,26 +254,69 @@ int birp_to_birp(FILE *in, FILE *out) {
     int height = 0;
     int *wp = &width;
     int *hp = &height;
+    STATS(stats_phase(STATS_PHASE_READ));
+    TRACE_BEGIN("img_read_birp");
     BDD_NODE *root = img_read_birp(in, wp, hp);
+    TRACE_END("img_read_birp");
     if (root == NULL) {
         return -1;
     }
+    STATS(stats_phase(STATS_PHASE_TRANSFORM));
     int transformation = global_options & 0XF00;
     transformation >>= 8;
-    BDD_NODE *new_root;
-    if (transformation == 0x1) {
-        new_root = bdd_map(root, complement);
-    } else if (transformation == 0x2) {
-        new_root = bdd_map(root, threshold);
+    BDD_NODE *new_root = root;
+    if (transformation == 0x1 || transformation == 0x2 || transformation == 0x7) {
+        TRACE_BEGIN("bdd_map_lut");
+        new_root = apply_point_transformation(root, transformation);
+        TRACE_END("bdd_map_lut");
     } else if (transformation == 0x3) {
+        TRACE_BEGIN("bdd_zoom");
         new_root = apply_zoom_transformation(root, wp, hp);
+        TRACE_END("bdd_zoom");
     } else if (transformation == 0x4) {
+        TRACE_BEGIN("bdd_rotate");
         new_root = bdd_rotate(root, (root) -> level);
+        TRACE_END("bdd_rotate");
+    } else if (transformation == 0x5) {
+        TRACE_BEGIN("bdd_crop");
+        new_root = apply_crop_transformation(root, wp, hp);
+        TRACE_END("bdd_crop");
+    } else if (transformation == 0x6) {
+        TRACE_BEGIN("bdd_dihedral");
+        new_root = apply_dihedral_transformation(root, wp, hp);
+        TRACE_END("bdd_dihedral");
     }
     if (new_root == NULL) {
         return -1;
     }
-    return img_write_birp(new_root, width, height, out);
+    STATS(stats_phase(STATS_PHASE_WRITE));
+    TRACE_BEGIN("img_write_birp");
+    int status = write_birp_output(new_root, width, height, out);
+    TRACE_END("img_write_birp");
+    return status;
+}
+
+int birp_convert(FILE *in, FILE *out) {
+    int input_output = global_options & 0x000000FF;
+    bdd_view_clear(); /* A view describes the image being converted, and no other */
+    if (global_options & REGION_QUERY_OPTION) {
+        return birp_region_query(in, out);
+    } else if (global_options & BOUNDING_BOX_OPTION) {
+        return birp_bounding_box(in, out);
+    } else if (global_options & EDIT_OPTION) {
+        return birp_edit(in, out);
+    } else if (input_output == 0x31) {
+        return pgm_to_ascii(in, out);
+    } else if (input_output == 0x21) {
+        return pgm_to_birp(in, out);
+    } else if (input_output == 0x12) {
+        return birp_to_pgm(in, out);
+    } else if (input_output == 0x32) {
+        return birp_to_ascii(in, out);
+    } else if (input_output == 0x22) {
+        return birp_to_birp(in, out);
+    }
+    return -1;
 }
 
 unsigned char complement(unsigned char byte) {
@@ -86,33 +333,118 @@ unsigned char threshold(unsigned char byte) {
     }
 }
 
+BDD_NODE *apply_point_transformation(BDD_NODE *root, int transformation) {
+    if (transformation == 0x7) { /* The fused table of the point options */
+        return bdd_map_lut(root, point_lut);
+    }
+    unsigned char *lut = malloc(BDD_LUT_SIZE);
+    if (lut == NULL) {
+        return NULL;
+    }
+    lut_identity(lut);
+    if (transformation == 0x1) {
+        lut_complement(lut);
+    } else {
+        lut_threshold(lut, (global_options & 0x00FF0000) >> 16);
+    }
+    BDD_NODE *new_root = bdd_map_lut(root, lut);
+    free(lut);
+    return new_root;
+}
+
 BDD_NODE *apply_zoom_transformation(BDD_NODE *root, int *wp, int *hp) {
     int zoom_factor = global_options & 0x00FF0000;
     zoom_factor >>= 16;
-    BDD_NODE *new_root;
+    if ((zoom_factor & 0x70) != 0) { /* If zoom factor is negative */
+        zoom_factor = -negate_eight_bit_value(zoom_factor);
+    }
+    return zoom_transformation(root, zoom_factor, wp, hp);
+}
+
+BDD_NODE *zoom_transformation(BDD_NODE *root, int factor, int *wp, int *hp) {
     int d = ((root) -> level) / 2;
-    if ((zoom_factor & 0x70) == 0) { /* If zoom factor is positive */
-        if (0 <= (zoom_factor + d) && (zoom_factor + d) <= BDD_LEVELS_MAX) {
-            new_root = bdd_zoom(root, (root) -> level, zoom_factor);
-        } else {
-            return NULL;
-        }
-        *wp *= power(2, zoom_factor);
-        *hp *= power(2, zoom_factor);
+    if ((factor + d) < 0 || 2 * (factor + d) > BDD_LEVELS_MAX) { /* Level of the result */
+        return NULL;
+    }
+    BDD_NODE *new_root = bdd_zoom(root, (root) -> level, factor);
+    if (factor >= 0) {
+        *wp *= power(2, factor);
+        *hp *= power(2, factor);
     } else {
-        zoom_factor = negate_eight_bit_value(zoom_factor);
-        if (0 <= (-zoom_factor + d) && (-zoom_factor + d) <= BDD_LEVELS_MAX) {
-            new_root = bdd_zoom(root, (root) -> level, -zoom_factor);
-        } else {
-            return NULL;
-        };
-        int multiplier = power(2, zoom_factor);
+        int multiplier = power(2, -factor);
         *wp = ceiling(((double) *wp) / ((double) multiplier));
         *hp = ceiling(((double) *hp) / ((double) multiplier));
     }
     return new_root;
 }
 
+BDD_NODE *apply_crop_transformation(BDD_NODE *root, int *wp, int *hp) {
+    int background = global_options & 0x00FF0000;
+    background >>= 16;
+    return crop_transformation(root, background, wp, hp);
+}
+
+BDD_NODE *crop_transformation(BDD_NODE *root, int background, int *wp, int *hp) {
+    int row;
+    int col;
+    int height;
+    int width;
+    if (bdd_bounding_box(root, *wp, *hp, background, &row, &col, &height, &width) == -1) {
+        return NULL;
+    }
+    BDD_NODE *new_root = bdd_crop(root, *wp, *hp, row, col, height, width);
+    *wp = width;
+    *hp = height;
+    return new_root;
+}
+
+BDD_NODE *apply_dihedral_transformation(BDD_NODE *root, int *wp, int *hp) {
+    int transform = global_options & 0x00FF0000;
+    transform >>= 16;
+    return dihedral_transformation(root, transform, wp, hp);
+}
+
+void apply_dihedral_view(BDD_NODE *root, int *wp, int *hp) {
+    if ((global_options & 0xF00) == 0x600) {
+        bdd_view_set(root, (global_options & 0x00FF0000) >> 16, wp, hp);
+    }
+}
+
+BDD_NODE *dihedral_transformation(BDD_NODE *root, int transform, int *wp, int *hp) {
+    if (transform == BDD_DIHEDRAL_IDENTITY) {
+        return root;
+    }
+    int level = bdd_min_level(*wp, *hp);
+    if (bdd_node_to_index(root) >= BDD_NUM_LEAVES && (root) -> level > level) {
+        level = ((root) -> level + 1) & ~1;
+    }
+    BDD_NODE *new_root = bdd_dihedral(root, transform);
+    if (new_root == NULL) {
+        return NULL;
+    }
+    /*
+     * The transform acts on the enclosing square, so a mirrored coordinate
+     * moves the image to the far side of the square, from which it is cropped.
+     * bdd_crop shifts it back block by block, once per distinct grid of
+     * nodes, so this too costs time per node rather than per pixel.
+     */
+    int side = power(2, level / 2);
+    int row_offset = (transform & BDD_DIHEDRAL_FLIP_ROWS) ? side - *hp : 0;
+    int col_offset = (transform & BDD_DIHEDRAL_FLIP_COLS) ? side - *wp : 0;
+    if (transform & BDD_DIHEDRAL_TRANSPOSE) {
+        int temp = row_offset;
+        row_offset = col_offset;
+        col_offset = temp;
+        temp = *wp;
+        *wp = *hp;
+        *hp = temp;
+    }
+    if (row_offset != 0 || col_offset != 0) {
+        new_root = bdd_crop(new_root, side, side, row_offset, col_offset, *hp, *wp);
+    }
+    return new_root;
+}
+
 int negate_eight_bit_value(int value) {
     value ^= 0xFF;
     return value + 1;
@@ -134,11 +466,18 @@ int pgm_to_ascii(FILE *in, FILE *out) {
     int temp_hp = 0;
     int *wp = &temp_wp;
     int *hp = &temp_hp;
-    unsigned char *raster = raster_data;
-    if (img_read_pgm(in, wp, hp, raster, RASTER_SIZE_MAX) == -1) {
+    STATS(stats_phase(STATS_PHASE_READ));
+    MAPPED_PGM map;
+    unsigned char *raster = read_pgm_raster(in, wp, hp, &map);
+    if (raster == NULL) {
         return -1;
     }
-    if (write_ascii_to_output(raster, *wp, *hp, out) == -1) {
+    STATS(stats_phase(STATS_PHASE_WRITE));
+    TRACE_BEGIN("write_ascii_to_output");
+    int status = write_ascii_to_output(raster, *wp, *hp, out);
+    TRACE_END("write_ascii_to_output");
+    mapped_pgm_close(&map);
+    if (status == -1) {
         return -1;
     }
     return 0;
@@ -177,18 +516,148 @@ int birp_to_ascii(FILE *in, FILE *out) {
     int temp_hp = 0;
     int *wp = &temp_wp;
     int *hp = &temp_hp;
+    STATS(stats_phase(STATS_PHASE_READ));
+    TRACE_BEGIN("img_read_birp");
     BDD_NODE *root = img_read_birp(in, wp, hp);
+    TRACE_END("img_read_birp");
     if (root == NULL) {
         return -1;
     }
     int d = ((root) -> level) / 2;
     int side_length = power(2, d);
-    unsigned char *raster = raster_data;
-    if (((root) -> level) > 26) {
+    if (((root) -> level) > BDD_RASTER_LEVEL_MAX) {
+        return -1;
+    }
+    apply_dihedral_view(root, wp, hp);
+    unsigned char *raster = raster_reserve(((size_t) side_length) * side_length);
+    if (raster == NULL) {
         return -1;
     }
+    STATS(stats_phase(STATS_PHASE_DECODE));
+    TRACE_BEGIN("bdd_to_raster");
     bdd_to_raster(root, side_length, side_length, raster);
-    return write_ascii_to_output(raster, side_length, side_length, out);
+    TRACE_END("bdd_to_raster");
+    bdd_view_clear();
+    STATS(stats_phase(STATS_PHASE_WRITE));
+    TRACE_BEGIN("write_ascii_to_output");
+    int status = write_ascii_to_output(raster, side_length, side_length, out);
+    TRACE_END("write_ascii_to_output");
+    return status;
+}
+
+int birp_region_query(FILE *in, FILE *out) {
+    int width = 0;
+    int height = 0;
+    int *wp = &width;
+    int *hp = &height;
+    STATS(stats_phase(STATS_PHASE_READ));
+    TRACE_BEGIN("img_read_birp");
+    BDD_NODE *root = img_read_birp(in, wp, hp);
+    TRACE_END("img_read_birp");
+    if (root == NULL) {
+        return -1;
+    }
+    STATS(stats_phase(STATS_PHASE_TRANSFORM));
+    FILE *queries = fopen(region_query_path, "r");
+    if (queries == NULL) {
+        return -1;
+    }
+    int row;
+    int col;
+    int rows;
+    int cols;
+    long long count;
+    int matched;
+    int status = 0;
+    while ((matched = fscanf(queries, "%d %d %d %d", &row, &col, &rows, &cols)) == 4) {
+        long long sum = bdd_region_sum(root, width, height, row, col, rows, cols, &count);
+        if (sum == -1) {
+            status = -1;
+            break;
+        }
+        double mean = count == 0 ? 0.0 : ((double) sum) / ((double) count);
+        fprintf(out, "%lld %lld %.3f\n", sum, count, mean);
+    }
+    if (matched != EOF) { /* Malformed query line */
+        status = -1;
+    }
+    fclose(queries);
+    if (status == -1) {
+        return -1;
+    }
+    return fflush(out);
+}
+
+int birp_edit(FILE *in, FILE *out) {
+    int width = 0;
+    int height = 0;
+    int *wp = &width;
+    int *hp = &height;
+    STATS(stats_phase(STATS_PHASE_READ));
+    TRACE_BEGIN("img_read_birp");
+    BDD_NODE *root = img_read_birp(in, wp, hp);
+    TRACE_END("img_read_birp");
+    if (root == NULL) {
+        return -1;
+    }
+    STATS(stats_phase(STATS_PHASE_TRANSFORM));
+    FILE *edits = fopen(edit_script_path, "r");
+    if (edits == NULL) {
+        return -1;
+    }
+    TRACE_BEGIN("bdd_fill_rect");
+    int row;
+    int col;
+    int rows;
+    int cols;
+    int value;
+    int matched;
+    while ((matched = fscanf(edits, "%d %d %d %d %d", &row, &col, &rows, &cols, &value)) == 5) {
+        if (value < 0 || value > 255) {
+            root = NULL;
+        } else {
+            root = bdd_fill_rect(root, width, height, row, col, rows, cols, value);
+        }
+        if (root == NULL) {
+            break;
+        }
+    }
+    TRACE_END("bdd_fill_rect");
+    fclose(edits);
+    if (root == NULL || matched != EOF) { /* Failed or malformed edit */
+        return -1;
+    }
+    STATS(stats_phase(STATS_PHASE_WRITE));
+    TRACE_BEGIN("img_write_birp");
+    int status = write_birp_output(root, width, height, out);
+    TRACE_END("img_write_birp");
+    return status;
+}
+
+int birp_bounding_box(FILE *in, FILE *out) {
+    int width = 0;
+    int height = 0;
+    int *wp = &width;
+    int *hp = &height;
+    STATS(stats_phase(STATS_PHASE_READ));
+    TRACE_BEGIN("img_read_birp");
+    BDD_NODE *root = img_read_birp(in, wp, hp);
+    TRACE_END("img_read_birp");
+    if (root == NULL) {
+        return -1;
+    }
+    STATS(stats_phase(STATS_PHASE_TRANSFORM));
+    int background = global_options & 0x00FF0000;
+    background >>= 16;
+    int row;
+    int col;
+    int box_height;
+    int box_width;
+    if (bdd_bounding_box(root, width, height, background, &row, &col, &box_height, &box_width) == -1) {
+        return -1;
+    }
+    fprintf(out, "%d %d %d %d\n", row, col, box_height, box_width);
+    return fflush(out);
 }
 
 /**
@@ -208,7 +677,7 @@ int birp_to_ascii(FILE *in, FILE *out) {
  */
 int validargs(int argc, char **argv) {
     int current_arg = 1;
-    if (argc == 1 || argc > 7) { /* First argument is always the executable name */
+    if (argc == 1) { /* First argument is always the executable name */
         return -1;
     }
     argv += 1; /* Move to current arg */
@@ -216,6 +685,16 @@ int validargs(int argc, char **argv) {
         return 0;
     }
     global_options = 0x22; /* Default global_options */
+    region_query_path = NULL;
+    edit_script_path = NULL;
+    trace_path = NULL;
+    input_path = NULL;
+    output_path = NULL;
+    batch_output_dir = NULL;
+    batch_inputs = NULL;
+    batch_input_count = 0;
+    batch_jobs = 1;
+    order_kind = BDD_ORDER_INTERLEAVED;
     for (int i = 0; i < 2; i++) { /* Check for input/output args twice because there can be 0-2 of these args */
         int input_output_format = check_input_output_format(argv, argc - current_arg);
         if (input_output_format == 1) {
@@ -228,20 +707,28 @@ int validargs(int argc, char **argv) {
             return 0;
         }
     }
-    if ((argc - current_arg) == 2) {
-        int additional_args_with_parameter = check_additional_args_with_parameter(argv);
-        if (additional_args_with_parameter == -1) {
-            return -1;
+    int transformation_seen = 0;
+    while (current_arg < argc) {
+        if (**argv != '-') { /* The remaining arguments are input files for batch mode */
+            batch_inputs = argv;
+            batch_input_count = argc - current_arg;
+            break;
         }
-    } else if ((argc - current_arg) == 1) {
-        int additional_args = check_additional_args(argv);
-        if (additional_args == -1) {
+        int args_consumed = check_extended_args(argv, argc - current_arg);
+        if (args_consumed == 0) { /* Not an extended option, so it must be the (single) transformation */
+            if (transformation_seen) {
+                return -1;
+            }
+            args_consumed = check_transformation_args(argv, argc - current_arg);
+            transformation_seen = 1;
+        }
+        if (args_consumed == -1) {
             return -1;
         }
-    } else { /* If more than 2 args left by this point, command is invalid */
-        return -1;
+        current_arg += args_consumed;
+        argv += args_consumed;
     }
-    return 0;
+    return validate_extended_options();
 }
 
 int check_help_argument(char **argv) {
@@ -288,7 +775,7 @@ int check_input_output_format(char **argv, int args_remaining) {
 }
 
 int check_additional_args(char **argv) {
-    if (global_options != 0x22) { /* If input and output format not both 'birp' */
+    if ((global_options & ~(RUN_OPTIONS | ENCODING_OPTIONS)) != 0x22) { /* If input and output format not both 'birp' */
         return -1;
     }
     if (compare_strings(*argv, "-n")) {
@@ -302,7 +789,7 @@ int check_additional_args(char **argv) {
 }
 
 int check_additional_args_with_parameter(char **argv) {
-    if (global_options != 0x22) { /* If input and output format not both 'birp' */
+    if ((global_options & ~(RUN_OPTIONS | ENCODING_OPTIONS)) != 0x22) { /* If input and output format not both 'birp' */
         return -1;
     }
     if (compare_strings(*argv, "-t")) {
@@ -341,12 +828,355 @@ int check_additional_args_with_parameter(char **argv) {
         } else {
             return -1;
         }
+    } else if (compare_strings(*argv, "-c")) {
+        argv++;
+        if (!validate_number(*argv)) {
+            return -1;
+        }
+        int background = string_to_int(*argv);
+        if (background >= 0 && background <= 255) {
+            global_options |= 0x500;
+            set_global_options_transformation_bits(background);
+        } else {
+            return -1;
+        }
     } else {
         return -1;
     }
     return 1;
 }
 
+int check_transformation_args(char **argv, int args_remaining) {
+    if (compare_strings(*argv, "-t") || compare_strings(*argv, "-z") || compare_strings(*argv, "-Z")
+        || compare_strings(*argv, "-c")) {
+        if (args_remaining < 2 || check_additional_args_with_parameter(argv) == -1) {
+            return -1;
+        }
+        return 2;
+    }
+    if (check_additional_args(argv) == -1) {
+        return -1;
+    }
+    return 1;
+}
+
+int check_extended_args(char **argv, int args_remaining) {
+    if (compare_strings(*argv, "-q")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        argv++;
+        region_query_path = *argv;
+        global_options |= REGION_QUERY_OPTION;
+        return 2;
+    } else if (compare_strings(*argv, "-e")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        argv++;
+        edit_script_path = *argv;
+        global_options |= EDIT_OPTION;
+        return 2;
+    } else if (compare_strings(*argv, "-b")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        argv++;
+        if (!validate_number(*argv)) {
+            return -1;
+        }
+        int background = string_to_int(*argv);
+        if (background < 0 || background > 255) {
+            return -1;
+        }
+        global_options |= BOUNDING_BOX_OPTION;
+        set_global_options_transformation_bits(background);
+        return 2;
+    } else if (compare_strings(*argv, "-l") || compare_strings(*argv, "-L")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        if (compare_strings(*argv, "-L")) {
+            global_options |= LOSSY_MEAN_OPTION;
+        }
+        argv++;
+        if (!validate_number(*argv)) {
+            return -1;
+        }
+        int tolerance = string_to_int(*argv);
+        if (tolerance < 0 || tolerance > 255) {
+            return -1;
+        }
+        global_options |= LOSSY_OPTION;
+        set_global_options_transformation_bits(tolerance);
+        return 2;
+    } else if (compare_strings(*argv, "--stats")) {
+        global_options |= STATS_OPTION;
+        return 1;
+    } else if (compare_strings(*argv, "--trace")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        argv++;
+        trace_path = *argv;
+        global_options |= TRACE_OPTION;
+        return 2;
+    } else if (compare_strings(*argv, "-d")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        argv++;
+        batch_output_dir = *argv;
+        global_options |= BATCH_OPTION;
+        return 2;
+    } else if (compare_strings(*argv, "--input") || compare_strings(*argv, "--output")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        if (compare_strings(*argv, "--input")) {
+            input_path = *(argv + 1);
+        } else {
+            output_path = *(argv + 1);
+        }
+        return 2;
+    } else if (point_argument(*argv) != 0) {
+        return check_point_args(argv, args_remaining);
+    } else if (dihedral_argument(*argv) != -1) {
+        int transformation = global_options & 0xF00;
+        if (transformation != 0 && transformation != 0x600) { /* Only symmetries can be chained */
+            return -1;
+        }
+        int transform = transformation == 0 ? BDD_DIHEDRAL_IDENTITY : (global_options & 0x00FF0000) >> 16;
+        global_options |= 0x600;
+        set_global_options_transformation_bits(bdd_dihedral_compose(transform, dihedral_argument(*argv)));
+        return 1;
+    } else if (compare_strings(*argv, "--encoding")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        argv++;
+        int encoding;
+        if (compare_strings(*argv, "nodes")) {
+            encoding = BDD_ENCODING_NODES;
+        } else if (compare_strings(*argv, "planes")) {
+            encoding = BDD_ENCODING_PLANES;
+        } else if (compare_strings(*argv, "gray")) {
+            encoding = BDD_ENCODING_GRAY;
+        } else if (compare_strings(*argv, "auto")) {
+            encoding = BDD_ENCODING_AUTO;
+        } else {
+            return -1;
+        }
+        global_options = (global_options & ~ENCODING_OPTIONS) | (encoding << ENCODING_SHIFT);
+        return 2;
+    } else if (compare_strings(*argv, "--order")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        argv++;
+        if (compare_strings(*argv, "interleaved")) {
+            order_kind = BDD_ORDER_INTERLEAVED;
+        } else if (compare_strings(*argv, "columns-first")) {
+            order_kind = BDD_ORDER_COLUMNS_FIRST;
+        } else if (compare_strings(*argv, "row-blocks")) {
+            order_kind = BDD_ORDER_ROW_BLOCKS;
+        } else if (compare_strings(*argv, "column-blocks")) {
+            order_kind = BDD_ORDER_COLUMN_BLOCKS;
+        } else if (compare_strings(*argv, "search")) {
+            order_kind = BDD_ORDER_SEARCH;
+        } else {
+            return -1;
+        }
+        return 2;
+    } else if (compare_strings(*argv, "--pipeline")) {
+        global_options |= PIPELINE_OPTION;
+        return 1;
+    } else if (compare_strings(*argv, "--threads")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        argv++;
+        if (!validate_number(*argv) || **argv == '\0') {
+            return -1;
+        }
+        int threads = string_to_int(*argv);
+        if (threads < 1 || threads > BATCH_JOBS_MAX) {
+            return -1;
+        }
+        pool_set_threads(threads);
+        return 2;
+    } else if (compare_strings(*argv, "-j")) {
+        if (args_remaining < 2) {
+            return -1;
+        }
+        argv++;
+        if (!validate_number(*argv) || **argv == '\0') {
+            return -1;
+        }
+        batch_jobs = string_to_int(*argv);
+        if (batch_jobs < 1 || batch_jobs > BATCH_JOBS_MAX) {
+            return -1;
+        }
+        return 2;
+    }
+    return 0;
+}
+
+int point_argument(char *arg) {
+    if (compare_strings(arg, "-n")) {
+        return 1;
+    } else if (compare_strings(arg, "-t") || compare_strings(arg, "--gamma") || compare_strings(arg, "--posterize")) {
+        return 2;
+    } else if (compare_strings(arg, "--levels") || compare_strings(arg, "--invert")
+               || compare_strings(arg, "--clamp")) {
+        return 3;
+    }
+    return 0;
+}
+
+int check_point_args(char **argv, int args_remaining) {
+    int transformation = global_options & 0xF00;
+    int plain = compare_strings(*argv, "-n") || compare_strings(*argv, "-t");
+    if (plain && transformation == 0) {
+        return 0; /* Alone, -n and -t are the transformations they always were */
+    }
+    if (args_remaining < point_argument(*argv) || (transformation != 0 && transformation != 0x100
+                                                   && transformation != 0x200 && transformation != 0x700)) {
+        return -1; /* Only point operations can be chained */
+    }
+    if (transformation != 0x700) { /* Start the table, from the -n or -t before this if there is one */
+        if (point_lut == NULL && (point_lut = malloc(BDD_LUT_SIZE)) == NULL) {
+            return -1;
+        }
+        lut_identity(point_lut);
+        if (transformation == 0x100) {
+            lut_complement(point_lut);
+        } else if (transformation == 0x200) {
+            lut_threshold(point_lut, (global_options & 0x00FF0000) >> 16);
+        }
+        global_options = (global_options & ~0xF00) | 0x700;
+        set_global_options_transformation_bits(0);
+    }
+    if (compare_strings(*argv, "-n")) {
+        lut_complement(point_lut);
+        return 1;
+    }
+    if (compare_strings(*argv, "--gamma")) {
+        double gamma = string_to_decimal(*(argv + 1));
+        if (gamma <= 0 || gamma > 16) {
+            return -1;
+        }
+        lut_gamma(point_lut, gamma);
+        return 2;
+    }
+    int low = validate_number(*(argv + 1)) && **(argv + 1) != '\0' ? string_to_int(*(argv + 1)) : -1;
+    if (compare_strings(*argv, "-t")) {
+        if (low < 0 || low > 255) {
+            return -1;
+        }
+        lut_threshold(point_lut, low);
+        return 2;
+    }
+    if (compare_strings(*argv, "--posterize")) {
+        if (low < 2 || low > 256) {
+            return -1;
+        }
+        lut_posterize(point_lut, low);
+        return 2;
+    }
+    int high = validate_number(*(argv + 2)) && **(argv + 2) != '\0' ? string_to_int(*(argv + 2)) : -1;
+    if (low < 0 || low > 255 || high < low || high > 255) {
+        return -1;
+    }
+    if (compare_strings(*argv, "--levels")) {
+        if (low == high) {
+            return -1;
+        }
+        lut_levels(point_lut, low, high);
+    } else if (compare_strings(*argv, "--invert")) {
+        lut_invert_range(point_lut, low, high);
+    } else {
+        lut_clamp(point_lut, low, high);
+    }
+    return 3;
+}
+
+int dihedral_argument(char *arg) {
+    if (compare_strings(arg, "--hflip")) {
+        return BDD_DIHEDRAL_HFLIP;
+    } else if (compare_strings(arg, "--vflip")) {
+        return BDD_DIHEDRAL_VFLIP;
+    } else if (compare_strings(arg, "--transpose")) {
+        return BDD_DIHEDRAL_TRANSPOSE;
+    } else if (compare_strings(arg, "--antitranspose")) {
+        return BDD_DIHEDRAL_ANTI_TRANSPOSE;
+    } else if (compare_strings(arg, "--rotate90")) {
+        return BDD_DIHEDRAL_ROTATE_90;
+    } else if (compare_strings(arg, "--rotate180")) {
+        return BDD_DIHEDRAL_ROTATE_180;
+    } else if (compare_strings(arg, "--rotate270")) {
+        return BDD_DIHEDRAL_ROTATE_270;
+    }
+    return -1;
+}
+
+int validate_extended_options() {
+    if ((global_options & BATCH_OPTION) != 0 && batch_input_count == 0) { /* -d needs input files, */
+        return -1;
+    }
+    if ((global_options & BATCH_OPTION) == 0 && batch_input_count != 0) { /* and input files need -d */
+        return -1;
+    }
+    if ((global_options & BATCH_OPTION) != 0 && (input_path != NULL || output_path != NULL)) {
+        return -1; /* Batch mode names its own files */
+    }
+    if (batch_jobs > 1 && (global_options & (BATCH_OPTION | STATS_OPTION | TRACE_OPTION)) != BATCH_OPTION) {
+        return -1; /* -j needs -d, and the instrumentation is not thread-safe */
+    }
+    for (int i = 0; i < batch_input_count; i++) {
+        if (**(batch_inputs + i) == '-') { /* Options must precede the input files */
+            return -1;
+        }
+    }
+    if ((global_options & 0xF00) == 0x700 && (global_options & 0xFF) != 0x22) { /* Point operations are birp to birp */
+        return -1;
+    }
+    if ((global_options & 0xF00) == 0x600 && (global_options & 0x0F) != 0x2) { /* Symmetries need birp input */
+        return -1;
+    }
+    int modes = global_options & (REGION_QUERY_OPTION | BOUNDING_BOX_OPTION | EDIT_OPTION);
+    if (modes != 0) {
+        if ((global_options & 0x0F) != 0x2 || (global_options & 0xF00) != 0) { /* Modes read birp input only */
+            return -1;
+        }
+        if (modes != REGION_QUERY_OPTION && modes != BOUNDING_BOX_OPTION && modes != EDIT_OPTION) { /* At most one mode */
+            return -1;
+        }
+        if (modes == EDIT_OPTION && (global_options & 0xF0) != 0x20) { /* Edits are written as birp */
+            return -1;
+        }
+    }
+    if ((global_options & ENCODING_OPTIONS) != 0) { /* Only birp output has an encoding */
+        if ((global_options & 0xF0) != 0x20 || (global_options & (REGION_QUERY_OPTION | BOUNDING_BOX_OPTION))) {
+            return -1;
+        }
+    }
+    if (order_kind != BDD_ORDER_INTERLEAVED) { /* Orders are chosen when a pgm image is encoded */
+        if ((global_options & ~(STATS_OPTION | TRACE_OPTION | BATCH_OPTION)) != 0x21) {
+            return -1;
+        }
+    }
+    if (global_options & LOSSY_OPTION) {
+        if ((global_options & 0xFF) != 0x21) { /* Lossy encoding applies to pgm to birp only */
+            return -1;
+        }
+        if ((global_options & (LOSSY_OPTION | LOSSY_MEAN_OPTION)) != (global_options & 0xF000)) { /* One -l or -L */
+            return -1;
+        }
+    }
+    return 0;
+}
+
 void set_global_options_transformation_bits(int value) {
     value <<= 16;
     value &= 0x00FF0000; /* Mask so only bits 16-23 are relevant */
@@ -364,6 +1194,28 @@ int validate_number(char *str) {
     return 1;
 }
 
+double string_to_decimal(char *str) {
+    double result = 0;
+    double scale = 0;
+    int digits = 0;
+    while (*str != '\0') {
+        if (*str == '.' && scale == 0) {
+            scale = 1;
+        } else if (*str >= '0' && *str <= '9') {
+            result = result * 10 + (*str - '0');
+            scale *= 10;
+            digits++;
+        } else {
+            return -1;
+        }
+        str++;
+    }
+    if (digits == 0) {
+        return -1;
+    }
+    return scale == 0 ? result : result / scale;
+}
+
 int string_to_int(char *str) {
     int result = 0;
     while (*str != '\0') { /* While string is not at the null terminator */
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bdd.h"
+#include "debug.h"
+#include "bdd2.h"
+#include "cedge.h"
+#include "cedge2.h"
+#include "stats.h"
+
+_Static_assert(BDD_LEVELS_MAX + BDD_CEDGE_LEVEL < (1 << 7), "tagged levels must fit in BDD_NODE");
+_Static_assert(2 * BDD_NODES_MAX <= (1 << 25), "left edges must fit in BDD_NODE");
+
+/*
+ * The ordinary node each edge has been converted to by bdd_cedge_to_bdd,
+ * plus one, indexed by edge (so that both polarities of a node are
+ * remembered); 0 if it has not been converted yet.  Per thread, since each
+ * thread may convert in a context of its own.
+ */
+static _Thread_local int *cedge_memo = NULL;
+
+int bdd_cedge_lookup(int level, int left, int right) {
+    if (left == right) {
+        return left;
+    }
+    int complement = left & BDD_CEDGE_COMPLEMENT; /* Keep the left edge regular */
+    int index = bdd_lookup(level + BDD_CEDGE_LEVEL, left ^ complement, right ^ complement);
+    if (index == -1) {
+        return -1;
+    }
+    return CEDGE_MAKE(index, complement);
+}
+
+int bdd_cedge_from_bdd(BDD_NODE *node) {
+    if (clear_bdd_index_map() == -1) {
+        return -1;
+    }
+    return bdd_cedge_from_bdd_recurse(node);
+}
+
+int bdd_cedge_from_bdd_recurse(BDD_NODE *node) {
+    int bdd_node_index = bdd_node_to_index(node);
+    if (bdd_node_index < BDD_NUM_LEAVES) {
+        return bdd_node_index == 0 ? BDD_CEDGE_BLACK : bdd_node_index == 255 ? BDD_CEDGE_WHITE : -1;
+    }
+    STATS(birp_stats.memo_lookups++);
+    if (*(bdd_index_map + bdd_node_index) != 0) { /* If node has already been converted */
+        STATS(birp_stats.memo_hits++);
+        return *(bdd_index_map + bdd_node_index) - 1;
+    }
+    int left = bdd_cedge_from_bdd_recurse(index_to_bdd_node((node) -> left));
+    int right = left == -1 ? -1 : bdd_cedge_from_bdd_recurse(index_to_bdd_node((node) -> right));
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    int edge = bdd_cedge_lookup((node) -> level, left, right);
+    if (edge == -1) {
+        return -1;
+    }
+    /* Offset by one, so that a subtree that is all black is remembered too */
+    *(bdd_index_map + bdd_node_index) = edge + 1;
+    return edge;
+}
+
+BDD_NODE *bdd_cedge_to_bdd(int edge) {
+    cedge_memo = calloc(2 * (size_t) current_bdd_node_index, sizeof(int));
+    if (cedge_memo == NULL) {
+        return NULL;
+    }
+    int index = bdd_cedge_to_bdd_recurse(edge);
+    free(cedge_memo);
+    cedge_memo = NULL;
+    if (index == -1) {
+        return NULL;
+    }
+    return index_to_bdd_node(index);
+}
+
+int bdd_cedge_to_bdd_recurse(int edge) {
+    int complement = edge & BDD_CEDGE_COMPLEMENT;
+    if (CEDGE_INDEX(edge) == 0) {
+        return complement ? 255 : 0;
+    }
+    STATS(birp_stats.memo_lookups++);
+    if (*(cedge_memo + edge) != 0) { /* If edge has already been converted */
+        STATS(birp_stats.memo_hits++);
+        return *(cedge_memo + edge) - 1;
+    }
+    BDD_NODE *node = index_to_bdd_node(CEDGE_INDEX(edge));
+    int left = bdd_cedge_to_bdd_recurse((node) -> left ^ complement);
+    int right = bdd_cedge_to_bdd_recurse((node) -> right ^ complement);
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    int new_index = bdd_lookup((node) -> level - BDD_CEDGE_LEVEL, left, right);
+    if (new_index == -1) {
+        return -1;
+    }
+    *(cedge_memo + edge) = new_index + 1;
+    return new_index;
+}
+
+int bdd_cedge_count_nodes(int edge) {
+    if (clear_bdd_index_map() == -1) {
+        return -1;
+    }
+    return 1 + bdd_cedge_count_nodes_recurse(edge); /* The leaf, reached from every image */
+}
+
+int bdd_cedge_count_nodes_recurse(int edge) {
+    int node_index = CEDGE_INDEX(edge);
+    if (node_index == 0 || *(bdd_index_map + node_index) != 0) { /* Leaf, or already counted */
+        return 0;
+    }
+    *(bdd_index_map + node_index) = 1;
+    BDD_NODE *node = index_to_bdd_node(node_index);
+    return 1 + bdd_cedge_count_nodes_recurse((node) -> left)
+        + bdd_cedge_count_nodes_recurse((node) -> right);
+}
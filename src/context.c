@@ -0,0 +1,45 @@
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "bdd.h"
+#include "context.h"
+
+static BIRP_CONTEXT birp_default_context = { .current_node_index = BDD_NUM_LEAVES };
+
+_Thread_local BIRP_CONTEXT *birp_context = &birp_default_context;
+
+BIRP_CONTEXT *birp_context_create() {
+    BIRP_CONTEXT *ctx = calloc(1, sizeof(BIRP_CONTEXT));
+    if (ctx == NULL) {
+        return NULL;
+    }
+    (ctx) -> current_node_index = BDD_NUM_LEAVES;
+    return ctx;
+}
+
+void birp_context_destroy(BIRP_CONTEXT *ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+    if ((ctx) -> nodes != NULL) {
+        munmap((ctx) -> nodes, BDD_NODES_MAX * sizeof(BDD_NODE));
+    }
+    free((ctx) -> hash_map);
+    free((ctx) -> index_map);
+    free((ctx) -> sum_table);
+    free((ctx) -> raster);
+    free((ctx) -> quad_nodes);
+    free((ctx) -> quad_hash_map);
+    if (ctx != &birp_default_context) {
+        free(ctx);
+    } else { /* The default context stays usable, empty */
+        BIRP_CONTEXT empty = { .current_node_index = BDD_NUM_LEAVES };
+        *ctx = empty;
+    }
+}
+
+BIRP_CONTEXT *birp_context_use(BIRP_CONTEXT *ctx) {
+    BIRP_CONTEXT *previous = birp_context;
+    birp_context = ctx == NULL ? &birp_default_context : ctx;
+    return previous;
+}
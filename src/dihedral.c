@@ -0,0 +1,224 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bdd.h"
+#include "debug.h"
+#include "bdd2.h"
+#include "dihedral.h"
+#include "dihedral2.h"
+#include "stats.h"
+
+int bdd_dihedral_compose(int first, int second) {
+    /*
+     * The second transform picks pixels of the first's result, which the
+     * first picks from the original, so a coordinate the second mirrors is
+     * the original coordinate the first placed there: the second's flips
+     * trade places if the first transposes.
+     */
+    int flips = second & (BDD_DIHEDRAL_FLIP_ROWS | BDD_DIHEDRAL_FLIP_COLS);
+    if (first & BDD_DIHEDRAL_TRANSPOSE) {
+        flips = ((flips & BDD_DIHEDRAL_FLIP_ROWS) ? BDD_DIHEDRAL_FLIP_COLS : 0)
+                | ((flips & BDD_DIHEDRAL_FLIP_COLS) ? BDD_DIHEDRAL_FLIP_ROWS : 0);
+    }
+    return ((first ^ second) & BDD_DIHEDRAL_TRANSPOSE) | ((first ^ flips) & (BDD_DIHEDRAL_FLIP_ROWS | BDD_DIHEDRAL_FLIP_COLS));
+}
+
+/*
+ * The transformed quadrant of a node at an even level that the transform
+ * places at a quadrant (0 for top or left, 1 for bottom or right) of the result.
+ */
+int bdd_dihedral_quadrant(BDD_NODE *node, int level, int transform, int out_row, int out_col) {
+    int row = (transform & BDD_DIHEDRAL_TRANSPOSE) ? out_col : out_row;
+    int col = (transform & BDD_DIHEDRAL_TRANSPOSE) ? out_row : out_col;
+    if (transform & BDD_DIHEDRAL_FLIP_ROWS) {
+        row = !row;
+    }
+    if (transform & BDD_DIHEDRAL_FLIP_COLS) {
+        col = !col;
+    }
+    BDD_NODE *half = row ? RIGHT(node, level) : LEFT(node, level);
+    return bdd_dihedral_recurse(col ? RIGHT(half, level - 1) : LEFT(half, level - 1), transform);
+}
+
+BDD_NODE *bdd_dihedral(BDD_NODE *node, int transform) {
+    if (clear_bdd_index_map() == -1) {
+        return NULL;
+    }
+    int index = bdd_dihedral_recurse(node, transform & 0x7);
+    if (index == -1) {
+        return NULL;
+    }
+    return index_to_bdd_node(index);
+}
+
+int bdd_dihedral_recurse(BDD_NODE *node, int transform) {
+    int bdd_node_index = bdd_node_to_index(node);
+    if (bdd_node_index < BDD_NUM_LEAVES) {
+        return bdd_node_index;
+    }
+    STATS(birp_stats.memo_lookups++);
+    if (*(bdd_index_map + bdd_node_index) != 0) { /* If node has already been mapped */
+        STATS(birp_stats.memo_hits++);
+        return *(bdd_index_map + bdd_node_index);
+    }
+    /*
+     * The node's pair of levels: row level 2k, which may have been skipped,
+     * and column level 2k-1.  Each quadrant of the result is the transformed
+     * quadrant of the node that the transform maps there.
+     */
+    int level = (((node) -> level) + 1) & ~1;
+    int top_left = bdd_dihedral_quadrant(node, level, transform, 0, 0);
+    int top_right = bdd_dihedral_quadrant(node, level, transform, 0, 1);
+    int bot_left = bdd_dihedral_quadrant(node, level, transform, 1, 0);
+    int bot_right = bdd_dihedral_quadrant(node, level, transform, 1, 1);
+    if (top_left == -1 || top_right == -1 || bot_left == -1 || bot_right == -1) {
+        return -1;
+    }
+    int top = bdd_lookup(level - 1, top_left, top_right);
+    int bottom = bdd_lookup(level - 1, bot_left, bot_right);
+    if (top == -1 || bottom == -1) {
+        return -1;
+    }
+    int new_index = bdd_lookup(level, top, bottom);
+    if (new_index == -1) {
+        return -1;
+    }
+    *(bdd_index_map + bdd_node_index) = new_index; /* Map old node to new node */
+    return new_index;
+}
+
+void bdd_view_set(BDD_NODE *root, int transform, int *wp, int *hp) {
+    bdd_view = (BDD_VIEW) { root, transform & 0x7, *wp, *hp };
+    if (transform & BDD_DIHEDRAL_TRANSPOSE) {
+        int temp = *wp;
+        *wp = *hp;
+        *hp = temp;
+    }
+}
+
+void bdd_view_clear() {
+    bdd_view = (BDD_VIEW) { NULL, BDD_DIHEDRAL_IDENTITY, 0, 0 };
+}
+
+int bdd_view_active(BDD_NODE *node) {
+    return node != NULL && node == (bdd_view).root && (bdd_view).transform != BDD_DIHEDRAL_IDENTITY;
+}
+
+void bdd_view_to_raster(int w, int h, unsigned char *raster, int row_min, int row_max) {
+    int transform = (bdd_view).transform;
+    int view_w = (transform & BDD_DIHEDRAL_TRANSPOSE) ? (bdd_view).height : (bdd_view).width;
+    int view_h = (transform & BDD_DIHEDRAL_TRANSPOSE) ? (bdd_view).width : (bdd_view).height;
+    int col_max = view_w < w ? view_w : w;
+    row_max = row_max < h ? row_max : h;
+    for (int r = row_min; r < row_max; r++) { /* Padding around the transformed image */
+        unsigned char *pixel = raster + ((size_t) r * w) + (r < view_h ? col_max : 0);
+        for (int c = r < view_h ? col_max : 0; c < w; c++) {
+            *pixel = 0;
+            pixel++;
+        }
+    }
+    if (row_max > view_h) {
+        row_max = view_h;
+    }
+    if (row_min >= row_max || col_max <= 0) {
+        return;
+    }
+    /* The rectangle of the untransformed image that lands in the rows */
+    int src_row_min = row_min;
+    int src_row_max = row_max;
+    int src_col_min = 0;
+    int src_col_max = col_max;
+    if (transform & BDD_DIHEDRAL_TRANSPOSE) {
+        src_row_min = 0;
+        src_row_max = col_max;
+        src_col_min = row_min;
+        src_col_max = row_max;
+    }
+    if (transform & BDD_DIHEDRAL_FLIP_ROWS) {
+        int temp = src_row_min;
+        src_row_min = (bdd_view).height - src_row_max;
+        src_row_max = (bdd_view).height - temp;
+    }
+    if (transform & BDD_DIHEDRAL_FLIP_COLS) {
+        int temp = src_col_min;
+        src_col_min = (bdd_view).width - src_col_max;
+        src_col_max = (bdd_view).width - temp;
+    }
+    BDD_NODE *root = (bdd_view).root;
+    int level = bdd_min_level((bdd_view).width, (bdd_view).height);
+    if (bdd_node_to_index(root) >= BDD_NUM_LEAVES && (root) -> level > level) {
+        level = (root) -> level;
+    }
+    bdd_view_to_raster_recurse(root, level, 0, 0, src_row_min, src_row_max, src_col_min, src_col_max, w, raster);
+}
+
+void bdd_view_to_raster_recurse(BDD_NODE *node, int level, int row, int col, int row_min, int row_max,
+                                int col_min, int col_max, int w, unsigned char *raster) {
+    int row_end = row + LEVEL_ROWS(level);
+    int col_end = col + LEVEL_COLS(level);
+    if (row_end <= row_min || row >= row_max || col_end <= col_min || col >= col_max) {
+        return;
+    }
+    int node_index = bdd_node_to_index(node);
+    if (node_index < BDD_NUM_LEAVES) { /* Fill the uniform region, clipped, at its transformed position */
+        bdd_view_fill(row > row_min ? row : row_min, row_end < row_max ? row_end : row_max,
+                      col > col_min ? col : col_min, col_end < col_max ? col_end : col_max,
+                      node_index, w, raster);
+        return;
+    }
+    bdd_view_to_raster_recurse(LEFT(node, level), level - 1, row, col, row_min, row_max, col_min, col_max, w, raster);
+    if (level % 2 == 0) { /* Top and bottom halves */
+        bdd_view_to_raster_recurse(RIGHT(node, level), level - 1, row + LEVEL_ROWS(level - 1), col,
+                                   row_min, row_max, col_min, col_max, w, raster);
+    } else { /* Left and right halves */
+        bdd_view_to_raster_recurse(RIGHT(node, level), level - 1, row, col + LEVEL_COLS(level - 1),
+                                   row_min, row_max, col_min, col_max, w, raster);
+    }
+}
+
+void bdd_view_fill(int row_min, int row_max, int col_min, int col_max, int value, int w, unsigned char *raster) {
+    int transform = (bdd_view).transform;
+    if (transform & BDD_DIHEDRAL_FLIP_ROWS) {
+        int temp = row_min;
+        row_min = (bdd_view).height - row_max;
+        row_max = (bdd_view).height - temp;
+    }
+    if (transform & BDD_DIHEDRAL_FLIP_COLS) {
+        int temp = col_min;
+        col_min = (bdd_view).width - col_max;
+        col_max = (bdd_view).width - temp;
+    }
+    if (transform & BDD_DIHEDRAL_TRANSPOSE) {
+        int temp = row_min;
+        row_min = col_min;
+        col_min = temp;
+        temp = row_max;
+        row_max = col_max;
+        col_max = temp;
+    }
+    for (int r = row_min; r < row_max; r++) {
+        unsigned char *pixel = raster + ((size_t) r * w) + col_min;
+        for (int c = col_min; c < col_max; c++) {
+            *pixel = value;
+            pixel++;
+        }
+    }
+}
+
+int bdd_view_map(int *rp, int *cp) {
+    int transform = (bdd_view).transform;
+    int row = (transform & BDD_DIHEDRAL_TRANSPOSE) ? *cp : *rp;
+    int col = (transform & BDD_DIHEDRAL_TRANSPOSE) ? *rp : *cp;
+    if (transform & BDD_DIHEDRAL_FLIP_ROWS) {
+        row = (bdd_view).height - 1 - row;
+    }
+    if (transform & BDD_DIHEDRAL_FLIP_COLS) {
+        col = (bdd_view).width - 1 - col;
+    }
+    if (row < 0 || row >= (bdd_view).height || col < 0 || col >= (bdd_view).width) {
+        return -1;
+    }
+    *rp = row;
+    *cp = col;
+    return 0;
+}
@@ -9,6 +9,8 @@
 
 #include "bdd.h"
 #include "image.h"
+#include "planes.h"
+#include "order.h"
 
 static int skip_whitespace(FILE *f) {
     int c;
@@ -67,9 +69,7 @@ bad:
 }
 
 // Spec: http://netpbm.sourceforge.net/doc/pgm.html
-int img_read_pgm(FILE *file, int *wp, int *hp, unsigned char *raster, size_t size) {
-    int c;
-    unsigned int max;
+int img_read_pgm_header(FILE *file, int *wp, int *hp) {
     int err = fscanf(file, "P5 ");
     if(err < 0) {
 	fprintf(stderr, "Invalid PGM file (missing/bad magic)\n");
@@ -77,22 +77,37 @@ int img_read_pgm(FILE *file, int *wp, int *hp, unsigned char *raster, size_t siz
     }
     if((err = img_read_header(file, "PGM", wp, hp)) < 0)
 	goto bad;
+    if(*wp < 0 || *hp < 0) {
+	fprintf(stderr, "Invalid PGM file (negative dimensions)\n");
+	goto bad;
+    }
+    return 0;
+
+ bad:
+    return -1;
+}
+
+int img_read_pgm_raster(FILE *file, int w, int h, unsigned char *raster) {
+    // One call for the whole raster, rather than one per pixel.
+    size_t size = (size_t) w * h;
+    if(fread(raster, 1, size, file) != size) {
+	fprintf(stderr, "PGM file image data truncated\n");
+	return -1;
+    }
+    return 0;
+}
+
+int img_read_pgm(FILE *file, int *wp, int *hp, unsigned char *raster, size_t size) {
+    if(img_read_pgm_header(file, wp, hp) < 0)
+	goto bad;
 
     // Check that there is enough space to hold the data.
-    if(*wp * *hp * sizeof(unsigned char) > size)
+    if((size_t) *wp * *hp * sizeof(unsigned char) > size)
 	goto bad;
 
     // Read the raster.
-    unsigned char *dp = raster;
-    for(int i = 0; i < *hp; i++) {
-	for(int j = 0; j < *wp; j++) {
-	    if((c = fgetc(file)) == EOF) {
-		fprintf(stderr, "PGM file image data truncated\n");
-		goto bad;
-	    }
-	    *dp++ = c;
-	}
-    }
+    if(img_read_pgm_raster(file, *wp, *hp, raster) < 0)
+	goto bad;
     return 0;
 
  bad:
@@ -103,15 +118,21 @@ int img_write_pgm(unsigned char *data, int w, int h, FILE *file) {
     if(file == NULL)
 	return -1;
     fprintf(file, "P5 %d %d 255\n", w, h);
-    for(int i = 0; i < h; i++) {
-	for(int j = 0; j < w; j++) {
-	    fputc(data[i * w + j], file);
-	}
-    }
+    size_t size = (size_t) w * h;
+    if(fwrite(data, 1, size, file) != size)
+	return -1;
     return fflush(file);
 }
 
 BDD_NODE *img_read_birp(FILE *file, int *wp, int *hp) {
+    int order;
+    BDD_NODE *node = img_read_birp_ordered(file, wp, hp, &order);
+    if(node == NULL)
+	return NULL;
+    return bdd_order_standardize(node, *wp, *hp, order);
+}
+
+BDD_NODE *img_read_birp_ordered(FILE *file, int *wp, int *hp, int *orderp) {
     int c;
     unsigned int max;
     int err = fscanf(file, "B5 ");
@@ -121,6 +142,41 @@ BDD_NODE *img_read_birp(FILE *file, int *wp, int *hp) {
     }
     if((err = img_read_header(file, "BIRP", wp, hp)) < 0)
 	goto bad;
+    *orderp = bdd_order_of_kind(BDD_ORDER_INTERLEAVED, bdd_min_level(*wp, *hp));
+
+    // Another variable order is marked by 'o' and the order, in four bytes, least significant first.
+    if((c = fgetc(file)) == 'o') {
+	unsigned int order = 0;
+	for(int i = 0; i < 4; i++) {
+	    if((c = fgetc(file)) == EOF)
+		break;
+	    order |= (unsigned int) c << (8 * i);
+	}
+	if(c == EOF || !bdd_order_valid(order, bdd_min_level(*wp, *hp))) {
+	    fprintf(stderr, "Invalid BIRP file (bad variable order)\n");
+	    goto bad;
+	}
+	*orderp = order;
+	return bdd_deserialize(file);
+    }
+    if(c != EOF)
+	ungetc(c, file);
+
+    // Bit planes are marked by 'p', 'b' or 'g' (Gray codes), and the level of the image.
+    if((c = fgetc(file)) == 'p') {
+	int gray = fgetc(file);
+	int level = fgetc(file);
+	if((gray != 'b' && gray != 'g') || level != bdd_min_level(*wp, *hp)) {
+	    fprintf(stderr, "Invalid BIRP file (bad bit planes)\n");
+	    goto bad;
+	}
+	BDD_NODE *planes = bdd_deserialize(file);
+	if(planes == NULL)
+	    goto bad;
+	return bdd_from_planes(planes, level, gray == 'g');
+    }
+    if(c != EOF)
+	ungetc(c, file);
 
     // Read the serialized BDD.
     BDD_NODE *node = bdd_deserialize(file);
@@ -137,3 +193,23 @@ int img_write_birp(BDD_NODE *node, int w, int h, FILE *file) {
     bdd_serialize(node, file);
     return fflush(file);
 }
+
+int img_write_birp_ordered(BDD_NODE *node, int w, int h, int order, FILE *file) {
+    if(file == NULL)
+	return -1;
+    if(order == bdd_order_of_kind(BDD_ORDER_INTERLEAVED, bdd_min_level(w, h)))
+	return img_write_birp(node, w, h, file);
+    fprintf(file, "B5 %d %d 255\no", w, h);
+    for(int i = 0; i < 4; i++)
+	fputc((order >> (8 * i)) & 0xFF, file);
+    bdd_serialize(node, file);
+    return fflush(file);
+}
+
+int img_write_birp_planes(BDD_NODE *planes, int w, int h, int level, int gray, FILE *file) {
+    if(file == NULL)
+	return -1;
+    fprintf(file, "B5 %d %d 255\np%c%c", w, h, gray ? 'g' : 'b', level);
+    bdd_serialize(planes, file);
+    return fflush(file);
+}
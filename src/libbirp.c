@@ -0,0 +1,182 @@
+/*
+ * The libbirp library interface: thin wrappers that make the caller's
+ * context current for the duration of each call.
+ */
+
+#include <stdlib.h>
+
+#include "libbirp.h"
+#include "image.h"
+#include "bdd.h"
+#include "const.h"
+#include "birp2.h"
+#include "bdd2.h"
+#include "lut.h"
+#include "planes.h"
+
+/*
+ * Store a result in an image, returning 0, or -1 if there is no result.
+ */
+static int birp_image_set(BIRP_IMAGE *image, BDD_NODE *root, int w, int h) {
+    if (root == NULL) {
+        return -1;
+    }
+    (image) -> root = root;
+    (image) -> width = w;
+    (image) -> height = h;
+    return 0;
+}
+
+void birp_context_reset(BIRP_CONTEXT *ctx) {
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    bdd_reset_nodes();
+    birp_context_use(previous);
+}
+
+int birp_pgm_read_header(FILE *in, int *wp, int *hp) {
+    return img_read_pgm_header(in, wp, hp);
+}
+
+int birp_pgm_read_raster(FILE *in, int w, int h, unsigned char *raster) {
+    return img_read_pgm_raster(in, w, h, raster);
+}
+
+int birp_pgm_write(const unsigned char *raster, int w, int h, FILE *out) {
+    return img_write_pgm((unsigned char *) raster, w, h, out);
+}
+
+int birp_image_from_raster(BIRP_CONTEXT *ctx, const unsigned char *raster, int w, int h,
+                           BIRP_IMAGE *image) {
+    if (raster == NULL || w <= 0 || h <= 0) {
+        return -1;
+    }
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    BDD_NODE *root = bdd_from_raster(w, h, (unsigned char *) raster);
+    birp_context_use(previous);
+    return birp_image_set(image, root, w, h);
+}
+
+int birp_image_to_raster(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, unsigned char *raster,
+                         size_t size) {
+    if ((image) -> root == NULL || size < ((size_t) (image) -> width) * (image) -> height) {
+        return -1;
+    }
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    bdd_to_raster((image) -> root, (image) -> width, (image) -> height, raster);
+    birp_context_use(previous);
+    return 0;
+}
+
+int birp_image_read(BIRP_CONTEXT *ctx, FILE *in, BIRP_IMAGE *image) {
+    int w = 0;
+    int h = 0;
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    BDD_NODE *root = img_read_birp(in, &w, &h);
+    birp_context_use(previous);
+    return birp_image_set(image, root, w, h);
+}
+
+int birp_image_write(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, FILE *out) {
+    if ((image) -> root == NULL) {
+        return -1;
+    }
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    int status = img_write_birp((image) -> root, (image) -> width, (image) -> height, out);
+    birp_context_use(previous);
+    return status;
+}
+
+int birp_image_write_encoded(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int encoding, FILE *out) {
+    if ((image) -> root == NULL || encoding < BIRP_ENCODING_NODES || encoding > BIRP_ENCODING_AUTO) {
+        return -1;
+    }
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    int written = img_write_birp_encoded((image) -> root, (image) -> width, (image) -> height, encoding, out, NULL);
+    birp_context_use(previous);
+    return written == -1 ? -1 : 0;
+}
+
+int birp_image_complement(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, BIRP_IMAGE *result) {
+    if ((image) -> root == NULL) {
+        return -1;
+    }
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    BDD_NODE *root = bdd_map((image) -> root, complement);
+    birp_context_use(previous);
+    return birp_image_set(result, root, (image) -> width, (image) -> height);
+}
+
+int birp_image_threshold(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int value,
+                         BIRP_IMAGE *result) {
+    if ((image) -> root == NULL || value < 0 || value > 255) {
+        return -1;
+    }
+    unsigned char *lut = malloc(BDD_LUT_SIZE);
+    if (lut == NULL) {
+        return -1;
+    }
+    lut_identity(lut);
+    lut_threshold(lut, value);
+    int status = birp_image_lut(ctx, image, lut, result);
+    free(lut);
+    return status;
+}
+
+int birp_image_lut(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, const unsigned char *lut,
+                   BIRP_IMAGE *result) {
+    if ((image) -> root == NULL || lut == NULL) {
+        return -1;
+    }
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    BDD_NODE *root = bdd_map_lut((image) -> root, (unsigned char *) lut);
+    birp_context_use(previous);
+    return birp_image_set(result, root, (image) -> width, (image) -> height);
+}
+
+int birp_image_zoom(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int factor, BIRP_IMAGE *result) {
+    if ((image) -> root == NULL) {
+        return -1;
+    }
+    int w = (image) -> width;
+    int h = (image) -> height;
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    BDD_NODE *root = zoom_transformation((image) -> root, factor, &w, &h);
+    birp_context_use(previous);
+    return birp_image_set(result, root, w, h);
+}
+
+int birp_image_rotate(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, BIRP_IMAGE *result) {
+    if ((image) -> root == NULL) {
+        return -1;
+    }
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    BDD_NODE *root = bdd_rotate((image) -> root, ((image) -> root) -> level);
+    birp_context_use(previous);
+    return birp_image_set(result, root, (image) -> width, (image) -> height);
+}
+
+int birp_image_dihedral(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int transform,
+                        BIRP_IMAGE *result) {
+    if ((image) -> root == NULL || transform < 0 || transform > 7) {
+        return -1;
+    }
+    int w = (image) -> width;
+    int h = (image) -> height;
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    BDD_NODE *root = dihedral_transformation((image) -> root, transform, &w, &h);
+    birp_context_use(previous);
+    return birp_image_set(result, root, w, h);
+}
+
+int birp_image_crop(BIRP_CONTEXT *ctx, const BIRP_IMAGE *image, int background,
+                    BIRP_IMAGE *result) {
+    if ((image) -> root == NULL || background < 0 || background > 255) {
+        return -1;
+    }
+    int w = (image) -> width;
+    int h = (image) -> height;
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    BDD_NODE *root = crop_transformation((image) -> root, background, &w, &h);
+    birp_context_use(previous);
+    return birp_image_set(result, root, w, h);
+}
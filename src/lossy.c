@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "bdd.h"
+#include "debug.h"
+#include "bdd2.h"
+#include "lossy.h"
+#include "lossy2.h"
+
+/*
+ * Direct-mapped cache of previously built nodes, keyed by level and by a
+ * coarse signature of the region (its mean and the difference between the
+ * means of its halves), consulted for near-duplicates before a new node is
+ * inserted.  Only levels up to LOSSY_CACHE_LEVEL_MAX are cached, because
+ * checking a candidate costs time proportional to its area.
+ */
+#define LOSSY_CACHE_SIZE (1 << 16)
+#define LOSSY_CACHE_LEVEL_MAX 12
+
+/* Parameters of the call in progress, per thread so that concurrent calls do not interfere */
+static _Thread_local unsigned char *lossy_raster;
+static _Thread_local int lossy_w;
+static _Thread_local int lossy_h;
+static _Thread_local int lossy_tolerance;
+static _Thread_local int lossy_metric;
+static _Thread_local int *lossy_cache;
+
+BDD_NODE *bdd_from_raster_lossy(int w, int h, unsigned char *raster, int tolerance, int metric) {
+    int level = bdd_min_level(w, h);
+    if (level > BDD_LEVELS_MAX || tolerance < 0 || bdd_store_init() == -1) {
+        return NULL;
+    }
+    lossy_cache = calloc(LOSSY_CACHE_SIZE, sizeof(int));
+    if (lossy_cache == NULL) {
+        return NULL;
+    }
+    lossy_raster = raster;
+    lossy_w = w;
+    lossy_h = h;
+    lossy_tolerance = tolerance;
+    lossy_metric = metric;
+    int min;
+    int max;
+    long long sum;
+    int index = bdd_from_raster_lossy_recurse(level, 0, 0, &min, &max, &sum);
+    free(lossy_cache);
+    lossy_cache = NULL;
+    if (index == -1) {
+        return NULL;
+    }
+    return index_to_bdd_node(index);
+}
+
+int bdd_from_raster_lossy_recurse(int level, int row, int col, int *minp, int *maxp, long long *sump) {
+    if (level == 0) {
+        int value = 0;
+        if (row < lossy_h && col < lossy_w) {
+            value = *(lossy_raster + (row * lossy_w) + col);
+        }
+        *minp = value;
+        *maxp = value;
+        *sump = value;
+        return value;
+    }
+    int left_min;
+    int left_max;
+    long long left_sum;
+    int right_min;
+    int right_max;
+    long long right_sum;
+    int left = bdd_from_raster_lossy_recurse(level - 1, row, col, &left_min, &left_max, &left_sum);
+    int right;
+    if (level % 2 == 0) { /* Top and bottom halves */
+        right = bdd_from_raster_lossy_recurse(level - 1, row + LEVEL_ROWS(level - 1), col,
+                                              &right_min, &right_max, &right_sum);
+    } else { /* Left and right halves */
+        right = bdd_from_raster_lossy_recurse(level - 1, row, col + LEVEL_COLS(level - 1),
+                                              &right_min, &right_max, &right_sum);
+    }
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    *minp = left_min < right_min ? left_min : right_min;
+    *maxp = left_max > right_max ? left_max : right_max;
+    *sump = left_sum + right_sum;
+    if (left == right) {
+        return left;
+    }
+
+    long long area = ((long long) LEVEL_ROWS(level)) * LEVEL_COLS(level);
+    int row_max = row + LEVEL_ROWS(level) < lossy_h ? row + LEVEL_ROWS(level) : lossy_h;
+    int col_max = col + LEVEL_COLS(level) < lossy_w ? col + LEVEL_COLS(level) : lossy_w;
+    long long inside = ((long long) (row_max - row)) * (col_max - col); /* Padding earns no error budget */
+    long long limit = lossy_metric == LOSSY_METRIC_MAX ? lossy_tolerance : lossy_tolerance * inside;
+    if (lossy_metric == LOSSY_METRIC_MAX) { /* Midpoint leaf is within tolerance iff the range is */
+        if (*maxp - *minp <= 2 * lossy_tolerance) {
+            return (*minp + *maxp) / 2;
+        }
+    } else {
+        int mean = (*sump + area / 2) / area;
+        if (bdd_lossy_error(index_to_bdd_node(mean), level, row, col, limit) <= limit) {
+            return mean;
+        }
+    }
+    if (bdd_lossy_error(index_to_bdd_node(left), level, row, col, limit) <= limit) { /* Left repeated twice */
+        return left;
+    }
+    if (bdd_lossy_error(index_to_bdd_node(right), level, row, col, limit) <= limit) {
+        return right;
+    }
+
+    int *slot = NULL;
+    if (level <= LOSSY_CACHE_LEVEL_MAX) {
+        long long half = area / 2;
+        long long mean_bucket = (*sump / area) / (lossy_tolerance + 1);
+        long long skew_bucket = ((left_sum - right_sum) / half + 256) / (lossy_tolerance + 1);
+        unsigned int key = (((unsigned int) level * 257 + mean_bucket) * 521 + skew_bucket) * 2654435761u;
+        slot = lossy_cache + (key % LOSSY_CACHE_SIZE);
+        if (*slot != 0 && (index_to_bdd_node(*slot)) -> level <= level /* Slots are shared across levels */
+            && bdd_lossy_error(index_to_bdd_node(*slot), level, row, col, limit) <= limit) {
+            return *slot;
+        }
+    }
+    int index = bdd_lookup(level, left, right);
+    if (index != -1 && slot != NULL) {
+        *slot = index;
+    }
+    return index;
+}
+
+/*
+ * Returns the error of a node, interpreted at the given level and position,
+ * against the original raster: the largest absolute difference for
+ * LOSSY_METRIC_MAX or the sum of absolute differences for LOSSY_METRIC_MEAN.
+ * Stops early, returning some value greater than limit, once limit is exceeded.
+ */
+long long bdd_lossy_error(BDD_NODE *node, int level, int row, int col, long long limit) {
+    int row_end = row + LEVEL_ROWS(level);
+    int col_end = col + LEVEL_COLS(level);
+    int node_index = bdd_node_to_index(node);
+    if (node_index < BDD_NUM_LEAVES) {
+        int row_max = row_end < lossy_h ? row_end : lossy_h;
+        int col_max = col_end < lossy_w ? col_end : lossy_w;
+        long long error = 0;
+        long long inside = 0;
+        for (int r = row; r < row_max; r++) {
+            unsigned char *pixel = lossy_raster + (r * lossy_w) + col;
+            for (int c = col; c < col_max; c++) {
+                int diff = *pixel - node_index;
+                if (diff < 0) {
+                    diff = -diff;
+                }
+                if (lossy_metric == LOSSY_METRIC_MAX) {
+                    if (diff > error) {
+                        error = diff;
+                    }
+                } else {
+                    error += diff;
+                }
+                if (error > limit) {
+                    return error;
+                }
+                pixel++;
+                inside++;
+            }
+        }
+        long long padding = ((long long) LEVEL_ROWS(level)) * LEVEL_COLS(level) - inside;
+        if (padding > 0) { /* Padding pixels are zero */
+            if (lossy_metric == LOSSY_METRIC_MAX) {
+                if (node_index > error) {
+                    error = node_index;
+                }
+            } else {
+                error += padding * node_index;
+            }
+        }
+        return error;
+    }
+    long long left = bdd_lossy_error(LEFT(node, level), level - 1, row, col, limit);
+    if (left > limit) {
+        return left;
+    }
+    long long right;
+    if (level % 2 == 0) {
+        right = bdd_lossy_error(RIGHT(node, level), level - 1, row + LEVEL_ROWS(level - 1), col,
+                                lossy_metric == LOSSY_METRIC_MAX ? limit : limit - left);
+    } else {
+        right = bdd_lossy_error(RIGHT(node, level), level - 1, row, col + LEVEL_COLS(level - 1),
+                                lossy_metric == LOSSY_METRIC_MAX ? limit : limit - left);
+    }
+    if (lossy_metric == LOSSY_METRIC_MAX) {
+        return left > right ? left : right;
+    }
+    return left + right;
+}
+
+double raster_psnr(unsigned char *original, unsigned char *decoded, int w, int h) {
+    double squared_error = 0.0;
+    long long count = ((long long) w) * h;
+    for (long long i = 0; i < count; i++) {
+        double diff = ((double) *original) - ((double) *decoded);
+        squared_error += diff * diff;
+        original++;
+        decoded++;
+    }
+    if (squared_error == 0.0 || count == 0) {
+        return -1.0;
+    }
+    return 10.0 * log10((255.0 * 255.0) / (squared_error / count));
+}
@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "bdd.h"
+#include "debug.h"
+#include "bdd2.h"
+#include "lut.h"
+#include "lut2.h"
+#include "stats.h"
+
+void lut_identity(unsigned char *lut) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        *(lut + v) = v;
+    }
+}
+
+int lut_is_identity(unsigned char *lut) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        if (*(lut + v) != v) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void lut_compose(unsigned char *lut, unsigned char *next) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        *(lut + v) = *(next + *(lut + v));
+    }
+}
+
+void lut_complement(unsigned char *lut) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        *(lut + v) = 255 - *(lut + v);
+    }
+}
+
+void lut_threshold(unsigned char *lut, int threshold) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        *(lut + v) = *(lut + v) >= threshold ? 255 : 0;
+    }
+}
+
+void lut_gamma(unsigned char *lut, double gamma) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        *(lut + v) = (unsigned char) (255.0 * pow(*(lut + v) / 255.0, gamma) + 0.5);
+    }
+}
+
+void lut_levels(unsigned char *lut, int low, int high) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        int value = *(lut + v);
+        if (value <= low) {
+            value = 0;
+        } else if (value >= high) {
+            value = 255;
+        } else {
+            value = ((value - low) * 255 + (high - low) / 2) / (high - low);
+        }
+        *(lut + v) = value;
+    }
+}
+
+void lut_posterize(unsigned char *lut, int levels) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        int band = *(lut + v) * levels / BDD_LUT_SIZE;
+        *(lut + v) = (band * 255 + (levels - 1) / 2) / (levels - 1);
+    }
+}
+
+void lut_invert_range(unsigned char *lut, int low, int high) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        int value = *(lut + v);
+        if (value >= low && value <= high) {
+            *(lut + v) = low + high - value;
+        }
+    }
+}
+
+void lut_clamp(unsigned char *lut, int low, int high) {
+    for (int v = 0; v < BDD_LUT_SIZE; v++) {
+        int value = *(lut + v);
+        *(lut + v) = value < low ? low : value > high ? high : value;
+    }
+}
+
+BDD_NODE *bdd_map_lut(BDD_NODE *node, unsigned char *lut) {
+    if (lut_is_identity(lut)) { /* Nothing would change, so skip the walk */
+        return node;
+    }
+    if (clear_bdd_index_map() == -1) {
+        return NULL;
+    }
+    int index = bdd_map_lut_recurse(node, lut);
+    if (index == -1) {
+        return NULL;
+    }
+    return index_to_bdd_node(index);
+}
+
+int bdd_map_lut_recurse(BDD_NODE *node, unsigned char *lut) {
+    int bdd_node_index = bdd_node_to_index(node);
+    if (bdd_node_index < BDD_NUM_LEAVES) {
+        return *(lut + bdd_node_index);
+    }
+    STATS(birp_stats.memo_lookups++);
+    if (*(bdd_index_map + bdd_node_index) != 0) { /* If node has already been mapped */
+        STATS(birp_stats.memo_hits++);
+        return *(bdd_index_map + bdd_node_index) - 1;
+    }
+    int left = bdd_map_lut_recurse(index_to_bdd_node((node) -> left), lut);
+    int right = bdd_map_lut_recurse(index_to_bdd_node((node) -> right), lut);
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    int new_index = bdd_lookup((node) -> level, left, right);
+    if (new_index == -1) {
+        return -1;
+    }
+    /* Offset by one, so that a subtree that collapses to black is remembered too */
+    *(bdd_index_map + bdd_node_index) = new_index + 1;
+    return new_index;
+}
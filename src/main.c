@@ -1,8 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include "const.h"
 #include "debug.h"
+#include "birp2.h"
+#include "stats.h"
+#include "trace.h"
+#include "batch.h"
 
 #ifdef _STRING_H
 #error "Do not #include <string.h>. You will get a ZERO."
@@ -22,18 +27,63 @@ int main(int argc, char **argv)
         USAGE(*argv, EXIT_FAILURE);
     if(global_options & HELP_OPTION)
         USAGE(*argv, EXIT_SUCCESS);
-    int input_output = global_options & 0x000000FF;
-    int exit_status = -1;
-    if (input_output == 0x31) {
-    	exit_status = pgm_to_ascii(stdin, stdout);
-    } else if (input_output == 0x21) {
-    	exit_status = pgm_to_birp(stdin, stdout);
-    } else if (input_output == 0x12) {
-    	exit_status = birp_to_pgm(stdin, stdout);
-    } else if (input_output == 0x32) {
-    	exit_status = birp_to_ascii(stdin, stdout);
-    } else if (input_output == 0x22) {
-    	exit_status = birp_to_birp(stdin, stdout);
+    FILE *in = stdin;
+    FILE *out = stdout;
+    if (input_path != NULL && (in = fopen(input_path, "r")) == NULL) {
+    	fprintf(stderr, "Cannot open %s\n", input_path);
+    	return EXIT_FAILURE;
+    }
+    struct stat in_stat;
+    struct stat out_stat;
+    if (output_path != NULL && fstat(fileno(in), &in_stat) == 0 && stat(output_path, &out_stat) == 0
+        && in_stat.st_dev == out_stat.st_dev && in_stat.st_ino == out_stat.st_ino) { /* Opening it would truncate the input */
+    	fprintf(stderr, "%s: output would overwrite the input\n", output_path);
+    	return EXIT_FAILURE;
+    }
+    if (output_path != NULL && (out = fopen(output_path, "w+")) == NULL) { /* Readable too, for mapping */
+    	fprintf(stderr, "Cannot open %s\n", output_path);
+    	return EXIT_FAILURE;
+    }
+    FILE *in_file = in;
+    FILE *out_file = out;
+    if ((global_options & STATS_OPTION) && stats_enable() == 0) {
+    	in = stats_counting_stream(in_file, "r");
+    	out = stats_counting_stream(out_file, "w");
+    }
+    if ((global_options & TRACE_OPTION) && trace_enable() == -1) {
+    	fprintf(stderr, "Cannot allocate trace buffer\n");
+    	return EXIT_FAILURE;
+    }
+    int exit_status;
+    if (global_options & BATCH_OPTION) {
+    	exit_status = birp_batch(batch_inputs, batch_input_count, batch_output_dir, batch_jobs,
+    	                         stderr);
+    } else {
+    	exit_status = birp_convert(in, out);
+    }
+    TRACE_BEGIN("output flush");
+    if (out != out_file && fclose(out) == EOF) { /* Pushes counted output through to the file */
+    	exit_status = -1;
+    }
+    if (out_file != stdout && fclose(out_file) == EOF) {
+    	exit_status = -1;
+    }
+    if (fflush(stdout) == EOF) {
+    	exit_status = -1;
+    }
+    TRACE_END("output flush");
+    if (in != in_file) {
+    	fclose(in);
+    }
+    if (in_file != stdin) {
+    	fclose(in_file);
+    }
+    if (stats_enabled) {
+    	stats_report(stderr);
+    }
+    if (trace_enabled && trace_write(trace_path) == -1) {
+    	fprintf(stderr, "Cannot write trace file %s\n", trace_path);
+    	exit_status = -1;
     }
     if (exit_status == 0) {
     	return EXIT_SUCCESS;
@@ -0,0 +1,90 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "image.h"
+#include "mapped.h"
+
+/*
+ * The file descriptor of a stream that is a regular file at its start, with
+ * nothing buffered, and its size; or -1.
+ */
+static int mapped_file(FILE *stream, off_t *sizep) {
+    int fd = fileno(stream);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1 || !S_ISREG((st).st_mode) || ftell(stream) != 0) {
+        return -1;
+    }
+    *sizep = (st).st_size;
+    return fd;
+}
+
+int mapped_pgm_read(FILE *in, MAPPED_PGM *map) {
+    *map = (MAPPED_PGM) { NULL, 0, NULL, 0, 0 };
+    off_t size;
+    int fd = mapped_file(in, &size);
+    if (fd == -1 || size == 0) {
+        return 1;
+    }
+    unsigned char *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (base == MAP_FAILED) {
+        return 1;
+    }
+    FILE *header = fmemopen(base, size, "r");
+    if (header == NULL) {
+        munmap(base, size);
+        return 1;
+    }
+    int w = 0;
+    int h = 0;
+    int status = img_read_pgm_header(header, &w, &h);
+    long offset = ftell(header);
+    fclose(header);
+    if (status == 0 && (size_t) size - offset < (size_t) w * h) {
+        fprintf(stderr, "PGM file image data truncated\n");
+        status = -1;
+    }
+    if (status == -1 || (size_t) w * h == 0) { /* An empty raster is left to the stream path */
+        munmap(base, size);
+        return status == -1 ? -1 : 1;
+    }
+    madvise(base, size, MADV_SEQUENTIAL);
+    *map = (MAPPED_PGM) { base, size, base + offset, w, h };
+    fseek(in, offset + (long) w * h, SEEK_SET);
+    return 0;
+}
+
+int mapped_pgm_create(FILE *out, int w, int h, MAPPED_PGM *map) {
+    *map = (MAPPED_PGM) { NULL, 0, NULL, 0, 0 };
+    off_t size;
+    int fd = mapped_file(out, &size);
+    if (fd == -1 || size != 0 || (fcntl(fd, F_GETFL) & O_ACCMODE) != O_RDWR || (size_t) w * h == 0) {
+        return -1;
+    }
+    int header_length = snprintf(NULL, 0, "P5 %d %d 255\n", w, h);
+    size_t length = header_length + (size_t) w * h;
+    if (ftruncate(fd, length) == -1) {
+        return -1;
+    }
+    unsigned char *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        ftruncate(fd, 0);
+        return -1;
+    }
+    snprintf((char *) base, header_length + 1, "P5 %d %d 255\n", w, h); /* Its final 0 is under the first pixel */
+    *map = (MAPPED_PGM) { base, length, base + header_length, w, h };
+    fseek(out, length, SEEK_SET);
+    return 0;
+}
+
+int mapped_pgm_close(MAPPED_PGM *map) {
+    if ((map) -> base == NULL) {
+        return 0;
+    }
+    int status = munmap((map) -> base, (map) -> length);
+    (map) -> base = NULL;
+    return status;
+}
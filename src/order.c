@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bdd.h"
+#include "debug.h"
+#include "bdd2.h"
+#include "order.h"
+#include "order2.h"
+
+/* Parameters of the call in progress, per thread so that concurrent calls do not interfere */
+static _Thread_local unsigned char *order_raster;
+static _Thread_local int order_w;
+static _Thread_local int order_h;
+static _Thread_local int order_order;
+
+int bdd_order_of_kind(int kind, int level) {
+    unsigned int all = level >= 32 ? ~0u : (1u << level) - 1;
+    unsigned int half = (1u << (level / 2)) - 1;
+    if (kind == BDD_ORDER_COLUMNS_FIRST) {
+        return 0xAAAAAAAAu & all; /* Even levels split columns */
+    } else if (kind == BDD_ORDER_ROW_BLOCKS) {
+        return half; /* The lower half of the levels split columns */
+    } else if (kind == BDD_ORDER_COLUMN_BLOCKS) {
+        return half << (level / 2);
+    }
+    return 0x55555555u & all; /* Odd levels split columns */
+}
+
+int bdd_order_valid(int order, int level) {
+    if (level < 0 || level > BDD_LEVELS_MAX || level % 2 != 0) {
+        return 0;
+    }
+    if (level < 32 && ((unsigned int) order >> level) != 0) {
+        return 0;
+    }
+    return __builtin_popcount(order) == level / 2;
+}
+
+BDD_NODE *bdd_from_raster_ordered(int w, int h, unsigned char *raster, int order) {
+    int level = bdd_min_level(w, h);
+    if (!bdd_order_valid(order, level) || bdd_store_init() == -1) {
+        return NULL;
+    }
+    if (order == bdd_order_of_kind(BDD_ORDER_INTERLEAVED, level)) {
+        return bdd_from_raster(w, h, raster);
+    }
+    order_raster = raster;
+    order_w = w;
+    order_h = h;
+    order_order = order;
+    int index = bdd_from_raster_ordered_recurse(level, 0, 0);
+    if (index == -1) {
+        return NULL;
+    }
+    return index_to_bdd_node(index);
+}
+
+int bdd_from_raster_ordered_recurse(int level, int row, int col) {
+    if (row >= order_h || col >= order_w) { /* Outside of raster, so all 0 */
+        return 0;
+    }
+    if (level == 0) {
+        return *(order_raster + (row * order_w) + col);
+    }
+    int left = bdd_from_raster_ordered_recurse(level - 1, row, col);
+    int right;
+    if (ORDER_SPLITS_COLS(order_order, level)) { /* Left and right halves */
+        right = bdd_from_raster_ordered_recurse(level - 1, row, col + ORDER_COLS(order_order, level - 1));
+    } else { /* Top and bottom halves */
+        right = bdd_from_raster_ordered_recurse(level - 1, row + ORDER_ROWS(order_order, level - 1), col);
+    }
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    return bdd_lookup(level, left, right);
+}
+
+void bdd_to_raster_ordered(BDD_NODE *node, int w, int h, unsigned char *raster, int order) {
+    int level = bdd_min_level(w, h);
+    if (order == bdd_order_of_kind(BDD_ORDER_INTERLEAVED, level)) {
+        bdd_to_raster(node, w, h, raster);
+        return;
+    }
+    order_raster = raster;
+    order_w = w;
+    order_h = h;
+    order_order = order;
+    bdd_to_raster_ordered_recurse(node, level, 0, 0);
+}
+
+void bdd_to_raster_ordered_recurse(BDD_NODE *node, int level, int row, int col) {
+    if (row >= order_h || col >= order_w) { /* Outside of raster */
+        return;
+    }
+    int node_index = bdd_node_to_index(node);
+    if (node_index < BDD_NUM_LEAVES) { /* Fill the uniform region, clipped to the raster */
+        int row_max = row + ORDER_ROWS(order_order, level) < order_h ? row + ORDER_ROWS(order_order, level) : order_h;
+        int col_max = col + ORDER_COLS(order_order, level) < order_w ? col + ORDER_COLS(order_order, level) : order_w;
+        for (int r = row; r < row_max; r++) {
+            unsigned char *pixel = order_raster + (r * order_w) + col;
+            for (int c = col; c < col_max; c++) {
+                *pixel = node_index;
+                pixel++;
+            }
+        }
+        return;
+    }
+    bdd_to_raster_ordered_recurse(LEFT(node, level), level - 1, row, col);
+    if (ORDER_SPLITS_COLS(order_order, level)) { /* Left and right halves */
+        bdd_to_raster_ordered_recurse(RIGHT(node, level), level - 1, row, col + ORDER_COLS(order_order, level - 1));
+    } else { /* Top and bottom halves */
+        bdd_to_raster_ordered_recurse(RIGHT(node, level), level - 1, row + ORDER_ROWS(order_order, level - 1), col);
+    }
+}
+
+BDD_NODE *bdd_order_standardize(BDD_NODE *node, int w, int h, int order) {
+    if (order == bdd_order_of_kind(BDD_ORDER_INTERLEAVED, bdd_min_level(w, h))) {
+        return node;
+    }
+    unsigned char *raster = malloc(((size_t) w) * h + 1);
+    if (raster == NULL) {
+        return NULL;
+    }
+    bdd_to_raster_ordered(node, w, h, raster, order);
+    BDD_NODE *standard = bdd_from_raster(w, h, raster);
+    free(raster);
+    return standard;
+}
+
+/*
+ * The number of nodes a raster takes in an order, built in the current
+ * context after emptying it; -1 if they do not fit.
+ */
+int order_count_nodes(int w, int h, unsigned char *raster, int order) {
+    bdd_reset_nodes();
+    if (bdd_from_raster_ordered(w, h, raster, order) == NULL) {
+        return -1;
+    }
+    return current_bdd_node_index - BDD_NUM_LEAVES; /* Every node built is reachable */
+}
+
+int bdd_order_search(int w, int h, unsigned char *raster, int *nodesp) {
+    int level = bdd_min_level(w, h);
+    BIRP_CONTEXT *scratch = birp_context_create();
+    if (scratch == NULL || level > BDD_LEVELS_MAX) {
+        birp_context_destroy(scratch);
+        return -1;
+    }
+    BIRP_CONTEXT *previous = birp_context_use(scratch);
+    int best = -1;
+    int best_nodes = -1;
+    for (int kind = BDD_ORDER_INTERLEAVED; kind <= BDD_ORDER_COLUMN_BLOCKS; kind++) {
+        int order = bdd_order_of_kind(kind, level);
+        int nodes = order_count_nodes(w, h, raster, order);
+        if (nodes != -1 && (best_nodes == -1 || nodes < best_nodes)) {
+            best = order;
+            best_nodes = nodes;
+        }
+    }
+    int improved = best != -1;
+    for (int pass = 0; pass < ORDER_SEARCH_PASSES && improved; pass++) {
+        improved = 0;
+        for (int l = 1; l < level; l++) {
+            if (ORDER_SPLITS_COLS(best, l) == ORDER_SPLITS_COLS(best, l + 1)) { /* Only a row and a column level can be exchanged */
+                continue;
+            }
+            int order = best ^ (3 << (l - 1)); /* Exchange levels l and l + 1 */
+            int nodes = order_count_nodes(w, h, raster, order);
+            if (nodes != -1 && nodes < best_nodes) {
+                best = order;
+                best_nodes = nodes;
+                improved = 1;
+            }
+        }
+    }
+    birp_context_use(previous);
+    birp_context_destroy(scratch);
+    if (nodesp != NULL) {
+        *nodesp = best_nodes;
+    }
+    return best;
+}
@@ -0,0 +1,439 @@
+#define _GNU_SOURCE  /* For fopencookie */
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#include "bdd.h"
+#include "bdd2.h"
+#include "const.h"
+#include "birp2.h"
+#include "dihedral.h"
+#include "image.h"
+#include "my_math.h"
+#include "stats.h"
+#include "trace.h"
+#include "pipeline.h"
+
+/*
+ * The BDD is built from the rows read so far in blocks of PIPE_BUILD_LEVEL
+ * levels (64 x 64 pixels), in the order in which bdd_from_raster_recurse
+ * visits them, which takes the rows from the top down.
+ */
+#define PIPE_BUILD_LEVEL 12
+
+static void *pipe_raster_reader(void *arg) {
+    PIPE_RASTER *raster = arg;
+    size_t done = 0;
+    int error = 0;
+    while (done < (raster) -> size && !error) {
+        size_t chunk = (raster) -> size - done < PIPE_CHUNK ? (raster) -> size - done : PIPE_CHUNK;
+        size_t count = fread((raster) -> data + done, 1, chunk, (raster) -> file);
+        done += count;
+        error = count < chunk;
+        pthread_mutex_lock(&(raster) -> lock);
+        (raster) -> ready = done;
+        (raster) -> error = error;
+        (raster) -> finished = error || done == (raster) -> size;
+        pthread_cond_broadcast(&(raster) -> changed);
+        pthread_mutex_unlock(&(raster) -> lock);
+    }
+    if (error) {
+        fprintf(stderr, "PGM file image data truncated\n");
+    }
+    return NULL;
+}
+
+static void *pipe_raster_writer(void *arg) {
+    PIPE_RASTER *raster = arg;
+    while (1) {
+        pthread_mutex_lock(&(raster) -> lock);
+        while ((raster) -> ready == (raster) -> written && !(raster) -> finished) {
+            pthread_cond_wait(&(raster) -> changed, &(raster) -> lock);
+        }
+        size_t start = (raster) -> written;
+        size_t end = (raster) -> ready;
+        pthread_mutex_unlock(&(raster) -> lock);
+        if (start == end) { /* Finished, with everything made ready written */
+            return NULL;
+        }
+        size_t count = fwrite((raster) -> data + start, 1, end - start, (raster) -> file);
+        pthread_mutex_lock(&(raster) -> lock);
+        (raster) -> written += count;
+        (raster) -> error = count < end - start;
+        pthread_mutex_unlock(&(raster) -> lock);
+        if (count < end - start) {
+            return NULL;
+        }
+    }
+}
+
+static int pipe_raster_start(PIPE_RASTER *raster, FILE *file, unsigned char *data, size_t size, int writing) {
+    *raster = (PIPE_RASTER) { file, data, size, 0, 0, writing, size == 0 && !writing, 0 };
+    pthread_mutex_init(&(raster) -> lock, NULL);
+    pthread_cond_init(&(raster) -> changed, NULL);
+    if (pthread_create(&(raster) -> thread, NULL, writing ? pipe_raster_writer : pipe_raster_reader, raster) != 0) {
+        pthread_mutex_destroy(&(raster) -> lock);
+        pthread_cond_destroy(&(raster) -> changed);
+        return -1;
+    }
+    return 0;
+}
+
+int pipe_raster_read(PIPE_RASTER *raster, FILE *file, unsigned char *data, size_t size) {
+    return pipe_raster_start(raster, file, data, size, 0);
+}
+
+int pipe_raster_write(PIPE_RASTER *raster, FILE *file, unsigned char *data, size_t size) {
+    return pipe_raster_start(raster, file, data, size, 1);
+}
+
+int pipe_raster_wait(PIPE_RASTER *raster, size_t bytes) {
+    pthread_mutex_lock(&(raster) -> lock);
+    while ((raster) -> ready < bytes && !(raster) -> finished) {
+        pthread_cond_wait(&(raster) -> changed, &(raster) -> lock);
+    }
+    int status = (raster) -> ready >= bytes ? 0 : -1;
+    pthread_mutex_unlock(&(raster) -> lock);
+    return status;
+}
+
+void pipe_raster_ready(PIPE_RASTER *raster, size_t bytes) {
+    pthread_mutex_lock(&(raster) -> lock);
+    (raster) -> ready = bytes;
+    pthread_cond_signal(&(raster) -> changed);
+    pthread_mutex_unlock(&(raster) -> lock);
+}
+
+int pipe_raster_finish(PIPE_RASTER *raster) {
+    pthread_mutex_lock(&(raster) -> lock);
+    (raster) -> finished = 1; /* For a reader, it finishes by itself */
+    pthread_cond_signal(&(raster) -> changed);
+    pthread_mutex_unlock(&(raster) -> lock);
+    pthread_join((raster) -> thread, NULL);
+    pthread_mutex_destroy(&(raster) -> lock);
+    pthread_cond_destroy(&(raster) -> changed);
+    size_t moved = (raster) -> writing ? (raster) -> written : (raster) -> ready;
+    return (raster) -> error || moved != (raster) -> size ? -1 : 0;
+}
+
+static void *pipe_stream_reader(void *arg) {
+    PIPE_STREAM *stream = arg;
+    while (1) {
+        pthread_mutex_lock(&(stream) -> lock);
+        while ((stream) -> tail - (stream) -> head == PIPE_STREAM_CAPACITY && !(stream) -> closing) {
+            pthread_cond_wait(&(stream) -> changed, &(stream) -> lock);
+        }
+        int closing = (stream) -> closing;
+        size_t offset = (stream) -> tail % PIPE_STREAM_CAPACITY;
+        size_t chunk = PIPE_STREAM_CAPACITY - ((stream) -> tail - (stream) -> head);
+        pthread_mutex_unlock(&(stream) -> lock);
+        if (closing) {
+            return NULL;
+        }
+        if (chunk > PIPE_STREAM_CAPACITY - offset) { /* Up to the end of the ring */
+            chunk = PIPE_STREAM_CAPACITY - offset;
+        }
+        if (chunk > PIPE_CHUNK) {
+            chunk = PIPE_CHUNK;
+        }
+        size_t count = fread((stream) -> ring + offset, 1, chunk, (stream) -> file);
+        pthread_mutex_lock(&(stream) -> lock);
+        (stream) -> tail += count;
+        (stream) -> eof = count < chunk;
+        (stream) -> error = count < chunk && ferror((stream) -> file);
+        pthread_cond_broadcast(&(stream) -> changed);
+        pthread_mutex_unlock(&(stream) -> lock);
+        if (count < chunk) {
+            return NULL;
+        }
+    }
+}
+
+static void *pipe_stream_writer(void *arg) {
+    PIPE_STREAM *stream = arg;
+    while (1) {
+        pthread_mutex_lock(&(stream) -> lock);
+        while ((stream) -> tail == (stream) -> head && !(stream) -> closing) {
+            pthread_cond_wait(&(stream) -> changed, &(stream) -> lock);
+        }
+        size_t offset = (stream) -> head % PIPE_STREAM_CAPACITY;
+        size_t chunk = (stream) -> tail - (stream) -> head;
+        pthread_mutex_unlock(&(stream) -> lock);
+        if (chunk == 0) { /* Closing, with everything written */
+            break;
+        }
+        if (chunk > PIPE_STREAM_CAPACITY - offset) {
+            chunk = PIPE_STREAM_CAPACITY - offset;
+        }
+        size_t count = fwrite((stream) -> ring + offset, 1, chunk, (stream) -> file);
+        pthread_mutex_lock(&(stream) -> lock);
+        (stream) -> head += count;
+        (stream) -> error = count < chunk;
+        pthread_cond_broadcast(&(stream) -> changed);
+        pthread_mutex_unlock(&(stream) -> lock);
+        if (count < chunk) {
+            return NULL;
+        }
+    }
+    if (fflush((stream) -> file) == EOF) {
+        (stream) -> error = 1; /* Read only after the join */
+    }
+    return NULL;
+}
+
+static ssize_t pipe_stream_cookie_read(void *cookie, char *buf, size_t size) {
+    PIPE_STREAM *stream = cookie;
+    pthread_mutex_lock(&(stream) -> lock);
+    while ((stream) -> tail == (stream) -> head && !(stream) -> eof) {
+        pthread_cond_wait(&(stream) -> changed, &(stream) -> lock);
+    }
+    size_t offset = (stream) -> head % PIPE_STREAM_CAPACITY;
+    size_t count = (stream) -> tail - (stream) -> head;
+    if (count > PIPE_STREAM_CAPACITY - offset) {
+        count = PIPE_STREAM_CAPACITY - offset;
+    }
+    if (count > size) {
+        count = size;
+    }
+    char *from = (char *) (stream) -> ring + offset;
+    for (size_t i = 0; i < count; i++) {
+        *(buf + i) = *(from + i);
+    }
+    (stream) -> head += count;
+    int error = count == 0 && (stream) -> error;
+    pthread_cond_broadcast(&(stream) -> changed);
+    pthread_mutex_unlock(&(stream) -> lock);
+    return error ? -1 : (ssize_t) count;
+}
+
+static ssize_t pipe_stream_cookie_write(void *cookie, const char *buf, size_t size) {
+    PIPE_STREAM *stream = cookie;
+    pthread_mutex_lock(&(stream) -> lock);
+    size_t done = 0;
+    while (done < size && !(stream) -> error) {
+        while ((stream) -> tail - (stream) -> head == PIPE_STREAM_CAPACITY && !(stream) -> error) {
+            pthread_cond_wait(&(stream) -> changed, &(stream) -> lock);
+        }
+        size_t offset = (stream) -> tail % PIPE_STREAM_CAPACITY;
+        size_t count = PIPE_STREAM_CAPACITY - ((stream) -> tail - (stream) -> head);
+        if (count > PIPE_STREAM_CAPACITY - offset) {
+            count = PIPE_STREAM_CAPACITY - offset;
+        }
+        if (count > size - done) {
+            count = size - done;
+        }
+        char *to = (char *) (stream) -> ring + offset;
+        for (size_t i = 0; i < count && !(stream) -> error; i++) {
+            *(to + i) = *(buf + done + i);
+        }
+        (stream) -> tail += (stream) -> error ? 0 : count;
+        done += (stream) -> error ? 0 : count;
+        pthread_cond_broadcast(&(stream) -> changed);
+    }
+    pthread_mutex_unlock(&(stream) -> lock);
+    return done < size ? -1 : (ssize_t) size;
+}
+
+/*
+ * Stop the thread of a stream, once it has written everything if it is a
+ * writer, and release the stream.
+ */
+static int pipe_stream_cookie_close(void *cookie) {
+    PIPE_STREAM *stream = cookie;
+    pthread_mutex_lock(&(stream) -> lock);
+    (stream) -> closing = 1;
+    pthread_cond_broadcast(&(stream) -> changed);
+    pthread_mutex_unlock(&(stream) -> lock);
+    pthread_join((stream) -> thread, NULL);
+    pthread_mutex_destroy(&(stream) -> lock);
+    pthread_cond_destroy(&(stream) -> changed);
+    free((stream) -> ring);
+    return (stream) -> error && (stream) -> writing ? -1 : 0;
+}
+
+static FILE *pipe_stream_open(PIPE_STREAM *stream, FILE *file, int writing) {
+    *stream = (PIPE_STREAM) { file, malloc(PIPE_STREAM_CAPACITY), 0, 0, writing };
+    if ((stream) -> ring == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&(stream) -> lock, NULL);
+    pthread_cond_init(&(stream) -> changed, NULL);
+    if (pthread_create(&(stream) -> thread, NULL, writing ? pipe_stream_writer : pipe_stream_reader, stream) != 0) {
+        pthread_mutex_destroy(&(stream) -> lock);
+        pthread_cond_destroy(&(stream) -> changed);
+        free((stream) -> ring);
+        return NULL;
+    }
+    cookie_io_functions_t functions = {0};
+    if (writing) {
+        functions.write = pipe_stream_cookie_write;
+    } else {
+        functions.read = pipe_stream_cookie_read;
+    }
+    functions.close = pipe_stream_cookie_close;
+    FILE *piped = fopencookie(stream, writing ? "w" : "r", functions);
+    if (piped == NULL) {
+        pipe_stream_cookie_close(stream);
+    }
+    return piped;
+}
+
+FILE *pipe_stream_read(PIPE_STREAM *stream, FILE *file) {
+    return pipe_stream_open(stream, file, 0);
+}
+
+FILE *pipe_stream_write(PIPE_STREAM *stream, FILE *file) {
+    return pipe_stream_open(stream, file, 1);
+}
+
+/*
+ * bdd_from_raster_recurse, waiting for the rows of each block to be read
+ * before building it.
+ */
+static int pipe_build_recurse(PIPE_RASTER *raster, int w, int h, int level, int row_min, int row_max, int col_min, int col_max) {
+    if (level <= PIPE_BUILD_LEVEL || row_min >= h) {
+        size_t rows = row_min >= h ? 0 : row_max < h ? row_max : h;
+        if (pipe_raster_wait(raster, rows * w) == -1) {
+            return -1;
+        }
+        return bdd_from_raster_recurse(w, h, (raster) -> data, level, row_min, row_max, col_min, col_max);
+    }
+    int left;
+    int right;
+    if (level % 2 == 0) { /* Top and bottom strips */
+        int row_mid = (row_min + row_max) / 2;
+        left = pipe_build_recurse(raster, w, h, level - 1, row_min, row_mid, col_min, col_max);
+        right = left == -1 ? -1 : pipe_build_recurse(raster, w, h, level - 1, row_mid, row_max, col_min, col_max);
+    } else { /* Left and right sub-squares */
+        int col_mid = (col_min + col_max) / 2;
+        left = pipe_build_recurse(raster, w, h, level - 1, row_min, row_max, col_min, col_mid);
+        right = left == -1 ? -1 : pipe_build_recurse(raster, w, h, level - 1, row_min, row_max, col_mid, col_max);
+    }
+    if (right == -1) {
+        return -1;
+    }
+    return bdd_lookup(level, left, right);
+}
+
+/*
+ * bdd_to_raster_recurse, restricted to the rows in [band_min, band_max).
+ */
+static void pipe_decode_band(BDD_NODE *node, int level, int row, int col, int w, int h, unsigned char *raster, int band_min, int band_max) {
+    if (row >= band_max || row + LEVEL_ROWS(level) <= band_min || col >= w) {
+        return;
+    }
+    int node_index = bdd_node_to_index(node);
+    if (node_index < BDD_NUM_LEAVES) {
+        int row_min = row > band_min ? row : band_min;
+        int row_max = row + LEVEL_ROWS(level) < band_max ? row + LEVEL_ROWS(level) : band_max;
+        int col_max = col + LEVEL_COLS(level) < w ? col + LEVEL_COLS(level) : w;
+        for (int r = row_min; r < row_max; r++) {
+            unsigned char *pixel = raster + ((size_t) r * w) + col;
+            for (int c = col; c < col_max; c++) {
+                *pixel = node_index;
+                pixel++;
+            }
+        }
+        return;
+    }
+    pipe_decode_band(LEFT(node, level), level - 1, row, col, w, h, raster, band_min, band_max);
+    if (level % 2 == 0) { /* Top and bottom halves */
+        pipe_decode_band(RIGHT(node, level), level - 1, row + LEVEL_ROWS(level - 1), col, w, h, raster, band_min, band_max);
+    } else { /* Left and right halves */
+        pipe_decode_band(RIGHT(node, level), level - 1, row, col + LEVEL_COLS(level - 1), w, h, raster, band_min, band_max);
+    }
+}
+
+int pgm_to_birp_pipelined(FILE *in, FILE *out) {
+    int w = 0;
+    int h = 0;
+    STATS(stats_phase(STATS_PHASE_READ));
+    if (img_read_pgm_header(in, &w, &h) == -1) {
+        return -1;
+    }
+    size_t size = (size_t) w * h;
+    int level = bdd_min_level(w, h);
+    unsigned char *data = raster_reserve(size);
+    PIPE_RASTER raster;
+    if (data == NULL || level > BDD_LEVELS_MAX || bdd_store_init() == -1 || pipe_raster_read(&raster, in, data, size) == -1) {
+        return -1;
+    }
+    STATS(stats_phase(STATS_PHASE_BUILD));
+    TRACE_BEGIN("bdd_from_raster");
+    BDD_NODE *root = NULL;
+    if (global_options & LOSSY_OPTION) { /* Needs the whole raster */
+        root = pipe_raster_wait(&raster, size) == 0 ? apply_lossy_encoding(data, w, h) : NULL;
+    } else {
+        int index = pipe_build_recurse(&raster, w, h, level, 0, power(2, level / 2), 0, power(2, level / 2));
+        root = index == -1 ? NULL : index_to_bdd_node(index);
+    }
+    TRACE_END("bdd_from_raster");
+    if (pipe_raster_finish(&raster) == -1 || root == NULL) {
+        return -1;
+    }
+    STATS(stats_phase(STATS_PHASE_WRITE));
+    TRACE_BEGIN("img_write_birp");
+    PIPE_STREAM stream;
+    FILE *behind = pipe_stream_write(&stream, out);
+    if (behind == NULL) {
+        return -1;
+    }
+    int status = write_birp_output(root, w, h, behind);
+    if (fclose(behind) == EOF) {
+        status = -1;
+    }
+    TRACE_END("img_write_birp");
+    return status;
+}
+
+int birp_to_pgm_pipelined(FILE *in, FILE *out) {
+    int w = 0;
+    int h = 0;
+    STATS(stats_phase(STATS_PHASE_READ));
+    TRACE_BEGIN("img_read_birp");
+    PIPE_STREAM stream;
+    FILE *ahead = pipe_stream_read(&stream, in);
+    if (ahead == NULL) {
+        return -1;
+    }
+    BDD_NODE *root = img_read_birp(ahead, &w, &h);
+    fclose(ahead);
+    TRACE_END("img_read_birp");
+    if (root == NULL || (root) -> level > BDD_RASTER_LEVEL_MAX) {
+        return -1;
+    }
+    apply_dihedral_view(root, &w, &h);
+    size_t size = (size_t) w * h;
+    unsigned char *data = raster_reserve(size);
+    if (data == NULL) {
+        return -1;
+    }
+    STATS(stats_phase(STATS_PHASE_DECODE));
+    TRACE_BEGIN("bdd_to_raster");
+    fprintf(out, "P5 %d %d 255\n", w, h);
+    PIPE_RASTER raster;
+    if (pipe_raster_write(&raster, out, data, size) == -1) {
+        return -1;
+    }
+    int level = bdd_min_level(w, h);
+    if (bdd_node_to_index(root) >= BDD_NUM_LEAVES && (root) -> level > level) {
+        level = (root) -> level;
+    }
+    int band = w == 0 || PIPE_BAND_BYTES / w == 0 ? 1 : PIPE_BAND_BYTES / w;
+    for (int row = 0; row < h; row += band) {
+        int band_max = row + band < h ? row + band : h;
+        if (bdd_view_active(root)) {
+            bdd_view_to_raster(w, h, data, row, band_max);
+        } else {
+            pipe_decode_band(root, level, 0, 0, w, h, data, row, band_max);
+        }
+        pipe_raster_ready(&raster, (size_t) band_max * w);
+    }
+    TRACE_END("bdd_to_raster");
+    bdd_view_clear();
+    int status = pipe_raster_finish(&raster);
+    if (fflush(out) == EOF) {
+        status = -1;
+    }
+    return status;
+}
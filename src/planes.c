@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bdd.h"
+#include "debug.h"
+#include "bdd2.h"
+#include "image.h"
+#include "lut.h"
+#include "planes.h"
+#include "planes2.h"
+#include "stats.h"
+
+/* Cache of the call to bdd_from_planes in progress, per thread so that concurrent calls do not interfere */
+static _Thread_local PLANES_CACHE_ENTRY *planes_cache;
+static _Thread_local int *planes_cache_planes;  // The tuples of the entries.
+/* The tuples of plane nodes of that call, two per level of recursion for the halves */
+static _Thread_local BDD_NODE **planes_vectors;
+
+BDD_NODE *bdd_to_planes(BDD_NODE *node, int level, int gray) {
+    if (level + 3 > BDD_LEVELS_MAX) {
+        return NULL;
+    }
+    int *roots = malloc(BDD_PLANES * sizeof(int));
+    unsigned char *lut = malloc(BDD_LUT_SIZE);
+    if (roots == NULL || lut == NULL) {
+        free(roots);
+        free(lut);
+        return NULL;
+    }
+    for (int bit = 0; bit < BDD_PLANES; bit++) {
+        for (int v = 0; v < BDD_LUT_SIZE; v++) {
+            int code = gray ? v ^ (v >> 1) : v;
+            *(lut + v) = (code >> bit) & 1;
+        }
+        BDD_NODE *plane = bdd_map_lut(node, lut);
+        if (plane == NULL) {
+            free(roots);
+            free(lut);
+            return NULL;
+        }
+        *(roots + bit) = bdd_node_to_index(plane);
+    }
+    free(lut);
+    /* Pair the planes by the lowest bit of their numbers, then the next, then the highest */
+    for (int count = BDD_PLANES / 2, select = level + 1; count >= 1; count /= 2, select++) {
+        for (int i = 0; i < count; i++) {
+            int index = bdd_lookup(select, *(roots + 2 * i), *(roots + 2 * i + 1));
+            if (index == -1) {
+                free(roots);
+                return NULL;
+            }
+            *(roots + i) = index;
+        }
+    }
+    int root = *roots;
+    free(roots);
+    return index_to_bdd_node(root);
+}
+
+BDD_NODE *bdd_plane(BDD_NODE *planes, int level, int bit) {
+    BDD_NODE *node = planes;
+    for (int select = level + 3; select > level; select--) {
+        node = ((bit >> (select - level - 1)) & 1) ? RIGHT(node, select) : LEFT(node, select);
+    }
+    return node;
+}
+
+BDD_NODE *bdd_from_planes(BDD_NODE *planes, int level, int gray) {
+    if (level + 3 > BDD_LEVELS_MAX) {
+        return NULL;
+    }
+    planes_cache = malloc(PLANES_CACHE_SIZE * sizeof(PLANES_CACHE_ENTRY));
+    planes_cache_planes = malloc(PLANES_CACHE_SIZE * BDD_PLANES * sizeof(int));
+    planes_vectors = malloc(2 * (level + 1) * BDD_PLANES * sizeof(BDD_NODE *));
+    int index = -1;
+    if (planes_cache != NULL && planes_cache_planes != NULL && planes_vectors != NULL) {
+        PLANES_CACHE_ENTRY *entry = planes_cache;
+        for (int i = 0; i < PLANES_CACHE_SIZE; i++) {
+            (entry) -> level = -1;
+            (entry) -> planes = planes_cache_planes + i * BDD_PLANES;
+            entry++;
+        }
+        BDD_NODE **roots = planes_vectors; /* The halves start at level 1 */
+        for (int bit = 0; bit < BDD_PLANES; bit++) {
+            *(roots + bit) = bdd_plane(planes, level, bit);
+        }
+        index = bdd_from_planes_recurse(roots, level, gray);
+    }
+    free(planes_cache);
+    free(planes_cache_planes);
+    free(planes_vectors);
+    planes_cache = NULL;
+    planes_cache_planes = NULL;
+    planes_vectors = NULL;
+    if (index == -1) {
+        return NULL;
+    }
+    return index_to_bdd_node(index);
+}
+
+int bdd_from_planes_recurse(BDD_NODE **planes, int level, int gray) {
+    int value = 0;
+    int bit = 0;
+    while (bit < BDD_PLANES && bdd_node_to_index(*(planes + bit)) < BDD_NUM_LEAVES) {
+        value |= (bdd_node_to_index(*(planes + bit)) & 1) << bit;
+        bit++;
+    }
+    if (bit == BDD_PLANES) { /* Every plane is uniform here, so the image is too */
+        return gray ? gray_decode(value) : value;
+    }
+    if (level == 0) { /* Only a malformed file has nodes left below the image */
+        return -1;
+    }
+    STATS(birp_stats.memo_lookups++);
+    PLANES_CACHE_ENTRY *entry = planes_cache_find(planes, level);
+    if ((entry) -> level == level) {
+        STATS(birp_stats.memo_hits++);
+        return (entry) -> index;
+    }
+    BDD_NODE **lefts = planes_vectors + 2 * level * BDD_PLANES; /* Levels decrease, so no deeper call shares them */
+    BDD_NODE **rights = lefts + BDD_PLANES;
+    for (bit = 0; bit < BDD_PLANES; bit++) {
+        *(lefts + bit) = LEFT(*(planes + bit), level);
+        *(rights + bit) = RIGHT(*(planes + bit), level);
+    }
+    int left = bdd_from_planes_recurse(lefts, level - 1, gray);
+    int right = bdd_from_planes_recurse(rights, level - 1, gray);
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    int index = bdd_lookup(level, left, right);
+    if (index == -1) {
+        return -1;
+    }
+    (entry) -> level = level;
+    (entry) -> index = index;
+    for (bit = 0; bit < BDD_PLANES; bit++) {
+        *((entry) -> planes + bit) = bdd_node_to_index(*(planes + bit));
+    }
+    return index;
+}
+
+/*
+ * The entry of the cache for a tuple of planes at a level: the one holding
+ * them if they have been combined, or else the one to overwrite.
+ */
+PLANES_CACHE_ENTRY *planes_cache_find(BDD_NODE **planes, int level) {
+    unsigned int hash = level;
+    for (int bit = 0; bit < BDD_PLANES; bit++) {
+        hash = hash * 0x9E3779B1u + bdd_node_to_index(*(planes + bit));
+    }
+    PLANES_CACHE_ENTRY *entry = planes_cache + ((hash ^ (hash >> 16)) & (PLANES_CACHE_SIZE - 1));
+    if ((entry) -> level != level) {
+        return entry;
+    }
+    for (int bit = 0; bit < BDD_PLANES; bit++) {
+        if (*((entry) -> planes + bit) != bdd_node_to_index(*(planes + bit))) {
+            (entry) -> level = -1; /* Another tuple, to be replaced */
+            return entry;
+        }
+    }
+    return entry;
+}
+
+unsigned char gray_decode(unsigned char code) {
+    int value = code;
+    value ^= value >> 1;
+    value ^= value >> 2;
+    value ^= value >> 4;
+    return value;
+}
+
+long bdd_serialized_size(BDD_NODE *node) {
+    int leaves = 0;
+    int nodes = bdd_count_nodes(node, &leaves);
+    if (nodes == -1) {
+        return -1;
+    }
+    return 2L * leaves + 9L * (nodes - leaves); /* '@' and the value, or the level and two serial numbers */
+}
+
+BDD_NODE *planes_image(BDD_NODE *node, int level) {
+    for (int l = bdd_node_to_index(node) < BDD_NUM_LEAVES ? 0 : (node) -> level; l > level; l--) {
+        node = LEFT(node, l); /* The image lies in the top left corner */
+    }
+    return node;
+}
+
+int img_write_birp_encoded(BDD_NODE *node, int w, int h, int encoding, FILE *out, long *sizes) {
+    if (encoding == BDD_ENCODING_NODES) {
+        return img_write_birp(node, w, h, out) == 0 ? BDD_ENCODING_NODES : -1;
+    }
+    int level = bdd_min_level(w, h);
+    BDD_NODE *image = planes_image(node, level);
+    if (encoding != BDD_ENCODING_AUTO) {
+        int gray = encoding == BDD_ENCODING_GRAY;
+        BDD_NODE *planes = bdd_to_planes(image, level, gray);
+        if (planes == NULL || img_write_birp_planes(planes, w, h, level, gray, out) != 0) {
+            return -1;
+        }
+        return encoding;
+    }
+    /* Each candidate is measured rather than written, and only the smallest is written */
+    BDD_NODE *best = node;
+    int best_encoding = BDD_ENCODING_NODES;
+    long best_size = bdd_serialized_size(node);
+    if (sizes != NULL) {
+        *(sizes + BDD_ENCODING_NODES) = best_size;
+    }
+    for (int gray = 0; gray <= 1; gray++) {
+        BDD_NODE *planes = bdd_to_planes(image, level, gray);
+        long size = planes == NULL ? -1 : bdd_serialized_size(planes) + 3; /* And the marker */
+        if (sizes != NULL) {
+            *(sizes + (gray ? BDD_ENCODING_GRAY : BDD_ENCODING_PLANES)) = size;
+        }
+        if (size != -1 && (best_size == -1 || size < best_size)) {
+            best = planes;
+            best_encoding = gray ? BDD_ENCODING_GRAY : BDD_ENCODING_PLANES;
+            best_size = size;
+        }
+    }
+    int status = best_encoding == BDD_ENCODING_NODES ? img_write_birp(best, w, h, out)
+        : img_write_birp_planes(best, w, h, level, best_encoding == BDD_ENCODING_GRAY, out);
+    return status == 0 ? best_encoding : -1;
+}
@@ -0,0 +1,274 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+#define POOL_DEQUE_INITIAL 64
+
+#define POOL_THREADS_MAX 256
+
+/* The pool, if any, of which the calling thread is a worker, and its index. */
+static _Thread_local POOL *pool_self = NULL;
+static _Thread_local int pool_self_index = -1;
+
+static int shared_threads = 0;  /* 0 until set, meaning the number of online CPUs */
+static POOL *shared_pool = NULL;
+static pthread_mutex_t shared_lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct pool_worker_arg {
+    POOL *pool;
+    int index;
+} POOL_WORKER_ARG;
+
+static int deque_push(POOL_DEQUE *deque, POOL_TASK task) {
+    pthread_mutex_lock(&(deque) -> lock);
+    if ((deque) -> bottom - (deque) -> top == (deque) -> capacity) { /* Full, so double it */
+        int capacity = (deque) -> capacity * 2;
+        POOL_TASK *tasks = malloc(capacity * sizeof(POOL_TASK));
+        if (tasks == NULL) {
+            pthread_mutex_unlock(&(deque) -> lock);
+            return -1;
+        }
+        for (long i = (deque) -> top; i < (deque) -> bottom; i++) {
+            *(tasks + i % capacity) = *((deque) -> tasks + i % (deque) -> capacity);
+        }
+        free((deque) -> tasks);
+        (deque) -> tasks = tasks;
+        (deque) -> capacity = capacity;
+    }
+    *((deque) -> tasks + (deque) -> bottom % (deque) -> capacity) = task;
+    (deque) -> bottom++;
+    pthread_mutex_unlock(&(deque) -> lock);
+    return 0;
+}
+
+/*
+ * Take a task from the bottom of a deque (its owner) or the top (a thief).
+ * Returns 1 if a task was taken, 0 if the deque is empty.
+ */
+static int deque_take(POOL_DEQUE *deque, int steal, POOL_TASK *task) {
+    pthread_mutex_lock(&(deque) -> lock);
+    int found = (deque) -> bottom > (deque) -> top;
+    if (found && steal) {
+        *task = *((deque) -> tasks + (deque) -> top % (deque) -> capacity);
+        (deque) -> top++;
+    } else if (found) {
+        (deque) -> bottom--;
+        *task = *((deque) -> tasks + (deque) -> bottom % (deque) -> capacity);
+    }
+    pthread_mutex_unlock(&(deque) -> lock);
+    return found;
+}
+
+/*
+ * Find a task for the calling thread: from its own deque if it is a worker,
+ * otherwise by stealing, starting with the next worker along.
+ */
+static int pool_find_task(POOL *pool, POOL_TASK *task) {
+    if (atomic_load(&(pool) -> queued) == 0) {
+        return 0;
+    }
+    int self = pool_self == pool ? pool_self_index : -1;
+    if (self >= 0 && deque_take((pool) -> deques + self, 0, task)) {
+        atomic_fetch_sub(&(pool) -> queued, 1);
+        return 1;
+    }
+    for (int i = 1; i <= (pool) -> num_threads; i++) {
+        int victim = (self + i) % (pool) -> num_threads;
+        if (victim < 0) {
+            victim += (pool) -> num_threads;
+        }
+        if (victim != self && deque_take((pool) -> deques + victim, 1, task)) {
+            atomic_fetch_sub(&(pool) -> queued, 1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void pool_run_task(POOL *pool, POOL_TASK *task) {
+    (task) -> func((task) -> arg);
+    if (atomic_fetch_sub(&((task) -> group) -> pending, 1) == 1) { /* Last of its group */
+        pthread_mutex_lock(&(pool) -> lock);
+        pthread_cond_broadcast(&(pool) -> wakeup);
+        pthread_mutex_unlock(&(pool) -> lock);
+    }
+}
+
+static void *pool_worker(void *arg) {
+    POOL_WORKER_ARG *worker = arg;
+    POOL *pool = (worker) -> pool;
+    pool_self = pool;
+    pool_self_index = (worker) -> index;
+    free(worker);
+    POOL_TASK task;
+    while (1) {
+        if (pool_find_task(pool, &task)) {
+            pool_run_task(pool, &task);
+            continue;
+        }
+        pthread_mutex_lock(&(pool) -> lock);
+        while (atomic_load(&(pool) -> queued) == 0 && !(pool) -> shutdown) {
+            pthread_cond_wait(&(pool) -> wakeup, &(pool) -> lock);
+        }
+        int done = (pool) -> shutdown && atomic_load(&(pool) -> queued) == 0;
+        pthread_mutex_unlock(&(pool) -> lock);
+        if (done) {
+            return NULL;
+        }
+    }
+}
+
+/*
+ * Stop and join the first started workers, then free the pool.
+ */
+static void pool_free(POOL *pool, int started) {
+    pthread_mutex_lock(&(pool) -> lock);
+    (pool) -> shutdown = 1;
+    pthread_cond_broadcast(&(pool) -> wakeup);
+    pthread_mutex_unlock(&(pool) -> lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(*((pool) -> threads + i), NULL);
+    }
+    for (int i = 0; i < (pool) -> num_threads; i++) {
+        free(((pool) -> deques + i) -> tasks);
+        pthread_mutex_destroy(&((pool) -> deques + i) -> lock);
+    }
+    pthread_mutex_destroy(&(pool) -> lock);
+    pthread_cond_destroy(&(pool) -> wakeup);
+    free((pool) -> threads);
+    free((pool) -> deques);
+    free(pool);
+}
+
+POOL *pool_create(int num_threads) {
+    if (num_threads < 1) {
+        return NULL;
+    }
+    POOL *pool = calloc(1, sizeof(POOL));
+    if (pool == NULL) {
+        return NULL;
+    }
+    (pool) -> threads = calloc(num_threads, sizeof(pthread_t));
+    (pool) -> deques = calloc(num_threads, sizeof(POOL_DEQUE));
+    (pool) -> num_threads = num_threads;
+    atomic_init(&(pool) -> queued, 0);
+    atomic_init(&(pool) -> next, 0);
+    pthread_mutex_init(&(pool) -> lock, NULL);
+    pthread_cond_init(&(pool) -> wakeup, NULL);
+    if ((pool) -> threads == NULL || (pool) -> deques == NULL) {
+        (pool) -> num_threads = 0;
+        pool_free(pool, 0);
+        return NULL;
+    }
+    int ok = 1;
+    for (int i = 0; i < num_threads; i++) {
+        POOL_DEQUE *deque = (pool) -> deques + i;
+        pthread_mutex_init(&(deque) -> lock, NULL);
+        (deque) -> tasks = malloc(POOL_DEQUE_INITIAL * sizeof(POOL_TASK));
+        (deque) -> capacity = POOL_DEQUE_INITIAL;
+        ok = ok && (deque) -> tasks != NULL;
+    }
+    if (!ok) {
+        pool_free(pool, 0);
+        return NULL;
+    }
+    for (int i = 0; i < num_threads; i++) {
+        POOL_WORKER_ARG *arg = malloc(sizeof(POOL_WORKER_ARG));
+        if (arg != NULL) {
+            (arg) -> pool = pool;
+            (arg) -> index = i;
+        }
+        if (arg == NULL || pthread_create((pool) -> threads + i, NULL, pool_worker, arg) != 0) {
+            free(arg);
+            pool_free(pool, i);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void pool_destroy(POOL *pool) {
+    if (pool != NULL) {
+        pool_free(pool, (pool) -> num_threads);
+    }
+}
+
+int pool_submit(POOL *pool, POOL_GROUP *group, POOL_FUNC func, void *arg) {
+    POOL_TASK task = { func, arg, group };
+    int self = pool_self == pool ? pool_self_index : -1;
+    if (self < 0) {
+        self = atomic_fetch_add(&(pool) -> next, 1) % (pool) -> num_threads;
+    }
+    atomic_fetch_add(&(group) -> pending, 1);
+    if (deque_push((pool) -> deques + self, task) == -1) {
+        atomic_fetch_sub(&(group) -> pending, 1);
+        return -1;
+    }
+    atomic_fetch_add(&(pool) -> queued, 1);
+    pthread_mutex_lock(&(pool) -> lock);
+    pthread_cond_signal(&(pool) -> wakeup);
+    pthread_mutex_unlock(&(pool) -> lock);
+    return 0;
+}
+
+void pool_wait(POOL *pool, POOL_GROUP *group) {
+    POOL_TASK task;
+    while (atomic_load(&(group) -> pending) > 0) {
+        if (pool_find_task(pool, &task)) {
+            pool_run_task(pool, &task);
+            continue;
+        }
+        pthread_mutex_lock(&(pool) -> lock);
+        while (atomic_load(&(group) -> pending) > 0 && atomic_load(&(pool) -> queued) == 0) {
+            pthread_cond_wait(&(pool) -> wakeup, &(pool) -> lock);
+        }
+        pthread_mutex_unlock(&(pool) -> lock);
+    }
+}
+
+int pool_worker_index() {
+    return pool_self_index;
+}
+
+void pool_set_threads(int num_threads) {
+    pthread_mutex_lock(&shared_lock);
+    if (num_threads < 1) {
+        num_threads = 1;
+    } else if (num_threads > POOL_THREADS_MAX) {
+        num_threads = POOL_THREADS_MAX;
+    }
+    if (shared_pool != NULL && (shared_pool) -> num_threads != num_threads - 1) {
+        pool_destroy(shared_pool); /* Started afresh with the new size when next needed */
+        shared_pool = NULL;
+    }
+    shared_threads = num_threads;
+    pthread_mutex_unlock(&shared_lock);
+}
+
+int pool_threads() {
+    pthread_mutex_lock(&shared_lock);
+    if (shared_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        shared_threads = cpus < 1 ? 1 : cpus > POOL_THREADS_MAX ? POOL_THREADS_MAX : cpus;
+    }
+    int num_threads = shared_threads;
+    pthread_mutex_unlock(&shared_lock);
+    return num_threads;
+}
+
+POOL *pool_shared() {
+    int num_threads = pool_threads();
+    if (num_threads <= 1) {
+        return NULL;
+    }
+    pthread_mutex_lock(&shared_lock);
+    if (shared_pool == NULL) {
+        shared_pool = pool_create(num_threads - 1);
+    }
+    POOL *pool = shared_pool;
+    pthread_mutex_unlock(&shared_lock);
+    return pool;
+}
@@ -0,0 +1,437 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bdd.h"
+#include "debug.h"
+#include "bdd2.h"
+#include "quad.h"
+#include "quad2.h"
+#include "stats.h"
+#include "trace.h"
+
+/*
+ * Results of the walks below that build new nodes, plus one, indexed by the
+ * quadtree (or, for bdd_quad_from_bdd, the BDD) node they were computed for;
+ * 0 if there is none yet.
+ */
+static _Thread_local int *quad_memo = NULL;
+
+/* The halves written so far by bdd_quad_serialize, and the size of their table. */
+static _Thread_local QUAD_HALF *quad_halves = NULL;
+static _Thread_local int quad_halves_size = 0;
+
+int bdd_quad_lookup(int level, int top_left, int top_right, int bottom_left, int bottom_right) {
+    if (top_left == top_right && top_left == bottom_left && top_left == bottom_right) {
+        return top_left;
+    }
+    if (quad_store_reserve() == -1) {
+        return -1;
+    }
+    unsigned int hash = quad_hash_function(level, top_left, top_right, bottom_left, bottom_right);
+    unsigned int fingerprint = BDD_HASH_FINGERPRINT(hash);
+    unsigned int *slot = bdd_quad_hash_map + (hash & (bdd_quad_hash_size - 1));
+    while (*slot != 0) {
+        if (BDD_HASH_FINGERPRINT(*slot) == fingerprint) { /* Only then is the node itself examined */
+            int curr_index = *slot & BDD_HASH_INDEX_MASK;
+            QUAD_NODE *curr_node = bdd_quad_nodes + curr_index;
+            if ((curr_node) -> level == level && (curr_node) -> top_left == top_left
+                && (curr_node) -> top_right == top_right && (curr_node) -> bottom_left == bottom_left
+                && (curr_node) -> bottom_right == bottom_right) {
+                return curr_index;
+            }
+        }
+        slot++;
+        if (slot >= (bdd_quad_hash_map + bdd_quad_hash_size)) {
+            slot = bdd_quad_hash_map;
+        }
+    }
+    int index = QUAD_END;
+    QUAD_NODE *node = bdd_quad_nodes + index;
+    *node = (QUAD_NODE) { level, top_left, top_right, bottom_left, bottom_right };
+    *slot = index | fingerprint;
+    bdd_quad_count++;
+    return index;
+}
+
+/*
+ * Hash a node as hash_function does, after folding its four children into
+ * two values: the level and children fit in 84 bits, so they are mixed in
+ * two rounds of the MurmurHash3 finalizer.
+ */
+unsigned int quad_hash_function(int level, int top_left, int top_right, int bottom_left, int bottom_right) {
+    unsigned long long key = ((unsigned long long) level << 40) | ((unsigned long long) top_right << 20) | top_left;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= ((unsigned long long) bottom_right << 20) | bottom_left;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return (unsigned int) key;
+}
+
+int quad_store_reserve() {
+    if (QUAD_END >= BDD_QUAD_NODES_MAX) {
+        return -1;
+    }
+    if (QUAD_END >= (birp_context) -> quad_nodes_size) {
+        int size = (birp_context) -> quad_nodes_size == 0 ? BDD_NODES_INITIAL : (birp_context) -> quad_nodes_size * 2;
+        if (size > BDD_QUAD_NODES_MAX) {
+            size = BDD_QUAD_NODES_MAX;
+        }
+        QUAD_NODE *nodes = realloc(bdd_quad_nodes, size * sizeof(QUAD_NODE));
+        if (nodes == NULL) {
+            return -1;
+        }
+        bdd_quad_nodes = nodes;
+        (birp_context) -> quad_nodes_size = size;
+    }
+    if ((bdd_quad_count + 1) * 2 > bdd_quad_hash_size && quad_hash_grow() == -1) {
+        return -1;
+    }
+    return 0;
+}
+
+int quad_hash_grow() {
+    int size = bdd_quad_hash_size == 0 ? BDD_HASH_INITIAL : bdd_quad_hash_size * 2;
+    unsigned int *map = calloc(size, sizeof(unsigned int));
+    if (map == NULL) {
+        return -1;
+    }
+    QUAD_NODE *node = bdd_quad_nodes + BDD_NUM_LEAVES;
+    for (int index = BDD_NUM_LEAVES; index < QUAD_END; index++) {
+        unsigned int hash = quad_hash_function((node) -> level, (node) -> top_left, (node) -> top_right,
+                                               (node) -> bottom_left, (node) -> bottom_right);
+        unsigned int *slot = map + (hash & (size - 1));
+        while (*slot != 0) { /* Nodes are distinct, so only an empty slot is needed */
+            slot++;
+            if (slot >= map + size) {
+                slot = map;
+            }
+        }
+        *slot = index | BDD_HASH_FINGERPRINT(hash);
+        node++;
+    }
+    free(bdd_quad_hash_map);
+    bdd_quad_hash_map = map;
+    bdd_quad_hash_size = size;
+    return 0;
+}
+
+void bdd_quad_reset() {
+    unsigned int *slot = bdd_quad_hash_map;
+    for (int i = 0; i < bdd_quad_hash_size; i++) {
+        *slot = 0;
+        slot++;
+    }
+    bdd_quad_count = 0;
+}
+
+int bdd_quad_from_raster(int w, int h, unsigned char *raster) {
+    int level = bdd_min_level(w, h);
+    if (level > BDD_LEVELS_MAX) {
+        return -1;
+    }
+    TRACE_BEGIN("bdd_quad_from_raster");
+    int quad = bdd_quad_from_raster_recurse(w, h, raster, level / 2, 0, 0);
+    TRACE_END("bdd_quad_from_raster");
+    return quad;
+}
+
+int bdd_quad_from_raster_recurse(int w, int h, unsigned char *raster, int level, int row, int col) {
+    if (row >= h || col >= w) { /* Outside of raster */
+        return 0;
+    }
+    if (level == 0) {
+        return *(raster + ((size_t) row * w) + col);
+    }
+    int half = 1 << (level - 1);
+    int top_left = bdd_quad_from_raster_recurse(w, h, raster, level - 1, row, col);
+    int top_right = top_left == -1 ? -1 : bdd_quad_from_raster_recurse(w, h, raster, level - 1, row, col + half);
+    int bottom_left = top_right == -1 ? -1 : bdd_quad_from_raster_recurse(w, h, raster, level - 1, row + half, col);
+    int bottom_right = bottom_left == -1 ? -1 : bdd_quad_from_raster_recurse(w, h, raster, level - 1, row + half, col + half);
+    if (bottom_right == -1) {
+        return -1;
+    }
+    return bdd_quad_lookup(level, top_left, top_right, bottom_left, bottom_right);
+}
+
+void bdd_quad_to_raster(int quad, int w, int h, unsigned char *raster) {
+    TRACE_BEGIN("bdd_quad_to_raster");
+    bdd_quad_to_raster_recurse(quad, bdd_min_level(w, h) / 2, 0, 0, w, h, raster);
+    TRACE_END("bdd_quad_to_raster");
+}
+
+void bdd_quad_to_raster_recurse(int quad, int level, int row, int col, int w, int h, unsigned char *raster) {
+    if (row >= h || col >= w) {
+        return;
+    }
+    if (quad < BDD_NUM_LEAVES) { /* A uniform square: fill its part of the raster */
+        int row_max = row + (1 << level) < h ? row + (1 << level) : h;
+        int col_max = col + (1 << level) < w ? col + (1 << level) : w;
+        for (int r = row; r < row_max; r++) {
+            unsigned char *pixel = raster + (size_t) r * w + col;
+            for (int c = col; c < col_max; c++) {
+                *pixel = quad;
+                pixel++;
+            }
+        }
+        return;
+    }
+    int half = 1 << (level - 1);
+    for (int q = 0; q < 4; q++) {
+        bdd_quad_to_raster_recurse(QUAD_CHILD(quad, q, level), level - 1, row + (q >> 1) * half,
+                                   col + (q & 1) * half, w, h, raster);
+    }
+}
+
+int bdd_quad_from_bdd(BDD_NODE *node) {
+    if (clear_bdd_index_map() == -1) {
+        return -1;
+    }
+    return bdd_quad_from_bdd_recurse(node);
+}
+
+/*
+ * The quadtree of a node interpreted at any even level at or above its own
+ * is the same, the larger squares being tiled with it, so each BDD node is
+ * converted once, at the even level just above its own.
+ */
+int bdd_quad_from_bdd_recurse(BDD_NODE *node) {
+    int bdd_node_index = bdd_node_to_index(node);
+    if (bdd_node_index < BDD_NUM_LEAVES) {
+        return bdd_node_index;
+    }
+    STATS(birp_stats.memo_lookups++);
+    if (*(bdd_index_map + bdd_node_index) != 0) { /* If node has already been converted */
+        STATS(birp_stats.memo_hits++);
+        return *(bdd_index_map + bdd_node_index) - 1;
+    }
+    int level = ((node) -> level + 1) & ~1;
+    BDD_NODE *top = LEFT(node, level);
+    BDD_NODE *bottom = RIGHT(node, level);
+    int top_left = bdd_quad_from_bdd_recurse(LEFT(top, level - 1));
+    int top_right = top_left == -1 ? -1 : bdd_quad_from_bdd_recurse(RIGHT(top, level - 1));
+    int bottom_left = top_right == -1 ? -1 : bdd_quad_from_bdd_recurse(LEFT(bottom, level - 1));
+    int bottom_right = bottom_left == -1 ? -1 : bdd_quad_from_bdd_recurse(RIGHT(bottom, level - 1));
+    if (bottom_right == -1) {
+        return -1;
+    }
+    int quad = bdd_quad_lookup(level / 2, top_left, top_right, bottom_left, bottom_right);
+    if (quad == -1) {
+        return -1;
+    }
+    *(bdd_index_map + bdd_node_index) = quad + 1;
+    return quad;
+}
+
+BDD_NODE *bdd_quad_to_bdd(int quad) {
+    if (bdd_store_init() == -1) {
+        return NULL;
+    }
+    quad_memo = calloc(QUAD_END, sizeof(int));
+    if (quad_memo == NULL) {
+        return NULL;
+    }
+    int index = bdd_quad_to_bdd_recurse(quad);
+    free(quad_memo);
+    quad_memo = NULL;
+    if (index == -1) {
+        return NULL;
+    }
+    return index_to_bdd_node(index);
+}
+
+int bdd_quad_to_bdd_recurse(int quad) {
+    if (quad < BDD_NUM_LEAVES) {
+        return quad;
+    }
+    STATS(birp_stats.memo_lookups++);
+    if (*(quad_memo + quad) != 0) { /* If node has already been converted */
+        STATS(birp_stats.memo_hits++);
+        return *(quad_memo + quad) - 1;
+    }
+    QUAD_NODE node = *(bdd_quad_nodes + quad); /* The recursion does not grow the quadtree table */
+    int top_left = bdd_quad_to_bdd_recurse((node).top_left);
+    int top_right = top_left == -1 ? -1 : bdd_quad_to_bdd_recurse((node).top_right);
+    int bottom_left = top_right == -1 ? -1 : bdd_quad_to_bdd_recurse((node).bottom_left);
+    int bottom_right = bottom_left == -1 ? -1 : bdd_quad_to_bdd_recurse((node).bottom_right);
+    if (bottom_right == -1) {
+        return -1;
+    }
+    int level = (node).level;
+    int top = bdd_lookup(2 * level - 1, top_left, top_right);
+    int bottom = top == -1 ? -1 : bdd_lookup(2 * level - 1, bottom_left, bottom_right);
+    int index = bottom == -1 ? -1 : bdd_lookup(2 * level, top, bottom);
+    if (index == -1) {
+        return -1;
+    }
+    *(quad_memo + quad) = index + 1;
+    return index;
+}
+
+int bdd_quad_rotate(int quad) {
+    quad_memo = calloc(QUAD_END, sizeof(int));
+    if (quad_memo == NULL) {
+        return -1;
+    }
+    TRACE_BEGIN("bdd_quad_rotate");
+    int rotated = bdd_quad_rotate_recurse(quad);
+    TRACE_END("bdd_quad_rotate");
+    free(quad_memo);
+    quad_memo = NULL;
+    return rotated;
+}
+
+/*
+ * Turning a square counterclockwise brings its top right quadrant to the
+ * top left, its bottom right to the top right, and so on round.
+ */
+int bdd_quad_rotate_recurse(int quad) {
+    if (quad < BDD_NUM_LEAVES) {
+        return quad;
+    }
+    STATS(birp_stats.memo_lookups++);
+    if (*(quad_memo + quad) != 0) { /* If node has already been rotated */
+        STATS(birp_stats.memo_hits++);
+        return *(quad_memo + quad) - 1;
+    }
+    QUAD_NODE node = *(bdd_quad_nodes + quad); /* Copied, since the table moves as rotated nodes are added */
+    int top_left = bdd_quad_rotate_recurse((node).top_right);
+    int top_right = top_left == -1 ? -1 : bdd_quad_rotate_recurse((node).bottom_right);
+    int bottom_left = top_right == -1 ? -1 : bdd_quad_rotate_recurse((node).top_left);
+    int bottom_right = bottom_left == -1 ? -1 : bdd_quad_rotate_recurse((node).bottom_left);
+    if (bottom_right == -1) {
+        return -1;
+    }
+    int rotated = bdd_quad_lookup((node).level, top_left, top_right, bottom_left, bottom_right);
+    if (rotated == -1) {
+        return -1;
+    }
+    *(quad_memo + quad) = rotated + 1;
+    return rotated;
+}
+
+int bdd_quad_serialize(int quad, FILE *out) {
+    int size = 16;
+    while (size < 4 * bdd_quad_count) { /* Each node has at most two halves; keep them at most half full */
+        size *= 2;
+    }
+    quad_memo = calloc(QUAD_END, sizeof(int));
+    quad_halves = calloc(size, sizeof(QUAD_HALF));
+    if (quad_memo == NULL || quad_halves == NULL) {
+        free(quad_memo);
+        free(quad_halves);
+        quad_memo = NULL;
+        quad_halves = NULL;
+        return -1;
+    }
+    quad_halves_size = size;
+    TRACE_BEGIN("bdd_quad_serialize");
+    int serial;
+    bdd_quad_serialize_recurse(quad, out, 1, &serial);
+    TRACE_END("bdd_quad_serialize");
+    free(quad_memo);
+    free(quad_halves);
+    quad_memo = NULL;
+    quad_halves = NULL;
+    return 0;
+}
+
+/*
+ * Write the BDD nodes of a quadtree node in the order of
+ * bdd_serialize_recurse: the top half (a node at the odd level splitting
+ * the top left and top right quadrants, unless they are equal), the bottom
+ * half, and then the node at the even level that splits the halves, unless
+ * they are equal.  The serial number of the BDD node that stands for the
+ * quadtree node is stored in *serialp, and the next free one is returned.
+ */
+int bdd_quad_serialize_recurse(int quad, FILE *out, int serial_num, int *serialp) {
+    STATS(birp_stats.memo_lookups++);
+    if (*(quad_memo + quad) != 0) { /* If node has already been serialized */
+        STATS(birp_stats.memo_hits++);
+        *serialp = *(quad_memo + quad);
+        return serial_num;
+    }
+    if (quad < BDD_NUM_LEAVES) {
+        fputc('@', out);
+        fputc(quad, out);
+        *(quad_memo + quad) = serial_num;
+        *serialp = serial_num;
+        return serial_num + 1;
+    }
+    QUAD_NODE node = *(bdd_quad_nodes + quad);
+    int top_serial, bottom_serial;
+    serial_num = bdd_quad_serialize_half(2 * (node).level - 1, (node).top_left, (node).top_right,
+                                         out, serial_num, &top_serial);
+    serial_num = bdd_quad_serialize_half(2 * (node).level - 1, (node).bottom_left, (node).bottom_right,
+                                         out, serial_num, &bottom_serial);
+    if (top_serial == bottom_serial) { /* The rows repeat, so the even level is skipped */
+        *(quad_memo + quad) = top_serial;
+        *serialp = top_serial;
+        return serial_num;
+    }
+    fputc(2 * (node).level + 64, out);
+    output_serial_number(top_serial, out);
+    output_serial_number(bottom_serial, out);
+    *(quad_memo + quad) = serial_num;
+    *serialp = serial_num;
+    return serial_num + 1;
+}
+
+/*
+ * Write the node at an odd level that splits two quadtree nodes side by
+ * side, unless they are equal or it has already been written, after the
+ * two nodes themselves (which write nothing if it has), as for
+ * bdd_quad_serialize_recurse.
+ */
+int bdd_quad_serialize_half(int level, int left, int right, FILE *out, int serial_num, int *serialp) {
+    int left_serial, right_serial;
+    serial_num = bdd_quad_serialize_recurse(left, out, serial_num, &left_serial);
+    if (left == right) {
+        *serialp = left_serial;
+        return serial_num;
+    }
+    serial_num = bdd_quad_serialize_recurse(right, out, serial_num, &right_serial);
+    unsigned int hash = hash_function(level, left, right); /* A half is keyed as a BDD node is */
+    QUAD_HALF *slot = quad_halves + (hash & (quad_halves_size - 1));
+    while ((slot) -> serial != 0) {
+        if ((slot) -> level == level && (slot) -> left == left && (slot) -> right == right) {
+            *serialp = (slot) -> serial;
+            return serial_num;
+        }
+        slot++;
+        if (slot >= quad_halves + quad_halves_size) {
+            slot = quad_halves;
+        }
+    }
+    fputc(level + 64, out);
+    output_serial_number(left_serial, out);
+    output_serial_number(right_serial, out);
+    *slot = (QUAD_HALF) { level, left, right, serial_num };
+    *serialp = serial_num;
+    return serial_num + 1;
+}
+
+int bdd_quad_count_nodes(int quad) {
+    quad_memo = calloc(QUAD_END, sizeof(int));
+    if (quad_memo == NULL) {
+        return -1;
+    }
+    int count = bdd_quad_count_nodes_recurse(quad);
+    free(quad_memo);
+    quad_memo = NULL;
+    return count;
+}
+
+int bdd_quad_count_nodes_recurse(int quad) {
+    if (*(quad_memo + quad) != 0) { /* Already counted */
+        return 0;
+    }
+    *(quad_memo + quad) = 1;
+    if (quad < BDD_NUM_LEAVES) {
+        return 1;
+    }
+    QUAD_NODE *node = bdd_quad_nodes + quad;
+    return 1 + bdd_quad_count_nodes_recurse((node) -> top_left) + bdd_quad_count_nodes_recurse((node) -> top_right)
+        + bdd_quad_count_nodes_recurse((node) -> bottom_left) + bdd_quad_count_nodes_recurse((node) -> bottom_right);
+}
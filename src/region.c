@@ -0,0 +1,505 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "bdd.h"
+#include "debug.h"
+#include "bdd2.h"
+#include "region.h"
+#include "region2.h"
+#include "stats.h"
+
+/* Grow the sum table to cover a node index, marking new entries uncomputed */
+static int allocate_sum_table(int node_index) {
+    if (bdd_sum_table == NULL) { /* Freed when the node table is reset */
+        bdd_sum_table_size = 0;
+    }
+    int size = bdd_sum_table_size * 2;
+    if (size <= node_index) {
+        size = current_bdd_node_index > node_index ? current_bdd_node_index : node_index + 1;
+    }
+    long long *table = realloc(bdd_sum_table, size * sizeof(long long));
+    if (table == NULL) {
+        return -1;
+    }
+    long long *entry = table + bdd_sum_table_size;
+    for (int i = bdd_sum_table_size; i < size; i++) {
+        *entry = -1;
+        entry++;
+    }
+    bdd_sum_table = table;
+    bdd_sum_table_size = size;
+    return 0;
+}
+
+long long bdd_node_sum(BDD_NODE *node) {
+    int node_index = bdd_node_to_index(node);
+    if (node_index < BDD_NUM_LEAVES) {
+        return node_index;
+    }
+    if ((bdd_sum_table == NULL || node_index >= bdd_sum_table_size) && allocate_sum_table(node_index) == -1) {
+        return -1;
+    }
+    long long *entry = bdd_sum_table + node_index;
+    STATS(birp_stats.memo_lookups++);
+    if (*entry != -1) { /* If sum has already been computed */
+        STATS(birp_stats.memo_hits++);
+        return *entry;
+    }
+    int level = (node) -> level;
+    long long left = bdd_level_sum(index_to_bdd_node((node) -> left), level - 1);
+    long long right = bdd_level_sum(index_to_bdd_node((node) -> right), level - 1);
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    *entry = left + right;
+    return *entry;
+}
+
+long long bdd_level_sum(BDD_NODE *node, int level) {
+    long long sum = bdd_node_sum(node);
+    if (sum == -1) {
+        return -1;
+    }
+    int node_level = bdd_node_to_index(node) < BDD_NUM_LEAVES ? 0 : (node) -> level;
+    return sum << (level - node_level); /* Each skipped level doubles the covered area */
+}
+
+long long bdd_region_sum(BDD_NODE *node, int w, int h, int row, int col, int height, int width,
+                         long long *countp) {
+    if (height < 0 || width < 0) {
+        return -1;
+    }
+    int row_min = row < 0 ? 0 : row;
+    int col_min = col < 0 ? 0 : col;
+    int row_max = row + height > h ? h : row + height;
+    int col_max = col + width > w ? w : col + width;
+    if (row_max < row_min) {
+        row_max = row_min;
+    }
+    if (col_max < col_min) {
+        col_max = col_min;
+    }
+    if (countp != NULL) {
+        *countp = (long long) (row_max - row_min) * (col_max - col_min);
+    }
+    if (row_max == row_min || col_max == col_min) {
+        return 0;
+    }
+    int level = bdd_min_level(w, h);
+    if (bdd_node_to_index(node) >= BDD_NUM_LEAVES && (node) -> level > level) {
+        level = (node) -> level;
+    }
+    return bdd_region_sum_recurse(node, level, 0, 0, row_min, row_max, col_min, col_max);
+}
+
+long long bdd_region_sum_recurse(BDD_NODE *node, int level, int row, int col,
+                                 int row_min, int row_max, int col_min, int col_max) {
+    int row_end = row + LEVEL_ROWS(level);
+    int col_end = col + LEVEL_COLS(level);
+    if (row_end <= row_min || row >= row_max || col_end <= col_min || col >= col_max) { /* Disjoint */
+        return 0;
+    }
+    if (row >= row_min && row_end <= row_max && col >= col_min && col_end <= col_max) { /* Covered */
+        return bdd_level_sum(node, level);
+    }
+    int node_index = bdd_node_to_index(node);
+    if (node_index < BDD_NUM_LEAVES) { /* Uniform region: value times overlap area */
+        long long rows = (row_end < row_max ? row_end : row_max) - (row > row_min ? row : row_min);
+        long long cols = (col_end < col_max ? col_end : col_max) - (col > col_min ? col : col_min);
+        return node_index * rows * cols;
+    }
+    long long left;
+    long long right;
+    if (level % 2 == 0) { /* Top and bottom halves */
+        int row_middle = (row + row_end) / 2;
+        left = bdd_region_sum_recurse(LEFT(node, level), level - 1, row, col,
+                                      row_min, row_max, col_min, col_max);
+        right = bdd_region_sum_recurse(RIGHT(node, level), level - 1, row_middle, col,
+                                       row_min, row_max, col_min, col_max);
+    } else { /* Left and right halves */
+        int col_middle = (col + col_end) / 2;
+        left = bdd_region_sum_recurse(LEFT(node, level), level - 1, row, col,
+                                      row_min, row_max, col_min, col_max);
+        right = bdd_region_sum_recurse(RIGHT(node, level), level - 1, row, col_middle,
+                                       row_min, row_max, col_min, col_max);
+    }
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    return left + right;
+}
+
+
+
+
+/* Bounding boxes of nodes at their own level, valid during one bdd_bounding_box call. */
+static _Thread_local BDD_BOX *bbox_memo = NULL;
+
+static void merge_box(BDD_BOX *box, int row_min, int col_min, int row_max, int col_max) {
+    if (row_min >= row_max || col_min >= col_max) {
+        return;
+    }
+    if ((box) -> row_min >= (box) -> row_max) { /* Box is still empty */
+        (box) -> row_min = row_min;
+        (box) -> col_min = col_min;
+        (box) -> row_max = row_max;
+        (box) -> col_max = col_max;
+        return;
+    }
+    if (row_min < (box) -> row_min) {
+        (box) -> row_min = row_min;
+    }
+    if (col_min < (box) -> col_min) {
+        (box) -> col_min = col_min;
+    }
+    if (row_max > (box) -> row_max) {
+        (box) -> row_max = row_max;
+    }
+    if (col_max > (box) -> col_max) {
+        (box) -> col_max = col_max;
+    }
+}
+
+int bdd_bounding_box(BDD_NODE *node, int w, int h, unsigned char background,
+                     int *rowp, int *colp, int *heightp, int *widthp) {
+    bbox_memo = malloc(current_bdd_node_index * sizeof(BDD_BOX));
+    if (bbox_memo == NULL) {
+        return -1;
+    }
+    BDD_BOX *entry = bbox_memo;
+    for (int i = 0; i < current_bdd_node_index; i++) {
+        (entry) -> row_min = -1; /* Not computed yet */
+        entry++;
+    }
+    BDD_BOX box = {0, 0, 0, 0};
+    int level = bdd_min_level(w, h);
+    if (bdd_node_to_index(node) >= BDD_NUM_LEAVES && (node) -> level > level) {
+        level = (node) -> level;
+    }
+    bdd_bounding_box_recurse(node, level, 0, 0, w, h, background, &box);
+    free(bbox_memo);
+    bbox_memo = NULL;
+    *rowp = box.row_min;
+    *colp = box.col_min;
+    *heightp = box.row_max - box.row_min;
+    *widthp = box.col_max - box.col_min;
+    return box.row_min < box.row_max;
+}
+
+BDD_BOX bdd_local_box(BDD_NODE *node, int level, int background) {
+    BDD_BOX box = {0, 0, 0, 0};
+    int node_index = bdd_node_to_index(node);
+    if (node_index < BDD_NUM_LEAVES) {
+        if (node_index != background) {
+            merge_box(&box, 0, 0, LEVEL_ROWS(level), LEVEL_COLS(level));
+        }
+        return box;
+    }
+    int node_level = (node) -> level;
+    BDD_BOX *memo = bbox_memo + node_index;
+    if ((memo) -> row_min == -1) {
+        BDD_BOX own = {0, 0, 0, 0};
+        BDD_BOX left = bdd_local_box(index_to_bdd_node((node) -> left), node_level - 1, background);
+        BDD_BOX right = bdd_local_box(index_to_bdd_node((node) -> right), node_level - 1, background);
+        merge_box(&own, left.row_min, left.col_min, left.row_max, left.col_max);
+        if (node_level % 2 == 0) { /* Right child is the bottom half */
+            int offset = LEVEL_ROWS(node_level - 1);
+            merge_box(&own, right.row_min + offset, right.col_min, right.row_max + offset, right.col_max);
+        } else { /* Right child is the right half */
+            int offset = LEVEL_COLS(node_level - 1);
+            merge_box(&own, right.row_min, right.col_min + offset, right.row_max, right.col_max + offset);
+        }
+        *memo = own;
+    }
+    box = *memo;
+    if (box.row_min < box.row_max) { /* Skipped levels tile the node, stretching its box to the last copy */
+        box.row_max += LEVEL_ROWS(level) - LEVEL_ROWS(node_level);
+        box.col_max += LEVEL_COLS(level) - LEVEL_COLS(node_level);
+    }
+    return box;
+}
+
+void bdd_bounding_box_recurse(BDD_NODE *node, int level, int row, int col, int w, int h,
+                              int background, BDD_BOX *box) {
+    int row_end = row + LEVEL_ROWS(level);
+    int col_end = col + LEVEL_COLS(level);
+    if (row >= h || col >= w) { /* Entirely padding */
+        return;
+    }
+    if (row_end <= h && col_end <= w) { /* Entirely inside the image */
+        BDD_BOX local = bdd_local_box(node, level, background);
+        merge_box(box, local.row_min + row, local.col_min + col, local.row_max + row, local.col_max + col);
+        return;
+    }
+    int node_index = bdd_node_to_index(node);
+    if (node_index < BDD_NUM_LEAVES) {
+        if (node_index != background) {
+            merge_box(box, row, col, row_end < h ? row_end : h, col_end < w ? col_end : w);
+        }
+        return;
+    }
+    bdd_bounding_box_recurse(LEFT(node, level), level - 1, row, col, w, h, background, box);
+    if (level % 2 == 0) {
+        bdd_bounding_box_recurse(RIGHT(node, level), level - 1, row + LEVEL_ROWS(level - 1), col,
+                                 w, h, background, box);
+    } else {
+        bdd_bounding_box_recurse(RIGHT(node, level), level - 1, row, col + LEVEL_COLS(level - 1),
+                                 w, h, background, box);
+    }
+}
+
+
+
+
+/*
+ * Windows of the source already cropped by the current bdd_crop call, in an
+ * open-addressed table that doubles when half full.
+ */
+static _Thread_local BDD_CROP_ENTRY *crop_memo = NULL;
+static _Thread_local int crop_memo_size = 0;
+static _Thread_local int crop_memo_count = 0;
+
+/* Offset of the window into its grid, and extent of the cropped image, during one bdd_crop call. */
+static _Thread_local int crop_row, crop_col, crop_height, crop_width;
+
+BDD_NODE *bdd_crop(BDD_NODE *node, int w, int h, int row, int col, int height, int width) {
+    if (height < 0 || width < 0 || row < 0 || col < 0) {
+        return NULL;
+    }
+    if (height == 0 || width == 0) {
+        return index_to_bdd_node(0);
+    }
+    int src_level = bdd_min_level(w, h);
+    if (bdd_node_to_index(node) >= BDD_NUM_LEAVES && (node) -> level > src_level) {
+        src_level = (node) -> level;
+    }
+    int level = bdd_min_level(width, height);
+    if (level > BDD_LEVELS_MAX) {
+        return NULL;
+    }
+    crop_memo_size = 1024;
+    crop_memo_count = 0;
+    crop_memo = calloc(crop_memo_size, sizeof(BDD_CROP_ENTRY));
+    if (crop_memo == NULL) {
+        return NULL;
+    }
+    crop_row = row;
+    crop_col = col;
+    crop_height = height;
+    crop_width = width;
+    /* The blocks of the source at the level of the result that the window overlaps */
+    int block_row = row - row % LEVEL_ROWS(level);
+    int block_col = col - col % LEVEL_COLS(level);
+    int next_row = block_row + LEVEL_ROWS(level);
+    int next_col = block_col + LEVEL_COLS(level);
+    int top_left = bdd_crop_block(node, src_level, level, block_row, block_col);
+    int top_right = top_left == -1 ? -1 : bdd_crop_block(node, src_level, level, block_row, next_col);
+    int bottom_left = top_right == -1 ? -1 : bdd_crop_block(node, src_level, level, next_row, block_col);
+    int bottom_right = bottom_left == -1 ? -1 : bdd_crop_block(node, src_level, level, next_row, next_col);
+    int clip = (height < LEVEL_ROWS(level) ? BDD_CROP_CLIP_ROWS : 0) | (width < LEVEL_COLS(level) ? BDD_CROP_CLIP_COLS : 0);
+    int index = -1;
+    if (bottom_right != -1) {
+        index = bdd_crop_recurse(level, top_left, top_right, bottom_left, bottom_right, clip);
+    }
+    free(crop_memo);
+    crop_memo = NULL;
+    if (index == -1) {
+        return NULL;
+    }
+    return index_to_bdd_node(index);
+}
+
+/*
+ * The node for the block of the source at a level whose top left pixel is
+ * at (row, col): the source square is padded with 0 to any larger level.
+ */
+int bdd_crop_block(BDD_NODE *src, int src_level, int level, int row, int col) {
+    if (level >= src_level) {
+        if (row != 0 || col != 0) {
+            return 0;
+        }
+        int index = bdd_node_to_index(src);
+        for (int l = src_level + 1; l <= level && index != -1; l++) {
+            index = bdd_lookup(l, index, 0);
+        }
+        return index;
+    }
+    if (row >= LEVEL_ROWS(src_level) || col >= LEVEL_COLS(src_level)) {
+        return 0;
+    }
+    BDD_NODE *node = src;
+    for (int l = src_level; l > level; l--) {
+        int second = l % 2 == 0 ? row % LEVEL_ROWS(l) >= LEVEL_ROWS(l - 1) : col % LEVEL_COLS(l) >= LEVEL_COLS(l - 1);
+        node = second ? RIGHT(node, l) : LEFT(node, l);
+    }
+    return bdd_node_to_index(node);
+}
+
+/* The memo entry for a window, or the empty slot where it belongs. */
+static BDD_CROP_ENTRY *crop_memo_find(int key, int top_left, int top_right, int bottom_left, int bottom_right) {
+    unsigned int hash = hash_function(key, top_left, top_right) ^ (hash_function(key, bottom_left, bottom_right) * 0x9e3779b1u);
+    BDD_CROP_ENTRY *entry = crop_memo + (hash & (crop_memo_size - 1));
+    while ((entry) -> result != 0) {
+        if ((entry) -> key == key && (entry) -> top_left == top_left && (entry) -> top_right == top_right
+            && (entry) -> bottom_left == bottom_left && (entry) -> bottom_right == bottom_right) {
+            break;
+        }
+        entry++;
+        if (entry >= crop_memo + crop_memo_size) {
+            entry = crop_memo;
+        }
+    }
+    return entry;
+}
+
+static int crop_memo_grow() {
+    BDD_CROP_ENTRY *old = crop_memo;
+    int old_size = crop_memo_size;
+    crop_memo = calloc(2 * old_size, sizeof(BDD_CROP_ENTRY));
+    if (crop_memo == NULL) {
+        crop_memo = old;
+        return -1;
+    }
+    crop_memo_size = 2 * old_size;
+    BDD_CROP_ENTRY *entry = old;
+    for (int i = 0; i < old_size; i++) {
+        if ((entry) -> result != 0) {
+            *crop_memo_find((entry) -> key, (entry) -> top_left, (entry) -> top_right,
+                            (entry) -> bottom_left, (entry) -> bottom_right) = *entry;
+        }
+        entry++;
+    }
+    free(old);
+    return 0;
+}
+
+/*
+ * Half j, counting along the axis a level splits, of the line of two
+ * blocks first and second at that level.
+ */
+static int crop_line_half(int level, int first, int second, int j) {
+    BDD_NODE *node = index_to_bdd_node(j < 2 ? first : second);
+    return bdd_node_to_index(j % 2 == 0 ? LEFT(node, level) : RIGHT(node, level));
+}
+
+/*
+ * Build the block of the cropped image at a level, from the 2 x 2 grid of
+ * blocks of the source at the same level that it overlaps.  As the blocks of the result are
+ * aligned, it lies at the same offset into its grid at every position on a
+ * level, so the window is determined by the grid alone, and each distinct
+ * grid is built once however often it recurs.  The clip bits mark a block
+ * across the bottom or right edge of the result, beyond which it is 0.
+ */
+int bdd_crop_recurse(int level, int top_left, int top_right, int bottom_left, int bottom_right, int clip) {
+    int row_offset = crop_row % LEVEL_ROWS(level);
+    int col_offset = crop_col % LEVEL_COLS(level);
+    if (level == 0 || (row_offset == 0 && col_offset == 0 && clip == 0)) { /* The window is a block of the source */
+        return top_left;
+    }
+    int key = level * 4 + clip;
+    STATS(birp_stats.memo_lookups++);
+    BDD_CROP_ENTRY *entry = crop_memo_find(key, top_left, top_right, bottom_left, bottom_right);
+    if ((entry) -> result != 0) {
+        STATS(birp_stats.memo_hits++);
+        return (entry) -> result - 1;
+    }
+    /*
+     * The grid is two lines of two blocks along the axis this level splits,
+     * the columns at an even level and the rows at an odd one; the halves
+     * of the result take halves k to k + 1 and k + 1 to k + 2 of each line.
+     */
+    int even = level % 2 == 0;
+    int near_second = even ? bottom_left : top_right;
+    int far_first = even ? top_right : bottom_left;
+    int half = even ? LEVEL_ROWS(level - 1) : LEVEL_COLS(level - 1);
+    int k = (even ? row_offset : col_offset) / half;
+    int near0 = crop_line_half(level, top_left, near_second, k);
+    int near1 = crop_line_half(level, top_left, near_second, k + 1);
+    int near2 = crop_line_half(level, top_left, near_second, k + 2);
+    int far0 = crop_line_half(level, far_first, bottom_right, k);
+    int far1 = crop_line_half(level, far_first, bottom_right, k + 1);
+    int far2 = crop_line_half(level, far_first, bottom_right, k + 2);
+    /* An edge of the result within this block falls in one of its halves */
+    int axis_clip = level % 2 == 0 ? BDD_CROP_CLIP_ROWS : BDD_CROP_CLIP_COLS;
+    int first_clip = clip;
+    int second_clip = clip;
+    int second_empty = 0;
+    if (clip & axis_clip) {
+        int edge = (level % 2 == 0 ? crop_height % LEVEL_ROWS(level) : crop_width % LEVEL_COLS(level));
+        first_clip = edge < half ? clip : clip & ~axis_clip;
+        second_empty = edge <= half;
+    }
+    int left = bdd_crop_recurse(level - 1, near0, even ? far0 : near1, even ? near1 : far0, far1, first_clip);
+    int right = second_empty || left == -1 ? 0
+        : bdd_crop_recurse(level - 1, near1, even ? far1 : near2, even ? near2 : far1, far2, second_clip);
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    int index = bdd_lookup(level, left, right);
+    if (index == -1) {
+        return -1;
+    }
+    if (crop_memo_count * 2 >= crop_memo_size && crop_memo_grow() == -1) {
+        return -1;
+    }
+    entry = crop_memo_find(key, top_left, top_right, bottom_left, bottom_right);
+    *entry = (BDD_CROP_ENTRY) { key, top_left, top_right, bottom_left, bottom_right, index + 1 };
+    crop_memo_count++;
+    return index;
+}
+
+
+
+
+BDD_NODE *bdd_fill_rect(BDD_NODE *node, int w, int h, int row, int col, int height, int width,
+                        unsigned char value) {
+    if (height < 0 || width < 0) {
+        return NULL;
+    }
+    int row_min = row < 0 ? 0 : row;
+    int col_min = col < 0 ? 0 : col;
+    int row_max = row + height > h ? h : row + height;
+    int col_max = col + width > w ? w : col + width;
+    if (row_max <= row_min || col_max <= col_min) {
+        return node;
+    }
+    int level = bdd_min_level(w, h);
+    if (bdd_node_to_index(node) >= BDD_NUM_LEAVES && (node) -> level > level) {
+        level = (node) -> level;
+    }
+    int index = bdd_fill_rect_recurse(node, level, 0, 0, row_min, row_max, col_min, col_max, value);
+    if (index == -1) {
+        return NULL;
+    }
+    return index_to_bdd_node(index);
+}
+
+BDD_NODE *bdd_set_pixel(BDD_NODE *node, int w, int h, int row, int col, unsigned char value) {
+    return bdd_fill_rect(node, w, h, row, col, 1, 1, value);
+}
+
+int bdd_fill_rect_recurse(BDD_NODE *node, int level, int row, int col, int row_min, int row_max,
+                          int col_min, int col_max, unsigned char value) {
+    int row_end = row + LEVEL_ROWS(level);
+    int col_end = col + LEVEL_COLS(level);
+    if (row_end <= row_min || row >= row_max || col_end <= col_min || col >= col_max) { /* Untouched */
+        return bdd_node_to_index(node);
+    }
+    if (row >= row_min && row_end <= row_max && col >= col_min && col_end <= col_max) { /* Painted over */
+        return value;
+    }
+    int left = bdd_fill_rect_recurse(LEFT(node, level), level - 1, row, col,
+                                     row_min, row_max, col_min, col_max, value);
+    int right;
+    if (level % 2 == 0) {
+        right = bdd_fill_rect_recurse(RIGHT(node, level), level - 1, row + LEVEL_ROWS(level - 1), col,
+                                      row_min, row_max, col_min, col_max, value);
+    } else {
+        right = bdd_fill_rect_recurse(RIGHT(node, level), level - 1, row, col + LEVEL_COLS(level - 1),
+                                      row_min, row_max, col_min, col_max, value);
+    }
+    if (left == -1 || right == -1) {
+        return -1;
+    }
+    return bdd_lookup(level, left, right);
+}
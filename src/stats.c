@@ -0,0 +1,143 @@
+#define _GNU_SOURCE  /* For fopencookie */
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "bdd.h"
+#include "bdd2.h"
+#include "stats.h"
+
+int stats_enabled = 0;
+BIRP_STATS birp_stats;
+
+static int current_phase = STATS_PHASE_OTHER;
+static double phase_start;
+
+static double stats_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int stats_enable() {
+    double *phases = calloc(STATS_NUM_PHASES, sizeof(double));
+    long long *histogram = calloc(STATS_PROBE_BUCKETS, sizeof(long long));
+    if (phases == NULL || histogram == NULL) {
+        free(phases);
+        free(histogram);
+        return -1;
+    }
+    BIRP_STATS empty = {0};
+    birp_stats = empty;
+    birp_stats.phase_seconds = phases;
+    birp_stats.probe_histogram = histogram;
+    current_phase = STATS_PHASE_OTHER;
+    phase_start = stats_now();
+    stats_enabled = 1;
+    return 0;
+}
+
+int stats_phase(int phase) {
+    int previous = current_phase;
+    if (!stats_enabled) {
+        return previous;
+    }
+    double now = stats_now();
+    *(birp_stats.phase_seconds + current_phase) += now - phase_start;
+    phase_start = now;
+    current_phase = phase;
+    return previous;
+}
+
+void stats_record_probe(long long probes) {
+    int bucket = 0;
+    while (probes > 0 && bucket < STATS_PROBE_BUCKETS - 1) {
+        probes >>= 1;
+        bucket++;
+    }
+    __atomic_fetch_add(birp_stats.probe_histogram + bucket, 1, __ATOMIC_RELAXED); /* Builds may be parallel */
+}
+
+static ssize_t counting_read(void *cookie, char *buf, size_t size) {
+    size_t count = fread(buf, 1, size, (FILE *) cookie);
+    birp_stats.bytes_read += count;
+    return count;
+}
+
+static ssize_t counting_write(void *cookie, const char *buf, size_t size) {
+    size_t count = fwrite(buf, 1, size, (FILE *) cookie);
+    birp_stats.bytes_written += count;
+    if (count < size) {
+        return -1;
+    }
+    return count;
+}
+
+static int counting_close(void *cookie) {
+    return fflush((FILE *) cookie);
+}
+
+FILE *stats_counting_stream(FILE *stream, char *mode) {
+    if (!stats_enabled) {
+        return stream;
+    }
+    cookie_io_functions_t functions = {0};
+    if (*mode == 'r') {
+        functions.read = counting_read;
+    } else {
+        functions.write = counting_write;
+    }
+    functions.close = counting_close;
+    FILE *counted = fopencookie(stream, mode, functions);
+    if (counted == NULL) {
+        return stream;
+    }
+    return counted;
+}
+
+void stats_report(FILE *out) {
+    if (!stats_enabled) {
+        return;
+    }
+    stats_phase(current_phase); /* Charge the time since the last switch */
+    char *names = "other\0read\0build\0transform\0decode\0serialize\0write";
+    double total = 0.0;
+    fprintf(out, "stats: phase times (s):");
+    for (int i = 0; i < STATS_NUM_PHASES; i++) {
+        double seconds = *(birp_stats.phase_seconds + i);
+        fprintf(out, " %s %.6f", names, seconds);
+        total += seconds;
+        while (*names != '\0') { /* Advance to the next name */
+            names++;
+        }
+        names++;
+    }
+    fprintf(out, ", total %.6f\n", total);
+    long long lookups = birp_stats.nodes_created + birp_stats.nodes_reused + birp_stats.nodes_collapsed;
+    fprintf(out, "stats: bdd_lookup calls %lld: created %lld, reused %lld, collapsed %lld\n",
+            lookups, birp_stats.nodes_created, birp_stats.nodes_reused, birp_stats.nodes_collapsed);
+    int peak = birp_stats.peak_node_index > current_bdd_node_index ?
+        birp_stats.peak_node_index : current_bdd_node_index;
+    fprintf(out, "stats: peak node index %d of %d (%.1f%%)\n", peak, BDD_NODES_MAX,
+            100.0 * peak / BDD_NODES_MAX);
+    fprintf(out, "stats: memory: node store %zu KB committed, unique table %zu KB, index map %zu KB\n",
+            bdd_nodes_committed * sizeof(BDD_NODE) / 1024, bdd_hash_size * sizeof(unsigned int) / 1024,
+            bdd_index_map_size * sizeof(int) / 1024);
+    fprintf(out, "stats: unique-table slots probed %lld, nodes examined %lld\n",
+            birp_stats.slots_probed, birp_stats.nodes_examined);
+    fprintf(out, "stats: unique-table probe lengths:");
+    for (int i = 0; i < STATS_PROBE_BUCKETS; i++) {
+        long long count = *(birp_stats.probe_histogram + i);
+        if (count == 0) {
+            continue;
+        }
+        if (i <= 1) {
+            fprintf(out, " [%d] %lld", i, count);
+        } else {
+            fprintf(out, " [%d-%d] %lld", 1 << (i - 1), (1 << i) - 1, count);
+        }
+    }
+    fprintf(out, "\n");
+    fprintf(out, "stats: memo hits %lld of %lld lookups\n", birp_stats.memo_hits, birp_stats.memo_lookups);
+    fprintf(out, "stats: bytes read %lld, written %lld\n", birp_stats.bytes_read, birp_stats.bytes_written);
+}
@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bdd.h"
+#include "bdd2.h"
+#include "trace.h"
+
+int trace_enabled = 0;
+
+static TRACE_EVENT *trace_ring = NULL;
+static long long trace_count = 0;  /* Events recorded, including overwritten ones */
+static double trace_start;
+
+static double trace_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+}
+
+int trace_enable() {
+    trace_ring = malloc(TRACE_RING_SIZE * sizeof(TRACE_EVENT));
+    if (trace_ring == NULL) {
+        return -1;
+    }
+    trace_count = 0;
+    trace_start = trace_now();
+    trace_enabled = 1;
+    return 0;
+}
+
+void trace_event(const char *name, char phase) {
+    TRACE_EVENT *event = trace_ring + (trace_count % TRACE_RING_SIZE);
+    (event) -> name = name;
+    (event) -> timestamp = trace_now() - trace_start;
+    (event) -> nodes = current_bdd_node_index;
+    (event) -> phase = phase;
+    trace_count++;
+}
+
+/*
+ * Mark which events in the ring buffer belong to a complete begin/end pair,
+ * by matching them with a stack.  Returns a malloc'd array of flags indexed
+ * by position in the ring, or NULL if memory cannot be allocated.
+ */
+static char *trace_match_events(long long first) {
+    char *keep = calloc(TRACE_RING_SIZE, sizeof(char));
+    int *stack = malloc(TRACE_RING_SIZE * sizeof(int));
+    if (keep == NULL || stack == NULL) {
+        free(keep);
+        free(stack);
+        return NULL;
+    }
+    int depth = 0;
+    for (long long i = first; i < trace_count; i++) {
+        int slot = i % TRACE_RING_SIZE;
+        if ((trace_ring + slot) -> phase == 'B') {
+            *(stack + depth) = slot;
+            depth++;
+        } else if (depth > 0) { /* An end with no begin had its begin overwritten */
+            depth--;
+            *(keep + *(stack + depth)) = 1;
+            *(keep + slot) = 1;
+        }
+    }
+    free(stack);
+    return keep;
+}
+
+int trace_write(char *path) {
+    long long first = trace_count > TRACE_RING_SIZE ? trace_count - TRACE_RING_SIZE : 0;
+    char *keep = trace_match_events(first);
+    if (keep == NULL) {
+        return -1;
+    }
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        free(keep);
+        return -1;
+    }
+    int pid = getpid();
+    int written = 0;
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (long long i = first; i < trace_count; i++) {
+        int slot = i % TRACE_RING_SIZE;
+        if (!*(keep + slot)) {
+            continue;
+        }
+        TRACE_EVENT *event = trace_ring + slot;
+        fprintf(out, "%s{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": 1, "
+                "\"args\": {\"%s\": %d}}", written ? ",\n" : "", (event) -> name, (event) -> phase,
+                (event) -> timestamp, pid, (event) -> phase == 'B' ? "nodes_begin" : "nodes_end",
+                (event) -> nodes);
+        written = 1;
+    }
+    fprintf(out, "\n]}\n");
+    free(keep);
+    if (fclose(out) == EOF) {
+        return -1;
+    }
+    return 0;
+}
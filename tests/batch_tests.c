@@ -0,0 +1,113 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "birp2.h"
+#include "batch.h"
+
+static int same_contents(char *path, FILE *expected) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return 0;
+    rewind(expected);
+    int a, b;
+    do {
+        a = fgetc(f);
+        b = fgetc(expected);
+    } while (a == b && a != EOF);
+    fclose(f);
+    return a == b;
+}
+
+Test(batch_tests_suite, batch_matches_single_conversion_test, .timeout=10) {
+    char dir[] = "/tmp/birp_batch_XXXXXX";
+    cr_assert(mkdtemp(dir) != NULL, "Cannot create temporary directory");
+    global_options = 0x21;
+    char *inputs[] = {"rsrc/M.pgm", "rsrc/checker.pgm", "rsrc/M.pgm"};
+    FILE *log = tmpfile();
+    int status = birp_batch(inputs, 3, dir, 1, log);
+    cr_assert_eq(status, 0, "birp_batch failed");
+
+    char line[512];
+    int lines = 0, second_m_nodes = -1;
+    rewind(log);
+    while (fgets(line, sizeof(line), log) != NULL) {
+        lines++;
+        if (lines == 3)
+            sscanf(strstr(line, "ms, ") + 4, "%d", &second_m_nodes);
+    }
+    fclose(log);
+    cr_assert_eq(lines, 4, "Expected a line per file and a summary, got %d lines", lines);
+    cr_assert_eq(second_m_nodes, 0, "Repeated image added %d nodes to the shared table", second_m_nodes);
+
+    char *names[] = {"M", "checker"};
+    for (int i = 0; i < 2; i++) {
+        char in_path[64], out_path[64];
+        snprintf(in_path, sizeof(in_path), "rsrc/%s.pgm", names[i]);
+        snprintf(out_path, sizeof(out_path), "%s/%s.birp", dir, names[i]);
+        FILE *in = fopen(in_path, "r");
+        FILE *expected = tmpfile();
+        bdd_reset_nodes();
+        cr_assert_eq(pgm_to_birp(in, expected), 0, "pgm_to_birp failed");
+        fclose(in);
+        cr_assert(same_contents(out_path, expected), "%s differs from converting it alone", out_path);
+        fclose(expected);
+        remove(out_path);
+    }
+    remove(dir);
+}
+
+Test(batch_tests_suite, parallel_batch_matches_sequential_test, .timeout=10) {
+    char dir1[] = "/tmp/birp_batch_XXXXXX", dir4[] = "/tmp/birp_batch_XXXXXX";
+    cr_assert(mkdtemp(dir1) != NULL && mkdtemp(dir4) != NULL, "Cannot create temporary directories");
+    global_options = 0x21;
+    char *inputs[] = {"rsrc"};
+    FILE *log1 = tmpfile(), *log4 = tmpfile();
+    cr_assert_eq(birp_batch(inputs, 1, dir1, 1, log1), 0, "Sequential birp_batch failed");
+    cr_assert_eq(birp_batch(inputs, 1, dir4, 4, log4), 0, "Parallel birp_batch failed");
+
+    char line1[512], line4[512];
+    rewind(log1);
+    rewind(log4);
+    int files = 0;
+    while (fgets(line1, sizeof(line1), log1) != NULL && fgets(line4, sizeof(line4), log4) != NULL) {
+        if (strstr(line1, " -> ") == NULL)
+            break;
+        char *in1 = line1 + 7, *in4 = line4 + 7;  /* After "batch: " */
+        *strstr(in1, " -> ") = '\0';
+        *strstr(in4, " -> ") = '\0';
+        cr_assert_str_eq(in1, in4, "Log out of order: %s and %s", in1, in4);
+        files++;
+    }
+    fclose(log1);
+    fclose(log4);
+    cr_assert_eq(files, 4, "Expected 4 files in rsrc, got %d", files);
+    char *names[] = {"M", "checker", "cour25", "stone"};
+    for (int i = 0; i < 4; i++) {
+        char path1[64], path4[64];
+        snprintf(path1, sizeof(path1), "%s/%s.birp", dir1, names[i]);
+        snprintf(path4, sizeof(path4), "%s/%s.birp", dir4, names[i]);
+        FILE *expected = fopen(path1, "r");
+        cr_assert(same_contents(path4, expected), "%s differs from sequential output", path4);
+        fclose(expected);
+        remove(path1);
+        remove(path4);
+    }
+    remove(dir1);
+    remove(dir4);
+}
+
+Test(batch_tests_suite, batch_requires_inputs_test, .timeout=5) {
+    char *args[] = {"bin/birp", "-d", "/tmp/out"};
+    cr_assert_eq(validargs(3, args), -1, "-d without input files was accepted");
+    char *args2[] = {"bin/birp", "-i", "pgm", "rsrc/M.pgm"};
+    cr_assert_eq(validargs(4, args2), -1, "Input files without -d were accepted");
+    char *args3[] = {"bin/birp", "-n", "-d", "/tmp/out", "a.birp", "b.birp"};
+    cr_assert_eq(validargs(6, args3), 0, "Valid batch arguments were rejected");
+    cr_assert_eq(batch_input_count, 2, "Expected 2 inputs, got %d", batch_input_count);
+    cr_assert(global_options & BATCH_OPTION, "BATCH_OPTION not set");
+}
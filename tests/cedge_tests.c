@@ -0,0 +1,118 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "image.h"
+#include "lut.h"
+#include "cedge.h"
+
+/* A bilevel image whose right half is the negative of its left half. */
+static unsigned char *make_bilevel(int w, int h) {
+    unsigned char *raster = malloc(w * h);
+    unsigned int seed = 42;
+    for (int r = 0; r < h; r++) {
+        for (int c = 0; c < w / 2; c++) {
+            seed = seed * 1103515245 + 12345;
+            unsigned char value = (r / 4 + c / 2) % 3 == 0 || (seed >> 16) % 7 == 0 ? 255 : 0;
+            raster[r * w + c] = value;
+            raster[r * w + w / 2 + c] = 255 - value;
+        }
+    }
+    return raster;
+}
+
+static BDD_NODE *read_thresholded(const char *path, int *wp, int *hp) {
+    FILE *in = fopen(path, "r");
+    cr_assert_not_null(in, "Could not open %s", path);
+    BDD_NODE *root = img_read_birp(in, wp, hp);
+    fclose(in);
+    cr_assert_not_null(root, "Could not read %s", path);
+    unsigned char lut[BDD_LUT_SIZE];
+    lut_identity(lut);
+    lut_threshold(lut, 128);
+    return bdd_map_lut(root, lut);
+}
+
+Test(cedge_tests_suite, round_trip_test, .timeout=5) {
+    int w = 64, h = 32;
+    unsigned char *raster = make_bilevel(w, h);
+    unsigned char *decoded = malloc(w * h);
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    int edge = bdd_cedge_from_bdd(root);
+    cr_assert_neq(edge, -1, "bdd_cedge_from_bdd failed");
+    cr_assert_eq(bdd_cedge_to_bdd(edge), root, "Converting back does not give the same node");
+    cr_assert_eq(bdd_cedge_from_bdd(root), edge, "Converting twice gives different edges");
+    cr_assert(bdd_cedge_count_nodes(edge) < bdd_count_nodes(root, NULL),
+              "Complemented edges did not share the negated half: %d nodes, %d before",
+              bdd_cedge_count_nodes(edge), bdd_count_nodes(root, NULL));
+    bdd_to_raster(bdd_cedge_to_bdd(edge), w, h, decoded);
+    cr_assert(memcmp(decoded, raster, w * h) == 0, "Decoded image differs");
+    free(raster);
+    free(decoded);
+}
+
+Test(cedge_tests_suite, deepest_level_test, .timeout=5) {
+    int w = 4, h = 4;
+    unsigned char *raster = malloc(w * h);
+    for (int i = 0; i < w * h; i++)
+        raster[i] = i % 5 == 0 ? 255 : 0; /* The diagonal, so that the root is at level 4 */
+    bdd_reset_nodes();
+    BDD_NODE *small = bdd_from_raster(w, h, raster);
+    BDD_NODE *root = bdd_zoom(small, small->level, (BDD_LEVELS_MAX - small->level) / 2);
+    cr_assert(root != NULL && root->level == BDD_LEVELS_MAX, "Could not zoom to level %d", BDD_LEVELS_MAX);
+    int edge = bdd_cedge_from_bdd(root);
+    cr_assert_neq(edge, -1, "bdd_cedge_from_bdd failed");
+    cr_assert_eq(bdd_cedge_to_bdd(edge), root, "Level %d image does not round trip", BDD_LEVELS_MAX);
+    int nodes = current_bdd_node_index;
+    cr_assert_eq(bdd_cedge_from_bdd(root), edge, "Converting again gave another edge");
+    cr_assert_eq(bdd_cedge_to_bdd(edge), root, "Converting back again gave another node");
+    cr_assert_eq(current_bdd_node_index, nodes, "Repeated conversions added %d nodes", current_bdd_node_index - nodes);
+    free(raster);
+}
+
+Test(cedge_tests_suite, negation_test, .timeout=5) {
+    int w = 64, h = 32;
+    unsigned char *raster = make_bilevel(w, h);
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    int edge = bdd_cedge_from_bdd(root);
+    int nodes = current_bdd_node_index;
+    int negative = bdd_cedge_not(edge);
+    cr_assert_eq(current_bdd_node_index, nodes, "Negation created nodes");
+    cr_assert_eq(bdd_cedge_not(negative), edge, "Negating twice is not the identity");
+    cr_assert_eq(bdd_cedge_count_nodes(negative), bdd_cedge_count_nodes(edge),
+                 "An image and its negative have different nodes");
+    unsigned char lut[BDD_LUT_SIZE];
+    lut_identity(lut);
+    lut_complement(lut);
+    cr_assert_eq(bdd_cedge_to_bdd(negative), bdd_map_lut(root, lut), "Negation differs from -n");
+    cr_assert_eq(bdd_cedge_not(BDD_CEDGE_BLACK), BDD_CEDGE_WHITE, "The negative of black is not white");
+    free(raster);
+}
+
+Test(cedge_tests_suite, not_bilevel_test, .timeout=5) {
+    unsigned char raster[16] = { 0, 255, 0, 255, 0, 255, 0, 255, 0, 255, 0, 128, 0, 255, 0, 255 };
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(4, 4, raster);
+    cr_assert_eq(bdd_cedge_from_bdd(root), -1, "An image with a gray pixel was converted");
+}
+
+Test(cedge_tests_suite, node_counts_test, .timeout=5) {
+    const char *paths[] = { "rsrc/checker.birp", "rsrc/M.birp" };
+    for (int i = 0; i < 2; i++) {
+        bdd_reset_nodes();
+        int w, h;
+        BDD_NODE *root = read_thresholded(paths[i], &w, &h);
+        int edge = bdd_cedge_from_bdd(root);
+        cr_assert_neq(edge, -1, "Could not convert %s", paths[i]);
+        int nodes = bdd_count_nodes(root, NULL);
+        int cedge_nodes = bdd_cedge_count_nodes(edge);
+        cr_assert(cedge_nodes < nodes, "%s did not shrink: %d nodes, %d before", paths[i], cedge_nodes, nodes);
+        cr_assert_eq(bdd_cedge_to_bdd(edge), root, "%s does not convert back", paths[i]);
+    }
+}
@@ -0,0 +1,235 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "birp2.h"
+
+static void fill(unsigned char *raster, int w, int h, int seed) {
+    for (int i = 0; i < w * h; i++)
+        raster[i] = (unsigned char) ((i % w) * seed + (i / w) * (seed + 3));
+}
+
+Test(context_tests_suite, contexts_are_independent_test, .timeout=5) {
+    int w = 30, h = 20;
+    unsigned char a[30 * 20], b[30 * 20], out[30 * 20];
+    fill(a, w, h, 1);
+    fill(b, w, h, 7);
+    BIRP_CONTEXT *first = birp_context_create();
+    BIRP_CONTEXT *second = birp_context_create();
+    cr_assert(first != NULL && second != NULL, "birp_context_create failed");
+
+    BIRP_CONTEXT *previous = birp_context_use(first);
+    BDD_NODE *root_a = bdd_from_raster(w, h, a);
+    int nodes_a = current_bdd_node_index;
+    birp_context_use(second);
+    cr_assert_eq(current_bdd_node_index, BDD_NUM_LEAVES, "New context is not empty");
+    BDD_NODE *root_b = bdd_from_raster(w, h, b);
+    birp_context_use(first);
+    cr_assert_eq(current_bdd_node_index, nodes_a, "Building in another context changed this one");
+    bdd_to_raster(root_a, w, h, out);
+    cr_assert(memcmp(out, a, sizeof(a)) == 0, "Image in first context was corrupted");
+    birp_context_use(second);
+    bdd_to_raster(root_b, w, h, out);
+    cr_assert(memcmp(out, b, sizeof(b)) == 0, "Image in second context was corrupted");
+
+    birp_context_use(previous);
+    birp_context_destroy(first);
+    birp_context_destroy(second);
+}
+
+struct job {
+    int seed;
+    int ok;
+};
+
+static void *convert(void *arg) {
+    struct job *job = arg;
+    int w = 200, h = 150;
+    unsigned char *in = malloc(w * h), *out = malloc(w * h);
+    fill(in, w, h, job->seed);
+    BIRP_CONTEXT *ctx = birp_context_create();
+    birp_context_use(ctx);
+    job->ok = 1;
+    for (int rep = 0; rep < 20 && job->ok; rep++) {
+        BDD_NODE *root = bdd_from_raster(w, h, in);
+        BDD_NODE *negated = bdd_map(root, complement);
+        bdd_to_raster(negated, w, h, out);
+        for (int i = 0; i < w * h; i++)
+            if (out[i] != 255 - in[i])
+                job->ok = 0;
+    }
+    birp_context_use(NULL);
+    birp_context_destroy(ctx);
+    free(in);
+    free(out);
+    return NULL;
+}
+
+Test(context_tests_suite, concurrent_contexts_test, .timeout=10) {
+    pthread_t threads[4];
+    struct job jobs[4];
+    for (int i = 0; i < 4; i++) {
+        jobs[i].seed = 2 * i + 1;
+        pthread_create(&threads[i], NULL, convert, &jobs[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        cr_assert(jobs[i].ok, "Thread %d produced a wrong image", i);
+    }
+}
+
+Test(context_tests_suite, parallel_build_matches_sequential_test, .timeout=20) {
+    int w = 1000, h = 1024;  /* Level 20, so built in parallel; not a power of 2 wide */
+    unsigned char *in = malloc(w * h), *out = malloc(w * h);
+    unsigned int seed = 42;
+    for (int i = 0; i < w * h; i++) {
+        seed = seed * 1103515245 + 12345;
+        in[i] = ((i / w) / 64 + (i % w) / 64) % 3 == 0 ? (unsigned char) (seed >> 16) : (unsigned char) (i / w);
+    }
+    BIRP_CONTEXT *ctx = birp_context_create();
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    pool_set_threads(1);
+    BDD_NODE *root = bdd_from_raster(w, h, in);
+    cr_assert(root != NULL, "Sequential bdd_from_raster failed");
+    int sequential_nodes = current_bdd_node_index;
+
+    bdd_reset_nodes();
+    pool_set_threads(4);
+    root = bdd_from_raster(w, h, in);
+    cr_assert(root != NULL, "Parallel bdd_from_raster failed");
+    cr_assert_eq(current_bdd_node_index, sequential_nodes, "Parallel build made %d nodes instead of %d",
+                 current_bdd_node_index, sequential_nodes);
+    bdd_to_raster(root, w, h, out);
+    cr_assert(memcmp(in, out, w * h) == 0, "Parallel build decodes to a different image");
+    pool_set_threads(1);
+    birp_context_use(previous);
+    birp_context_destroy(ctx);
+    free(in);
+    free(out);
+}
+
+Test(context_tests_suite, parallel_decode_matches_sequential_test, .timeout=20) {
+    int w = 1000, h = 700;  /* Level 20, with a partial last row and column of tasks */
+    unsigned char *in = malloc(w * h), *out = malloc(w * h);
+    unsigned int seed = 7;
+    for (int i = 0; i < w * h; i++) {
+        seed = seed * 1103515245 + 12345;
+        in[i] = ((i / w) / 100 + (i % w) / 100) % 2 == 0 ? (unsigned char) (seed >> 16) : (unsigned char) (i % w);
+    }
+    BIRP_CONTEXT *ctx = birp_context_create();
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    pool_set_threads(1);
+    BDD_NODE *root = bdd_from_raster(w, h, in);
+    cr_assert(root != NULL, "bdd_from_raster failed");
+    pool_set_threads(4);
+    memset(out, 0, w * h);
+    bdd_to_raster(root, w, h, out);
+    cr_assert(memcmp(in, out, w * h) == 0, "Parallel decode differs from the original image");
+    pool_set_threads(1);
+    birp_context_use(previous);
+    birp_context_destroy(ctx);
+    free(in);
+    free(out);
+}
+
+Test(context_tests_suite, parallel_serialize_matches_sequential_test, .timeout=20) {
+    int w = 1024, h = 1000;
+    unsigned char *in = malloc(w * h);
+    for (int i = 0; i < w * h; i++) {  /* Tiles repeated across task boundaries, so parts share subtrees */
+        int r = i / w, c = i % w;
+        in[i] = (r / 200 + c / 300) % 2 == 0 ? (unsigned char) ((r % 40) * (c % 24)) : (unsigned char) (r + c);
+    }
+    BIRP_CONTEXT *ctx = birp_context_create();
+    BIRP_CONTEXT *previous = birp_context_use(ctx);
+    pool_set_threads(1);
+    BDD_NODE *root = bdd_from_raster(w, h, in);
+    cr_assert(root != NULL, "bdd_from_raster failed");
+    char *expected = NULL, *actual = NULL;
+    size_t expected_size = 0, actual_size = 0;
+    FILE *out = open_memstream(&expected, &expected_size);
+    cr_assert_eq(bdd_serialize(root, out), 0, "Sequential bdd_serialize failed");
+    fclose(out);
+    pool_set_threads(4);
+    out = open_memstream(&actual, &actual_size);
+    cr_assert_eq(bdd_serialize(root, out), 0, "Parallel bdd_serialize failed");
+    fclose(out);
+    cr_assert_eq(actual_size, expected_size, "Parallel output has %zu bytes instead of %zu", actual_size, expected_size);
+    cr_assert(memcmp(actual, expected, expected_size) == 0, "Parallel output differs");
+    pool_set_threads(1);
+    birp_context_use(previous);
+    birp_context_destroy(ctx);
+    free(expected);
+    free(actual);
+    free(in);
+}
+
+struct serialize_job {
+    int seed;
+    char *expected;
+    size_t expected_size;
+    int ok;
+};
+
+static void fill_tiled(unsigned char *raster, int w, int h, int seed) {
+    for (int i = 0; i < w * h; i++) {
+        int r = i / w, c = i % w;
+        raster[i] = (r / 128 + c / 96) % 2 == 0 ? (unsigned char) ((r % (20 + seed)) * (c % 24)) : (unsigned char) (r + c * seed);
+    }
+}
+
+static char *serialize_image(int w, int h, int seed, size_t *sizep) {
+    unsigned char *in = malloc(w * h);
+    fill_tiled(in, w, h, seed);
+    BDD_NODE *root = bdd_from_raster(w, h, in);
+    char *buf = NULL;
+    FILE *out = open_memstream(&buf, sizep);
+    if (root == NULL || bdd_serialize(root, out) != 0) {
+        *sizep = 0;
+    }
+    fclose(out);
+    free(in);
+    return buf;
+}
+
+static void *serialize_many(void *arg) {
+    struct serialize_job *job = arg;
+    BIRP_CONTEXT *ctx = birp_context_create();
+    birp_context_use(ctx);
+    job->ok = 1;
+    for (int rep = 0; rep < 5 && job->ok; rep++) {
+        bdd_reset_nodes();
+        size_t size;
+        char *actual = serialize_image(1024, 1024, job->seed, &size);
+        job->ok = size == job->expected_size && memcmp(actual, job->expected, size) == 0;
+        free(actual);
+    }
+    birp_context_use(NULL);
+    birp_context_destroy(ctx);
+    return NULL;
+}
+
+Test(context_tests_suite, concurrent_parallel_serialize_test, .timeout=30) {
+    /* Callers outside the pool run each other's tasks while they wait on it */
+    struct serialize_job jobs[3];
+    pool_set_threads(1);
+    for (int i = 0; i < 3; i++) {
+        jobs[i].seed = i + 1;
+        bdd_reset_nodes();
+        jobs[i].expected = serialize_image(1024, 1024, jobs[i].seed, &jobs[i].expected_size);
+        cr_assert_neq(jobs[i].expected_size, 0, "Sequential serialization failed");
+    }
+    bdd_reset_nodes();
+    pool_set_threads(4);
+    pthread_t threads[3];
+    for (int i = 0; i < 3; i++)
+        pthread_create(&threads[i], NULL, serialize_many, &jobs[i]);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(threads[i], NULL);
+        cr_assert(jobs[i].ok, "Thread %d serialized a different image", i);
+        free(jobs[i].expected);
+    }
+    pool_set_threads(1);
+}
@@ -0,0 +1,189 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "birp2.h"
+#include "dihedral.h"
+#include "region.h"
+#include "test_images.h"
+
+/* The pixel that a transform places at (r, c) of a w x h image, by definition. */
+static unsigned char reference_pixel(unsigned char *raster, int w, int h, int transform, int r, int c) {
+    int row = (transform & BDD_DIHEDRAL_TRANSPOSE) ? c : r;
+    int col = (transform & BDD_DIHEDRAL_TRANSPOSE) ? r : c;
+    if (transform & BDD_DIHEDRAL_FLIP_ROWS)
+        row = h - 1 - row;
+    if (transform & BDD_DIHEDRAL_FLIP_COLS)
+        col = w - 1 - col;
+    return raster[row * w + col];
+}
+
+Test(dihedral_tests_suite, dihedral_matches_reference_test, .timeout=5) {
+    int w = 45, h = 27;
+    unsigned char *raster = make_test_image(w, h, test_noise, test_steps, h / 2);
+    unsigned char *decoded = malloc(w * h);
+    for (int transform = 0; transform < 8; transform++) {
+        bdd_reset_nodes();
+        BDD_NODE *root = bdd_from_raster(w, h, raster);
+        cr_assert_not_null(root, "bdd_from_raster returned NULL");
+        int tw = w, th = h;
+        BDD_NODE *result = dihedral_transformation(root, transform, &tw, &th);
+        cr_assert_not_null(result, "dihedral_transformation %d returned NULL", transform);
+        int transposed = (transform & BDD_DIHEDRAL_TRANSPOSE) != 0;
+        cr_assert(tw == (transposed ? h : w) && th == (transposed ? w : h),
+                  "Wrong size %d x %d for transform %d", tw, th, transform);
+        bdd_to_raster(result, tw, th, decoded);
+        for (int r = 0; r < th; r++) {
+            for (int c = 0; c < tw; c++) {
+                unsigned char exp = reference_pixel(raster, w, h, transform, r, c);
+                cr_assert_eq(decoded[r * tw + c], exp, "Transform %d differs at (%d, %d).  Got: %d | Expected: %d",
+                             transform, r, c, decoded[r * tw + c], exp);
+            }
+        }
+    }
+    free(raster);
+    free(decoded);
+}
+
+Test(dihedral_tests_suite, dihedral_large_periodic_test, .timeout=5) {
+    int w = 4095, h = 4093; /* Not powers of two, so every transform but the identity crops */
+    unsigned char *raster = malloc((size_t) w * h);
+    for (int i = 0; i < w * h; i++)
+        raster[i] = ((i / w) / 3 % 4) * 40 + ((i % w) / 5 % 3) * 20 + 1;
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    int probes[][2] = { { 0, 0 }, { 1, 2 }, { 2046, 2047 }, { 4092, 4092 }, { 17, 4000 } };
+    for (int transform = 1; transform < 8; transform++) {
+        int before = current_bdd_node_index;
+        int tw = w, th = h;
+        BDD_NODE *result = dihedral_transformation(root, transform, &tw, &th);
+        cr_assert_not_null(result, "dihedral_transformation %d returned NULL", transform);
+        cr_assert_lt(current_bdd_node_index - before, 5000, "Transform %d built %d nodes",
+                     transform, current_bdd_node_index - before);
+        for (int p = 0; p < 5; p++) {
+            int r = probes[p][0], c = probes[p][1];
+            long long got = bdd_region_sum(result, tw, th, r, c, 1, 1, NULL);
+            cr_assert_eq(got, reference_pixel(raster, w, h, transform, r, c), "Transform %d differs at (%d, %d)",
+                         transform, r, c);
+        }
+    }
+    free(raster);
+}
+
+Test(dihedral_tests_suite, dihedral_compose_test, .timeout=5) {
+    int w = 32, h = 32;
+    unsigned char *raster = make_test_image(w, h, test_noise, test_steps, h / 2);
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    for (int first = 0; first < 8; first++) {
+        BDD_NODE *once = bdd_dihedral(root, first);
+        for (int second = 0; second < 8; second++) {
+            BDD_NODE *twice = bdd_dihedral(once, second);
+            BDD_NODE *composed = bdd_dihedral(root, bdd_dihedral_compose(first, second));
+            cr_assert(twice != NULL && twice == composed, "Transform %d then %d is not their composition",
+                      first, second);
+        }
+    }
+    cr_assert_eq(bdd_dihedral_compose(BDD_DIHEDRAL_ROTATE_90, BDD_DIHEDRAL_ROTATE_90), BDD_DIHEDRAL_ROTATE_180,
+                 "Two quarter turns are not a half turn");
+    cr_assert_eq(bdd_dihedral_compose(BDD_DIHEDRAL_ROTATE_90, BDD_DIHEDRAL_ROTATE_270), BDD_DIHEDRAL_IDENTITY,
+                 "A quarter turn each way is not the identity");
+    free(raster);
+}
+
+Test(dihedral_tests_suite, rotate_is_quarter_turn_of_square_test, .timeout=5) {
+    int w = 20, h = 12, side = 32;
+    unsigned char *raster = make_test_image(w, h, test_noise, test_steps, h / 2);
+    unsigned char *decoded = malloc(side * side);
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    BDD_NODE *rotated = bdd_rotate(root, root->level);
+    cr_assert_not_null(rotated, "bdd_rotate returned NULL");
+    bdd_to_raster(rotated, side, side, decoded);
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++) {
+            int row = c, col = side - 1 - r; /* Counterclockwise within the enclosing square */
+            unsigned char exp = row < h && col < w ? raster[row * w + col] : 0;
+            cr_assert_eq(decoded[r * side + c], exp, "Rotation differs at (%d, %d)", r, c);
+        }
+    }
+    free(raster);
+    free(decoded);
+}
+
+Test(dihedral_tests_suite, dihedral_options_chain_test, .timeout=5) {
+    char *args[] = { "bin/birp", "--hflip", "--rotate90", "--vflip", NULL };
+    cr_assert_eq(validargs(4, args), 0, "validargs rejected a chain of symmetries");
+    int exp = bdd_dihedral_compose(bdd_dihedral_compose(BDD_DIHEDRAL_HFLIP, BDD_DIHEDRAL_ROTATE_90),
+                                   BDD_DIHEDRAL_VFLIP);
+    cr_assert_eq(global_options & 0xF00, 0x600, "Wrong transformation bits 0x%x", global_options);
+    cr_assert_eq((global_options >> 16) & 0xFF, exp, "Wrong transform 0x%x", global_options);
+    char *mixed[] = { "bin/birp", "--hflip", "-n", NULL };
+    cr_assert_eq(validargs(3, mixed), -1, "validargs accepted a symmetry with -n");
+    char *pgm[] = { "bin/birp", "-i", "pgm", "--transpose", NULL };
+    cr_assert_eq(validargs(4, pgm), -1, "validargs accepted a symmetry with pgm input");
+}
+
+Test(dihedral_tests_suite, dihedral_command_test, .timeout=5) {
+    int status = system("bin/birp --rotate180 < rsrc/M.birp | bin/birp --vflip --hflip > test_output/dihedral_M.birp");
+    cr_assert_eq(status, 0, "bin/birp failed");
+    status = system("cmp -s test_output/dihedral_M.birp rsrc/M.birp");
+    cr_assert_eq(status, 0, "Two half turns do not restore rsrc/M.birp");
+}
+
+Test(dihedral_tests_suite, view_matches_materialized_test, .timeout=5) {
+    int w = 45, h = 27, side = 64;
+    unsigned char *raster = make_test_image(w, h, test_noise, test_steps, h / 2);
+    unsigned char *viewed = malloc(side * side);
+    unsigned char *decoded = malloc(side * side);
+    for (int transform = 0; transform < 8; transform++) {
+        bdd_reset_nodes();
+        BDD_NODE *root = bdd_from_raster(w, h, raster);
+        int tw = w, th = h;
+        BDD_NODE *result = dihedral_transformation(root, transform, &tw, &th);
+        cr_assert_not_null(result, "dihedral_transformation %d returned NULL", transform);
+        bdd_to_raster(result, side, side, decoded);
+        int vw = w, vh = h;
+        int nodes = current_bdd_node_index;
+        bdd_view_set(root, transform, &vw, &vh);
+        cr_assert(vw == tw && vh == th, "Wrong view size %d x %d for transform %d", vw, vh, transform);
+        memset(viewed, 0xAA, side * side);
+        bdd_to_raster(root, side, side, viewed);
+        cr_assert_eq(current_bdd_node_index, nodes, "Decoding a view created nodes");
+        cr_assert(memcmp(viewed, decoded, side * side) == 0, "View of transform %d differs", transform);
+        for (int r = 0; r < side; r += 3) {
+            for (int c = 0; c < side; c += 5) {
+                cr_assert_eq(bdd_apply(root, r, c), decoded[r * side + c],
+                             "bdd_apply through view %d differs at (%d, %d)", transform, r, c);
+            }
+        }
+        memset(viewed, 0xAA, side * side);
+        bdd_view_to_raster(tw, th, viewed, 5, 11);
+        cr_assert(viewed[0] == 0xAA && viewed[11 * tw] == 0xAA, "Decoded rows outside the band");
+        for (int r = 5; r < 11; r++) {
+            for (int c = 0; c < tw; c++) {
+                cr_assert_eq(viewed[r * tw + c], reference_pixel(raster, w, h, transform, r, c),
+                             "Band of view %d differs at (%d, %d)", transform, r, c);
+            }
+        }
+        bdd_view_clear();
+        cr_assert(!bdd_view_active(root), "View still active after bdd_view_clear");
+    }
+    free(raster);
+    free(viewed);
+    free(decoded);
+}
+
+Test(dihedral_tests_suite, view_command_test, .timeout=5) {
+    int status = system("bin/birp -o pgm --rotate90 --hflip < rsrc/cour25.birp > test_output/view_cour25.pgm"
+                        " && bin/birp --rotate90 --hflip < rsrc/cour25.birp | bin/birp -o pgm > test_output/materialized_cour25.pgm"
+                        " && cmp -s test_output/view_cour25.pgm test_output/materialized_cour25.pgm");
+    cr_assert_eq(status, 0, "Decoding through a view differs from decoding the transformed BDD");
+    status = system("bin/birp -o ascii --vflip < rsrc/M.birp > test_output/view_M.txt"
+                    " && bin/birp --vflip < rsrc/M.birp | bin/birp -o ascii > test_output/materialized_M.txt"
+                    " && cmp -s test_output/view_M.txt test_output/materialized_M.txt");
+    cr_assert_eq(status, 0, "Rendering through a view differs from rendering the transformed BDD");
+}
@@ -0,0 +1,70 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libbirp.h"
+
+Test(libbirp_tests_suite, pgm_round_trip_test, .timeout=5) {
+    FILE *in = fopen("rsrc/M.pgm", "r");
+    cr_assert(in != NULL, "Cannot open rsrc/M.pgm");
+    int w, h;
+    cr_assert_eq(birp_pgm_read_header(in, &w, &h), 0, "birp_pgm_read_header failed");
+    unsigned char *raster = malloc(w * h);
+    unsigned char *decoded = malloc(w * h);
+    cr_assert_eq(birp_pgm_read_raster(in, w, h, raster), 0, "birp_pgm_read_raster failed");
+    fclose(in);
+
+    BIRP_CONTEXT *ctx = birp_context_create();
+    BIRP_IMAGE image;
+    cr_assert_eq(birp_image_from_raster(ctx, raster, w, h, &image), 0, "birp_image_from_raster failed");
+    cr_assert_eq(image.width, w, "Wrong width %d", image.width);
+
+    FILE *tmp = tmpfile();
+    cr_assert_eq(birp_image_write(ctx, &image, tmp), 0, "birp_image_write failed");
+    rewind(tmp);
+    birp_context_reset(ctx);
+    BIRP_IMAGE read;
+    cr_assert_eq(birp_image_read(ctx, tmp, &read), 0, "birp_image_read failed");
+    fclose(tmp);
+    cr_assert_eq(birp_image_to_raster(ctx, &read, decoded, w * h - 1), -1,
+                 "Accepted a raster that is too small");
+    cr_assert_eq(birp_image_to_raster(ctx, &read, decoded, w * h), 0, "birp_image_to_raster failed");
+    cr_assert(memcmp(raster, decoded, w * h) == 0, "Decoded image differs from the original");
+
+    birp_context_destroy(ctx);
+    free(raster);
+    free(decoded);
+}
+
+Test(libbirp_tests_suite, transforms_test, .timeout=5) {
+    int w = 6, h = 4;
+    unsigned char raster[6 * 4] = {0};
+    unsigned char out[8 * 8];
+    raster[1 * w + 2] = 200;
+    raster[2 * w + 3] = 100;
+    BIRP_CONTEXT *ctx = birp_context_create();
+    BIRP_IMAGE image, result;
+    birp_image_from_raster(ctx, raster, w, h, &image);
+
+    cr_assert_eq(birp_image_complement(ctx, &image, &result), 0, "birp_image_complement failed");
+    birp_image_to_raster(ctx, &result, out, sizeof(out));
+    cr_assert(out[0] == 255 && out[1 * w + 2] == 55, "Complement is wrong");
+
+    cr_assert_eq(birp_image_threshold(ctx, &image, 150, &result), 0, "birp_image_threshold failed");
+    birp_image_to_raster(ctx, &result, out, sizeof(out));
+    cr_assert(out[1 * w + 2] == 255 && out[2 * w + 3] == 0, "Threshold is wrong");
+    cr_assert_eq(birp_image_threshold(ctx, &image, 256, &result), -1, "Accepted threshold 256");
+
+    cr_assert_eq(birp_image_crop(ctx, &image, 0, &result), 0, "birp_image_crop failed");
+    cr_assert(result.width == 2 && result.height == 2, "Cropped to %dx%d", result.width, result.height);
+    birp_image_to_raster(ctx, &result, out, sizeof(out));
+    cr_assert(out[0] == 200 && out[3] == 100, "Crop is wrong");
+
+    cr_assert_eq(birp_image_zoom(ctx, &image, -1, &result), 0, "birp_image_zoom failed");
+    cr_assert(result.width == 3 && result.height == 2, "Zoomed to %dx%d", result.width, result.height);
+    cr_assert_eq(birp_image_zoom(ctx, &image, 40, &result), -1, "Accepted zoom factor 40");
+
+    birp_context_destroy(ctx);
+}
@@ -0,0 +1,38 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+
+#include "const.h"
+#include "lossy.h"
+
+static void fill_noisy_gradient(int w, int h) {
+    cr_assert_not_null(raster_reserve(w * h), "raster_reserve failed");
+    unsigned int seed = 12345;
+    for (int i = 0; i < w * h; i++) {
+        seed = seed * 1103515245 + 12345;
+        raster_data[i] = (unsigned char) ((i % w) * 2 + (seed >> 16) % 7);
+    }
+}
+
+Test(lossy_tests_suite, lossy_zero_tolerance_is_exact_test, .timeout=5) {
+    int w = 45, h = 33;
+    fill_noisy_gradient(w, h);
+    BDD_NODE *exact = bdd_from_raster(w, h, raster_data);
+    BDD_NODE *lossy = bdd_from_raster_lossy(w, h, raster_data, 0, LOSSY_METRIC_MAX);
+    cr_assert_eq(lossy, exact, "Zero tolerance did not reproduce the exact BDD");
+}
+
+Test(lossy_tests_suite, lossy_max_error_bound_test, .timeout=5) {
+    int w = 64, h = 40, tolerance = 5;
+    fill_noisy_gradient(w, h);
+    BDD_NODE *exact = bdd_from_raster(w, h, raster_data);
+    BDD_NODE *lossy = bdd_from_raster_lossy(w, h, raster_data, tolerance, LOSSY_METRIC_MAX);
+    cr_assert_not_null(lossy, "bdd_from_raster_lossy returned NULL");
+    cr_assert_neq(lossy, exact, "Expected some subtrees to be merged");
+    static unsigned char decoded[64 * 40];
+    bdd_to_raster(lossy, w, h, decoded);
+    for (int i = 0; i < w * h; i++) {
+        int diff = decoded[i] - raster_data[i];
+        cr_assert(diff <= tolerance && diff >= -tolerance,
+                  "Pixel %d off by %d (tolerance %d)", i, diff, tolerance);
+    }
+}
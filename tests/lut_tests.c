@@ -0,0 +1,139 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "birp2.h"
+#include "lut.h"
+#include "test_images.h"
+
+Test(lut_tests_suite, lut_builtins_test, .timeout=5) {
+    unsigned char lut[BDD_LUT_SIZE];
+    lut_identity(lut);
+    cr_assert(lut_is_identity(lut), "lut_identity is not the identity");
+    lut_gamma(lut, 1.0);
+    cr_assert(lut_is_identity(lut), "A gamma of 1 is not the identity");
+    lut_gamma(lut, 2.0);
+    cr_assert(lut[0] == 0 && lut[255] == 255 && lut[128] == 64, "Wrong gamma: %d", lut[128]);
+    lut_identity(lut);
+    lut_levels(lut, 50, 100);
+    cr_assert(lut[50] == 0 && lut[75] == 128 && lut[100] == 255 && lut[20] == 0 && lut[200] == 255,
+              "Wrong levels");
+    lut_identity(lut);
+    lut_posterize(lut, 2);
+    cr_assert(lut[127] == 0 && lut[128] == 255, "Wrong posterize");
+    lut_identity(lut);
+    lut_posterize(lut, 256);
+    cr_assert(lut_is_identity(lut), "Posterizing to 256 levels is not the identity");
+    lut_invert_range(lut, 10, 20);
+    cr_assert(lut[9] == 9 && lut[10] == 20 && lut[15] == 15 && lut[20] == 10 && lut[21] == 21,
+              "Wrong invert");
+    lut_identity(lut);
+    lut_clamp(lut, 16, 235);
+    cr_assert(lut[0] == 16 && lut[100] == 100 && lut[255] == 235, "Wrong clamp");
+    lut_identity(lut);
+    lut_complement(lut);
+    lut_complement(lut);
+    cr_assert(lut_is_identity(lut), "Complementing twice is not the identity");
+    lut_threshold(lut, 128);
+    cr_assert(lut[127] == 0 && lut[128] == 255, "Wrong threshold");
+}
+
+Test(lut_tests_suite, fused_matches_sequential_test, .timeout=5) {
+    int w = 45, h = 27;
+    unsigned char *raster = make_test_image(w, h, test_noise, test_steps, h / 2);
+    unsigned char *decoded = malloc(w * h);
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    unsigned char gamma[BDD_LUT_SIZE], levels[BDD_LUT_SIZE], posterize[BDD_LUT_SIZE], fused[BDD_LUT_SIZE];
+    lut_identity(gamma);
+    lut_gamma(gamma, 0.45);
+    lut_identity(levels);
+    lut_levels(levels, 30, 220);
+    lut_identity(posterize);
+    lut_posterize(posterize, 5);
+    lut_identity(fused);
+    lut_gamma(fused, 0.45);
+    lut_levels(fused, 30, 220);
+    lut_posterize(fused, 5);
+    BDD_NODE *sequential = bdd_map_lut(bdd_map_lut(bdd_map_lut(root, gamma), levels), posterize);
+    BDD_NODE *once = bdd_map_lut(root, fused);
+    cr_assert(sequential != NULL && sequential == once, "The fused table differs from its parts in turn");
+    bdd_to_raster(once, w, h, decoded);
+    for (int i = 0; i < w * h; i++)
+        cr_assert_eq(decoded[i], fused[raster[i]], "Pixel %d differs", i);
+    unsigned char composed[BDD_LUT_SIZE];
+    memcpy(composed, gamma, sizeof(composed));
+    lut_compose(composed, levels);
+    lut_compose(composed, posterize);
+    cr_assert(memcmp(composed, fused, sizeof(fused)) == 0, "lut_compose differs from the fused table");
+    free(raster);
+    free(decoded);
+}
+
+Test(lut_tests_suite, identity_short_circuit_test, .timeout=5) {
+    int w = 32, h = 32;
+    unsigned char *raster = make_test_image(w, h, test_noise, test_steps, h / 2);
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    int nodes = current_bdd_node_index;
+    unsigned char lut[BDD_LUT_SIZE];
+    lut_identity(lut);
+    lut_invert_range(lut, 0, 255);
+    lut_complement(lut);
+    cr_assert_eq(bdd_map_lut(root, lut), root, "An identity table changed the root");
+    cr_assert_eq(current_bdd_node_index, nodes, "An identity table created nodes");
+    lut_identity(lut);
+    lut_threshold(lut, 256);
+    BDD_NODE *black = bdd_map_lut(root, lut);
+    cr_assert_eq(bdd_node_to_index(black), 0, "Thresholding above 255 is not black");
+    free(raster);
+}
+
+Test(lut_tests_suite, point_options_chain_test, .timeout=5) {
+    char *args[] = { "bin/birp", "--gamma", "2", "--clamp", "0", "200", "--invert", "0", "200", NULL };
+    cr_assert_eq(validargs(9, args), 0, "validargs rejected a chain of tone adjustments");
+    cr_assert_eq(global_options & 0xF00, 0x700, "Wrong transformation bits 0x%x", global_options);
+    cr_assert(point_lut[0] == 200 && point_lut[255] == 0 && point_lut[128] == 136,
+              "Wrong fused table: %d %d %d", point_lut[0], point_lut[255], point_lut[128]);
+    char *negate[] = { "bin/birp", "--gamma", "2", "-n", NULL };
+    cr_assert_eq(validargs(4, negate), 0, "validargs rejected a tone adjustment with -n");
+    cr_assert_eq(global_options & 0xF00, 0x700, "-n was not fused into the table: 0x%x", global_options);
+    cr_assert(point_lut[0] == 255 && point_lut[255] == 0 && point_lut[128] == 191,
+              "Wrong fused table: %d %d %d", point_lut[0], point_lut[255], point_lut[128]);
+    char *threshold[] = { "bin/birp", "-t", "128", "--clamp", "0", "200", NULL };
+    cr_assert_eq(validargs(6, threshold), 0, "validargs rejected -t with a tone adjustment");
+    cr_assert_eq(global_options & 0xFFFF0F00, 0x700, "-t was not fused into the table: 0x%x", global_options);
+    cr_assert(point_lut[127] == 0 && point_lut[128] == 200, "Wrong fused table: %d %d", point_lut[127], point_lut[128]);
+    char *plain[] = { "bin/birp", "-n", "-t", "100", NULL };
+    cr_assert_eq(validargs(4, plain), 0, "validargs rejected -n with -t");
+    cr_assert(point_lut[155] == 255 && point_lut[156] == 0, "Wrong fused table: %d %d", point_lut[155], point_lut[156]);
+    char *zoom[] = { "bin/birp", "-n", "-z", "2", NULL };
+    cr_assert_eq(validargs(4, zoom), -1, "validargs accepted -n with a zoom");
+    char *mixed[] = { "bin/birp", "--gamma", "2", "-r", NULL };
+    cr_assert_eq(validargs(4, mixed), -1, "validargs accepted a tone adjustment with -r");
+    char *dihedral[] = { "bin/birp", "--hflip", "--posterize", "4", NULL };
+    cr_assert_eq(validargs(4, dihedral), -1, "validargs accepted a tone adjustment with a symmetry");
+    char *range[] = { "bin/birp", "--levels", "100", "100", NULL };
+    cr_assert_eq(validargs(4, range), -1, "validargs accepted an empty levels range");
+    char *missing[] = { "bin/birp", "--clamp", "10", NULL };
+    cr_assert_eq(validargs(3, missing), -1, "validargs accepted a missing parameter");
+    char *pgm[] = { "bin/birp", "-o", "pgm", "--gamma", "2", NULL };
+    cr_assert_eq(validargs(5, pgm), -1, "validargs accepted a tone adjustment with pgm output");
+}
+
+Test(lut_tests_suite, point_command_test, .timeout=5) {
+    int status = system("bin/birp --invert 0 255 < rsrc/M.birp > test_output/lut_M_complement.birp"
+                        " && bin/birp -n < rsrc/M.birp > test_output/lut_M_negative.birp"
+                        " && cmp -s test_output/lut_M_complement.birp test_output/lut_M_negative.birp");
+    cr_assert_eq(status, 0, "--invert 0 255 differs from -n");
+    status = system("bin/birp --gamma 1 --clamp 0 255 < rsrc/M.birp > test_output/lut_M_identity.birp"
+                    " && cmp -s test_output/lut_M_identity.birp rsrc/M.birp");
+    cr_assert_eq(status, 0, "An identity chain changed rsrc/M.birp");
+    status = system("bin/birp -n --gamma 2 -t 50 < rsrc/cour25.birp > test_output/lut_cour25_fused.birp"
+                    " && bin/birp -n < rsrc/cour25.birp | bin/birp --gamma 2 | bin/birp -t 50"
+                    " | cmp -s - test_output/lut_cour25_fused.birp");
+    cr_assert_eq(status, 0, "A chain with -n and -t differs from applying them one at a time");
+}
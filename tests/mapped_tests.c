@@ -0,0 +1,79 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "birp2.h"
+#include "image.h"
+#include "mapped.h"
+
+Test(mapped_tests_suite, mapped_read_test, .timeout=5) {
+    FILE *in = fopen("rsrc/M.pgm", "r");
+    cr_assert(in != NULL, "Cannot open rsrc/M.pgm");
+    MAPPED_PGM map;
+    cr_assert_eq(mapped_pgm_read(in, &map), 0, "Regular file was not mapped");
+    int w, h;
+    unsigned char *expected = malloc(1 << 20);
+    FILE *again = fopen("rsrc/M.pgm", "r");
+    cr_assert_eq(img_read_pgm(again, &w, &h, expected, 1 << 20), 0, "img_read_pgm failed");
+    cr_assert(map.w == w && map.h == h, "Mapped size %dx%d instead of %dx%d", map.w, map.h, w, h);
+    cr_assert(memcmp(map.raster, expected, w * h) == 0, "Mapped raster differs");
+    cr_assert_eq(fgetc(in), EOF, "Stream not left at the end of the image");
+    cr_assert_eq(mapped_pgm_close(&map), 0, "mapped_pgm_close failed");
+    fclose(in);
+    fclose(again);
+    free(expected);
+}
+
+Test(mapped_tests_suite, unmappable_streams_test, .timeout=5) {
+    MAPPED_PGM map;
+    FILE *in = fopen("rsrc/M.pgm", "r");
+    fgetc(in);
+    cr_assert_eq(mapped_pgm_read(in, &map), 1, "Stream already read from was mapped");
+    cr_assert(map.base == NULL, "Failed mapping left a base");
+    fclose(in);
+    in = fopen("rsrc/M.birp", "r");
+    cr_assert_eq(mapped_pgm_read(in, &map), -1, "birp file was accepted as PGM");
+    cr_assert(map.base == NULL, "Failed mapping left a base");
+    fclose(in);
+    FILE *out = fopen("/dev/null", "w");
+    cr_assert_eq(mapped_pgm_create(out, 4, 4, &map), -1, "Device was mapped for output");
+    fclose(out);
+}
+
+Test(mapped_tests_suite, mapped_output_matches_stream_test, .timeout=5) {
+    FILE *in = fopen("rsrc/stone.birp", "r");
+    FILE *mapped = tmpfile();  /* Opened for reading and writing, so mapped */
+    global_options = 0x12;
+    cr_assert_eq(birp_to_pgm(in, mapped), 0, "birp_to_pgm into a mapped file failed");
+    rewind(in);
+    char *buffer = NULL;
+    size_t size = 0;
+    FILE *memory = open_memstream(&buffer, &size);
+    cr_assert_eq(birp_to_pgm(in, memory), 0, "birp_to_pgm into a stream failed");
+    fclose(memory);
+    cr_assert_eq(ftell(mapped), (long) size, "Mapped file position %ld instead of %zu", ftell(mapped), size);
+    rewind(mapped);
+    for (size_t i = 0; i < size; i++)
+        cr_assert_eq(fgetc(mapped), (unsigned char) buffer[i], "Byte %zu differs", i);
+    cr_assert_eq(fgetc(mapped), EOF, "Mapped file is too long");
+    free(buffer);
+    fclose(in);
+    fclose(mapped);
+}
+
+Test(mapped_tests_suite, output_over_input_test, .timeout=5) {
+    int status = system("cp rsrc/M.birp test_output/same.birp");
+    cr_assert_eq(WEXITSTATUS(status), 0, "Cannot copy rsrc/M.birp");
+    status = system("bin/birp -i birp -o birp --input test_output/same.birp --output test_output/same.birp 2> /dev/null");
+    cr_assert_neq(WEXITSTATUS(status), EXIT_SUCCESS, "Writing over the input succeeded");
+    status = system("bin/birp -i birp -o birp --output test_output/same.birp < test_output/same.birp 2> /dev/null");
+    cr_assert_neq(WEXITSTATUS(status), EXIT_SUCCESS, "Writing over the redirected input succeeded");
+    status = system("cmp test_output/same.birp rsrc/M.birp");
+    cr_assert_eq(WEXITSTATUS(status), 0, "The input was truncated");
+    remove("test_output/same.birp");
+}
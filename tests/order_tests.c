@@ -0,0 +1,104 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "birp2.h"
+#include "image.h"
+#include "order.h"
+#include "test_images.h"
+
+Test(order_tests_suite, kinds_round_trip_test, .timeout=5) {
+    int w = 45, h = 27;
+    unsigned char *raster = make_test_image(w, h, test_ramp, test_noise, 2);
+    unsigned char *decoded = malloc(w * h);
+    int level = bdd_min_level(w, h);
+    for (int kind = BDD_ORDER_INTERLEAVED; kind < BDD_ORDER_SEARCH; kind++) {
+        int order = bdd_order_of_kind(kind, level);
+        cr_assert(bdd_order_valid(order, level), "Order 0x%x of kind %d is not valid", order, kind);
+        bdd_reset_nodes();
+        BDD_NODE *root = bdd_from_raster_ordered(w, h, raster, order);
+        cr_assert_not_null(root, "Could not build kind %d", kind);
+        bdd_to_raster_ordered(root, w, h, decoded, order);
+        for (int i = 0; i < w * h; i++)
+            cr_assert_eq(decoded[i], raster[i], "Kind %d differs at %d", kind, i);
+        cr_assert_eq(bdd_order_standardize(root, w, h, order), bdd_from_raster(w, h, raster),
+                     "Kind %d does not standardize", kind);
+    }
+    free(raster);
+    free(decoded);
+}
+
+Test(order_tests_suite, order_valid_test, .timeout=5) {
+    int level = bdd_min_level(64, 16); /* Six column splits and four row splits */
+    cr_assert(bdd_order_valid(bdd_order_of_kind(BDD_ORDER_INTERLEAVED, level), level), "Interleaved not valid");
+    cr_assert(!bdd_order_valid(0, level), "An order without column splits is valid");
+    cr_assert(!bdd_order_valid(-1, level), "An order with splits above the root is valid");
+}
+
+Test(order_tests_suite, search_not_worse_test, .timeout=10) {
+    int w = 64, h = 64;
+    unsigned char *raster = make_test_image(w, h, test_ramp, test_noise, 2);
+    bdd_reset_nodes();
+    bdd_from_raster(w, h, raster);
+    int interleaved = current_bdd_node_index - BDD_NUM_LEAVES;
+    int nodes;
+    int order = bdd_order_search(w, h, raster, &nodes);
+    cr_assert(bdd_order_valid(order, bdd_min_level(w, h)), "Search found an invalid order 0x%x", order);
+    cr_assert(nodes <= interleaved, "Search found %d nodes, more than %d interleaved", nodes, interleaved);
+    bdd_reset_nodes();
+    bdd_from_raster_ordered(w, h, raster, order);
+    cr_assert_eq(current_bdd_node_index - BDD_NUM_LEAVES, nodes, "Wrong node count for the order found");
+    free(raster);
+}
+
+Test(order_tests_suite, ordered_file_round_trip_test, .timeout=5) {
+    int w = 100, h = 60;
+    unsigned char *raster = make_test_image(w, h, test_ramp, test_noise, 2);
+    int order = bdd_order_of_kind(BDD_ORDER_ROW_BLOCKS, bdd_min_level(w, h));
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster_ordered(w, h, raster, order);
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buf, &len);
+    cr_assert_eq(img_write_birp_ordered(root, w, h, order, mem), 0, "Could not write the ordered image");
+    fclose(mem);
+    bdd_reset_nodes();
+    mem = fmemopen(buf, len, "r");
+    int rw, rh, rorder;
+    BDD_NODE *read = img_read_birp_ordered(mem, &rw, &rh, &rorder);
+    fclose(mem);
+    cr_assert(read != NULL && rorder == order, "Order 0x%x not read back", order);
+    mem = fmemopen(buf, len, "r");
+    read = img_read_birp(mem, &rw, &rh);
+    fclose(mem);
+    free(buf);
+    cr_assert(rw == w && rh == h && read == bdd_from_raster(w, h, raster), "Ordered image does not read back");
+    free(raster);
+}
+
+Test(order_tests_suite, order_option_test, .timeout=5) {
+    char *args[] = { "bin/birp", "-i", "pgm", "--order", "search", NULL };
+    cr_assert_eq(validargs(5, args), 0, "validargs rejected --order");
+    cr_assert_eq(order_kind, BDD_ORDER_SEARCH, "Wrong order kind %d", order_kind);
+    char *pgm[] = { "bin/birp", "-o", "pgm", "--order", "row-blocks", NULL };
+    cr_assert_eq(validargs(5, pgm), -1, "validargs accepted --order with birp input");
+    char *lossy[] = { "bin/birp", "-i", "pgm", "-l", "4", "--order", "row-blocks", NULL };
+    cr_assert_eq(validargs(7, lossy), -1, "validargs accepted --order with -l");
+    char *bad[] = { "bin/birp", "-i", "pgm", "--order", "random", NULL };
+    cr_assert_eq(validargs(5, bad), -1, "validargs accepted an unknown order");
+    char *plain[] = { "bin/birp", "-i", "pgm", NULL };
+    cr_assert_eq(validargs(3, plain), 0, "validargs rejected pgm input");
+    cr_assert_eq(order_kind, BDD_ORDER_INTERLEAVED, "Order kind not reset");
+}
+
+Test(order_tests_suite, order_command_test, .timeout=10) {
+    int status = system("bin/birp -i pgm --order search < rsrc/M.pgm > test_output/order_M.birp 2> test_output/order_M.txt"
+                        " && grep -q '^order: [rc]*, [0-9]* nodes' test_output/order_M.txt"
+                        " && bin/birp -o birp < test_output/order_M.birp | cmp -s - rsrc/M.birp"
+                        " && bin/birp -o pgm < test_output/order_M.birp > test_output/order_M.pgm"
+                        " && bin/birp -o pgm < rsrc/M.birp | cmp -s - test_output/order_M.pgm");
+    cr_assert_eq(status, 0, "--order search did not report its order or round trip");
+}
@@ -0,0 +1,85 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "birp2.h"
+#include "pipeline.h"
+
+/* Run a conversion on a file, returning its output in a malloc'd buffer. */
+static char *convert_file(int (*convert)(FILE *, FILE *), char *path, int options, size_t *size, int *status) {
+    char *output = NULL;
+    FILE *in = fopen(path, "r");
+    FILE *out = open_memstream(&output, size);
+    cr_assert(in != NULL && out != NULL, "Cannot open %s", path);
+    bdd_reset_nodes();
+    global_options = options;
+    *status = convert(in, out);
+    fclose(in);
+    fclose(out);
+    return output;
+}
+
+Test(pipeline_tests_suite, pipelined_conversions_match_test, .timeout=10) {
+    char *names[] = {"M", "checker", "cour25", "stone"};
+    for (int i = 0; i < 4; i++) {
+        char path[64];
+        size_t size1, size2;
+        int status1, status2;
+        snprintf(path, sizeof(path), "rsrc/%s.pgm", names[i]);
+        char *expected = convert_file(pgm_to_birp, path, 0x21, &size1, &status1);
+        char *actual = convert_file(pgm_to_birp, path, 0x21 | PIPELINE_OPTION, &size2, &status2);
+        cr_assert_eq(status2, 0, "Pipelined pgm_to_birp failed on %s", path);
+        cr_assert(size1 == size2 && memcmp(expected, actual, size1) == 0, "Pipelined pgm_to_birp differs on %s", path);
+        free(expected);
+        free(actual);
+
+        snprintf(path, sizeof(path), "rsrc/%s.birp", names[i]);
+        expected = convert_file(birp_to_pgm, path, 0x12, &size1, &status1);
+        actual = convert_file(birp_to_pgm, path, 0x12 | PIPELINE_OPTION, &size2, &status2);
+        cr_assert_eq(status2, 0, "Pipelined birp_to_pgm failed on %s", path);
+        cr_assert(size1 == size2 && memcmp(expected, actual, size1) == 0, "Pipelined birp_to_pgm differs on %s", path);
+        free(expected);
+        free(actual);
+    }
+}
+
+Test(pipeline_tests_suite, truncated_pgm_test, .timeout=5) {
+    FILE *in = tmpfile();
+    fprintf(in, "P5 300 200 255\n");
+    for (int i = 0; i < 300 * 100; i++)
+        fputc(i, in);
+    rewind(in);
+    FILE *out = fopen("/dev/null", "w");
+    global_options = 0x21 | PIPELINE_OPTION;
+    cr_assert_eq(pgm_to_birp(in, out), -1, "Truncated PGM was accepted");
+    fclose(in);
+    fclose(out);
+}
+
+Test(pipeline_tests_suite, stream_round_trip_test, .timeout=5) {
+    /* More than the ring holds, so that both threads wait for the other */
+    size_t size = 3 * PIPE_STREAM_CAPACITY + 12345;
+    FILE *file = tmpfile();
+    PIPE_STREAM stream;
+    FILE *behind = pipe_stream_write(&stream, file);
+    cr_assert(behind != NULL, "pipe_stream_write failed");
+    for (size_t i = 0; i < size; i++)
+        fputc((int) (i * 7 % 251), behind);
+    cr_assert_eq(fclose(behind), 0, "Closing the written stream failed");
+    rewind(file);
+    FILE *ahead = pipe_stream_read(&stream, file);
+    cr_assert(ahead != NULL, "pipe_stream_read failed");
+    size_t count = 0;
+    int c;
+    while ((c = fgetc(ahead)) != EOF) {
+        cr_assert_eq(c, (int) (count * 7 % 251), "Byte %zu is wrong", count);
+        count++;
+    }
+    cr_assert_eq(count, size, "Read %zu bytes instead of %zu", count, size);
+    fclose(ahead);
+    fclose(file);
+}
@@ -0,0 +1,154 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "birp2.h"
+#include "image.h"
+#include "planes.h"
+#include "test_images.h"
+
+static unsigned char gray_code(unsigned char v) {
+    return v ^ (v >> 1);
+}
+
+Test(planes_tests_suite, planes_round_trip_test, .timeout=5) {
+    int w = 45, h = 27;
+    unsigned char *raster = make_test_image(w, h, test_noise, test_ramp, h / 2);
+    unsigned char *decoded = malloc(64 * 64);
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    int level = bdd_min_level(w, h);
+    for (int gray = 0; gray <= 1; gray++) {
+        BDD_NODE *planes = bdd_to_planes(root, level, gray);
+        cr_assert_not_null(planes, "bdd_to_planes returned NULL");
+        for (int bit = 0; bit < BDD_PLANES; bit++) {
+            bdd_to_raster(bdd_plane(planes, level, bit), w, h, decoded);
+            for (int i = 0; i < w * h; i++) {
+                int exp = ((gray ? gray_code(raster[i]) : raster[i]) >> bit) & 1;
+                cr_assert_eq(decoded[i], exp, "Plane %d (gray %d) differs at %d", bit, gray, i);
+            }
+        }
+        cr_assert_eq(bdd_from_planes(planes, level, gray), root, "Recombined planes (gray %d) differ", gray);
+    }
+    free(raster);
+    free(decoded);
+}
+
+Test(planes_tests_suite, encoded_file_round_trip_test, .timeout=5) {
+    int w = 100, h = 60;
+    unsigned char *raster = make_test_image(w, h, test_noise, test_ramp, h / 2);
+    for (int encoding = BDD_ENCODING_NODES; encoding <= BDD_ENCODING_AUTO; encoding++) {
+        bdd_reset_nodes();
+        BDD_NODE *root = bdd_from_raster(w, h, raster);
+        char *buf = NULL;
+        size_t len = 0;
+        FILE *mem = open_memstream(&buf, &len);
+        long sizes[3] = { -2, -2, -2 };
+        int written = img_write_birp_encoded(root, w, h, encoding, mem, sizes);
+        fclose(mem);
+        cr_assert(written != -1 && written != BDD_ENCODING_AUTO, "Encoding %d failed", encoding);
+        if (encoding == BDD_ENCODING_AUTO) {
+            for (int e = 0; e < 3; e++)
+                cr_assert(sizes[e] == -1 || sizes[written] <= sizes[e], "Encoding %d is smaller than %d", e, written);
+            cr_assert_eq((long) len, sizes[written] + 14, "Wrong size %zu", len); /* And "B5 100 60 255\n" */
+        } else {
+            cr_assert_eq(written, encoding, "Wrote encoding %d instead of %d", written, encoding);
+        }
+        bdd_reset_nodes();
+        mem = fmemopen(buf, len, "r");
+        int rw, rh;
+        BDD_NODE *read = img_read_birp(mem, &rw, &rh);
+        fclose(mem);
+        free(buf);
+        cr_assert_not_null(read, "Could not read encoding %d", encoding);
+        BDD_NODE *exp = bdd_from_raster(w, h, raster);
+        cr_assert(rw == w && rh == h && read == exp, "Encoding %d does not read back", encoding);
+    }
+    free(raster);
+}
+
+Test(planes_tests_suite, bad_plane_level_test, .timeout=5) {
+    int w = 100, h = 60;
+    unsigned char *raster = make_test_image(w, h, test_noise, test_ramp, h / 2);
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buf, &len);
+    cr_assert_eq(img_write_birp_encoded(root, w, h, BDD_ENCODING_PLANES, mem, NULL), BDD_ENCODING_PLANES,
+                 "Encoding planes failed");
+    fclose(mem);
+    int level = bdd_min_level(w, h);
+    cr_assert_eq(buf[16], level, "Wrote plane level %d instead of %d", buf[16], level); /* After "B5 100 60 255\npb" */
+    int bad[] = { 0, 4, level - 1, level + 1, 26 };
+    for (int i = 0; i < 5; i++) {
+        buf[16] = bad[i];
+        mem = fmemopen(buf, len, "r");
+        int rw, rh;
+        cr_assert_null(img_read_birp(mem, &rw, &rh), "Plane level %d was accepted", bad[i]);
+        fclose(mem);
+    }
+    free(buf);
+    /* A root above the level of the image is written as the block holding the image */
+    buf = NULL;
+    mem = open_memstream(&buf, &len);
+    cr_assert_eq(img_write_birp_encoded(root, 30, 20, BDD_ENCODING_GRAY, mem, NULL), BDD_ENCODING_GRAY,
+                 "Encoding a corner in planes failed");
+    fclose(mem);
+    mem = fmemopen(buf, len, "r");
+    int rw, rh;
+    BDD_NODE *read = img_read_birp(mem, &rw, &rh);
+    fclose(mem);
+    free(buf);
+    cr_assert_not_null(read, "Could not read the planes of a corner");
+    unsigned char *expected = malloc(30 * 20), *decoded = malloc(30 * 20);
+    bdd_to_raster(root, 30, 20, expected);
+    bdd_to_raster(read, 30, 20, decoded);
+    cr_assert(memcmp(expected, decoded, 30 * 20) == 0, "The planes of a corner decode differently");
+    free(expected);
+    free(decoded);
+    free(raster);
+}
+
+Test(planes_tests_suite, gray_planes_smaller_for_gradient_test, .timeout=5) {
+    int size = 256;
+    unsigned char *raster = malloc(size * size);
+    for (int i = 0; i < size * size; i++)
+        raster[i] = ((i / size) + (i % size)) / 2;
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(size, size, raster);
+    int level = bdd_min_level(size, size);
+    long nodes = bdd_serialized_size(root);
+    long gray = bdd_serialized_size(bdd_to_planes(root, level, 1));
+    cr_assert(gray < nodes, "Gray planes of a gradient are not smaller: %ld bytes, %ld as nodes", gray, nodes);
+    free(raster);
+}
+
+Test(planes_tests_suite, encoding_option_test, .timeout=5) {
+    char *args[] = { "bin/birp", "-i", "pgm", "--encoding", "gray", NULL };
+    cr_assert_eq(validargs(5, args), 0, "validargs rejected --encoding");
+    cr_assert_eq((global_options & ENCODING_OPTIONS) >> ENCODING_SHIFT, BDD_ENCODING_GRAY,
+                 "Wrong encoding bits 0x%x", global_options);
+    char *negate[] = { "bin/birp", "--encoding", "auto", "-n", NULL };
+    cr_assert_eq(validargs(4, negate), 0, "validargs rejected --encoding with -n");
+    char *pgm[] = { "bin/birp", "-o", "pgm", "--encoding", "planes", NULL };
+    cr_assert_eq(validargs(5, pgm), -1, "validargs accepted --encoding with pgm output");
+    char *bad[] = { "bin/birp", "--encoding", "jpeg", NULL };
+    cr_assert_eq(validargs(3, bad), -1, "validargs accepted an unknown encoding");
+}
+
+Test(planes_tests_suite, encoding_command_test, .timeout=5) {
+    int status = system("bin/birp --encoding gray < rsrc/cour25.birp > test_output/planes_cour25.birp"
+                        " && bin/birp -o pgm < test_output/planes_cour25.birp > test_output/planes_cour25.pgm"
+                        " && bin/birp -o pgm < rsrc/cour25.birp > test_output/nodes_cour25.pgm"
+                        " && cmp -s test_output/planes_cour25.pgm test_output/nodes_cour25.pgm");
+    cr_assert_eq(status, 0, "Decoding Gray-coded planes differs from decoding the original");
+    status = system("bin/birp -i pgm --encoding auto < rsrc/M.pgm > test_output/auto_M.birp 2> test_output/auto_M.txt"
+                    " && grep -q '^encoding: nodes' test_output/auto_M.txt"
+                    " && bin/birp -o birp < test_output/auto_M.birp | cmp -s - rsrc/M.birp");
+    cr_assert_eq(status, 0, "--encoding auto did not report its choice or round trip");
+}
@@ -0,0 +1,58 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdatomic.h>
+
+#include "pool.h"
+
+static atomic_int total;
+
+static void add_one(void *arg) {
+    atomic_fetch_add(&total, 1);
+}
+
+struct range {
+    POOL *pool;
+    int lo, hi;
+};
+
+/* Count the integers in [lo, hi) by splitting the range into subtasks. */
+static void count_range(void *arg) {
+    struct range *r = arg;
+    if (r->hi - r->lo <= 4) {
+        atomic_fetch_add(&total, r->hi - r->lo);
+        return;
+    }
+    int mid = (r->lo + r->hi) / 2;
+    struct range left = {r->pool, r->lo, mid}, right = {r->pool, mid, r->hi};
+    POOL_GROUP group;
+    atomic_init(&group.pending, 0);
+    pool_submit(r->pool, &group, count_range, &left);
+    pool_submit(r->pool, &group, count_range, &right);
+    pool_wait(r->pool, &group);
+}
+
+Test(pool_tests_suite, runs_every_task_test, .timeout=5) {
+    POOL *pool = pool_create(4);
+    cr_assert(pool != NULL, "pool_create failed");
+    atomic_store(&total, 0);
+    POOL_GROUP group;
+    atomic_init(&group.pending, 0);
+    for (int i = 0; i < 1000; i++)
+        cr_assert_eq(pool_submit(pool, &group, add_one, NULL), 0, "pool_submit failed");
+    pool_wait(pool, &group);
+    cr_assert_eq(atomic_load(&total), 1000, "Ran %d of 1000 tasks", atomic_load(&total));
+    pool_destroy(pool);
+}
+
+Test(pool_tests_suite, nested_tasks_test, .timeout=5) {
+    POOL *pool = pool_create(3);
+    atomic_store(&total, 0);
+    struct range all = {pool, 0, 10000};
+    POOL_GROUP group;
+    atomic_init(&group.pending, 0);
+    pool_submit(pool, &group, count_range, &all);
+    pool_wait(pool, &group);
+    cr_assert_eq(atomic_load(&total), 10000, "Counted %d of 10000", atomic_load(&total));
+    cr_assert_eq(pool_worker_index(), -1, "Main thread reported as a worker");
+    pool_destroy(pool);
+}
@@ -0,0 +1,119 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "image.h"
+#include "quad.h"
+#include "test_images.h"
+
+Test(quad_tests_suite, raster_round_trip_test, .timeout=5) {
+    int w = 45, h = 27;
+    unsigned char *raster = make_test_image(w, h, test_steps, test_noise, h / 2);
+    unsigned char *decoded = malloc(w * h);
+    bdd_reset_nodes();
+    int quad = bdd_quad_from_raster(w, h, raster);
+    cr_assert_neq(quad, -1, "bdd_quad_from_raster failed");
+    bdd_quad_to_raster(quad, w, h, decoded);
+    for (int i = 0; i < w * h; i++)
+        cr_assert_eq(decoded[i], raster[i], "Decoded quadtree differs at %d", i);
+    cr_assert_eq(bdd_quad_from_raster(w, h, raster), quad, "Building the same image twice gave another node");
+    free(raster);
+    free(decoded);
+}
+
+Test(quad_tests_suite, bdd_conversion_test, .timeout=5) {
+    int sizes[][2] = { { 64, 64 }, { 100, 60 }, { 1, 1 }, { 2, 1 }, { 33, 5 } };
+    for (int s = 0; s < 5; s++) {
+        int w = sizes[s][0], h = sizes[s][1];
+        unsigned char *raster = make_test_image(w, h, test_steps, test_noise, h / 2);
+        bdd_reset_nodes();
+        BDD_NODE *root = bdd_from_raster(w, h, raster);
+        int quad = bdd_quad_from_raster(w, h, raster);
+        cr_assert_eq(bdd_quad_from_bdd(root), quad, "%dx%d: converted BDD differs from built quadtree", w, h);
+        cr_assert_eq(bdd_quad_to_bdd(quad), root, "%dx%d: converted quadtree differs from built BDD", w, h);
+        free(raster);
+    }
+}
+
+Test(quad_tests_suite, uniform_and_tiled_test, .timeout=5) {
+    int size = 32;
+    unsigned char *raster = malloc(size * size);
+    for (int i = 0; i < size * size; i++)
+        raster[i] = 77;
+    bdd_reset_nodes();
+    cr_assert_eq(bdd_quad_from_raster(size, size, raster), 77, "A uniform image is not a leaf");
+    for (int i = 0; i < size * size; i++)
+        raster[i] = ((i / size) % 2) ^ ((i % size) % 2) ? 255 : 0;
+    int quad = bdd_quad_from_raster(size, size, raster);
+    cr_assert_eq(bdd_quad_count_nodes(quad), 3, "A checkerboard takes more than one node");
+    cr_assert_eq(bdd_quad_rotate(quad), bdd_quad_from_bdd(bdd_rotate(bdd_quad_to_bdd(quad), 10)),
+                 "Rotated checkerboard differs");
+    free(raster);
+}
+
+Test(quad_tests_suite, rotate_test, .timeout=5) {
+    int w = 64, h = 64;
+    unsigned char *raster = make_test_image(w, h, test_steps, test_noise, h / 2);
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(w, h, raster);
+    int quad = bdd_quad_from_bdd(root);
+    int rotated = bdd_quad_rotate(quad);
+    cr_assert_neq(rotated, -1, "bdd_quad_rotate failed");
+    cr_assert_eq(bdd_quad_to_bdd(rotated), bdd_rotate(root, root->level), "Rotated quadtree differs from rotated BDD");
+    int full = rotated;
+    for (int i = 0; i < 3; i++)
+        full = bdd_quad_rotate(full);
+    cr_assert_eq(full, quad, "Four rotations are not the identity");
+    free(raster);
+}
+
+Test(quad_tests_suite, serialize_test, .timeout=5) {
+    int sizes[][2] = { { 64, 64 }, { 100, 60 }, { 33, 5 } };
+    for (int s = 0; s < 3; s++) {
+        int w = sizes[s][0], h = sizes[s][1];
+        unsigned char *raster = make_test_image(w, h, test_steps, test_noise, h / 2);
+        for (int i = 0; i < w * h; i += 7) /* Repeated rows in places, so that halves are shared */
+            raster[i] = raster[i % w];
+        bdd_reset_nodes();
+        BDD_NODE *root = bdd_from_raster(w, h, raster);
+        int quad = bdd_quad_from_bdd(root);
+        char *exp = NULL, *got = NULL;
+        size_t exp_len = 0, got_len = 0;
+        FILE *mem = open_memstream(&exp, &exp_len);
+        bdd_serialize(root, mem);
+        fclose(mem);
+        mem = open_memstream(&got, &got_len);
+        cr_assert_eq(bdd_quad_serialize(quad, mem), 0, "bdd_quad_serialize failed");
+        fclose(mem);
+        cr_assert(got_len == exp_len && memcmp(got, exp, exp_len) == 0,
+                  "%dx%d: serialized quadtree differs (%zu bytes, %zu expected)", w, h, got_len, exp_len);
+        free(exp);
+        free(got);
+        free(raster);
+    }
+}
+
+Test(quad_tests_suite, sample_images_test, .timeout=10) {
+    const char *images[] = { "rsrc/M.birp", "rsrc/checker.birp", "rsrc/cour25.birp" };
+    for (int i = 0; i < 3; i++) {
+        FILE *in = fopen(images[i], "r");
+        cr_assert_not_null(in, "Could not open %s", images[i]);
+        bdd_reset_nodes();
+        int w, h;
+        BDD_NODE *root = img_read_birp(in, &w, &h);
+        fclose(in);
+        cr_assert_not_null(root, "Could not read %s", images[i]);
+        int quad = bdd_quad_from_bdd(root);
+        cr_assert_eq(bdd_quad_to_bdd(quad), root, "%s does not convert back", images[i]);
+        unsigned char *exp = malloc(w * h), *got = malloc(w * h);
+        bdd_to_raster(root, w, h, exp);
+        bdd_quad_to_raster(quad, w, h, got);
+        cr_assert(memcmp(exp, got, w * h) == 0, "%s decodes differently", images[i]);
+        free(exp);
+        free(got);
+    }
+}
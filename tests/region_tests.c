@@ -0,0 +1,152 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+
+#include "const.h"
+#include "region.h"
+#include "bdd2.h"
+
+static long long brute_force_sum(unsigned char *raster, int w, int h,
+                                 int row, int col, int height, int width) {
+    long long sum = 0;
+    for (int r = row; r < row + height; r++) {
+        for (int c = col; c < col + width; c++) {
+            if (r >= 0 && r < h && c >= 0 && c < w)
+                sum += raster[r * w + c];
+        }
+    }
+    return sum;
+}
+
+Test(region_tests_suite, region_sum_matches_raster_test, .timeout=5) {
+    int w = 37, h = 21;
+    cr_assert_not_null(raster_reserve(w * h), "raster_reserve failed");
+    for (int i = 0; i < w * h; i++)
+        raster_data[i] = (i * 7 + (i / w) * 13) % 256;
+    BDD_NODE *root = bdd_from_raster(w, h, raster_data);
+    cr_assert_not_null(root, "bdd_from_raster returned NULL");
+    for (int row = -2; row < h; row += 3) {
+        for (int col = -2; col < w; col += 5) {
+            long long count;
+            long long sum = bdd_region_sum(root, w, h, row, col, 9, 11, &count);
+            long long exp = brute_force_sum(raster_data, w, h, row, col, 9, 11);
+            cr_assert_eq(sum, exp, "Wrong sum at (%d, %d).  Got: %lld | Expected: %lld",
+                         row, col, sum, exp);
+        }
+    }
+}
+
+Test(region_tests_suite, region_sum_uniform_test, .timeout=5) {
+    int w = 64, h = 64;
+    cr_assert_not_null(raster_reserve(w * h), "raster_reserve failed");
+    for (int i = 0; i < w * h; i++)
+        raster_data[i] = 200;
+    BDD_NODE *root = bdd_from_raster(w, h, raster_data);
+    long long count;
+    long long sum = bdd_region_sum(root, w, h, 10, 20, 100, 100, &count);
+    cr_assert_eq(count, 54 * 44, "Wrong clipped count.  Got: %lld | Expected: %d", count, 54 * 44);
+    cr_assert_eq(sum, 200LL * 54 * 44, "Wrong sum.  Got: %lld", sum);
+}
+
+Test(region_tests_suite, bounding_box_test, .timeout=5) {
+    int w = 50, h = 30;
+    cr_assert_not_null(raster_reserve(w * h), "raster_reserve failed");
+    for (int i = 0; i < w * h; i++)
+        raster_data[i] = 255;
+    raster_data[4 * w + 7] = 10;
+    raster_data[20 * w + 41] = 90;
+    BDD_NODE *root = bdd_from_raster(w, h, raster_data);
+    int row, col, height, width;
+    int ret = bdd_bounding_box(root, w, h, 255, &row, &col, &height, &width);
+    cr_assert_eq(ret, 1, "Expected content to be found.  Got: %d", ret);
+    cr_assert(row == 4 && col == 7 && height == 17 && width == 35,
+              "Wrong bounding box.  Got: %d %d %d %d | Expected: 4 7 17 35", row, col, height, width);
+    ret = bdd_bounding_box(root, w, h, 10, &row, &col, &height, &width);
+    cr_assert(row == 0 && col == 0 && height == h && width == w,
+              "Padding counted as content.  Got: %d %d %d %d", row, col, height, width);
+}
+
+Test(region_tests_suite, crop_test, .timeout=5) {
+    int w = 50, h = 30;
+    cr_assert_not_null(raster_reserve(w * h), "raster_reserve failed");
+    for (int i = 0; i < w * h; i++)
+        raster_data[i] = (i % 3 == 0) ? 0 : (unsigned char) i;
+    BDD_NODE *root = bdd_from_raster(w, h, raster_data);
+    BDD_NODE *cropped = bdd_crop(root, w, h, 5, 9, 13, 21);
+    cr_assert_not_null(cropped, "bdd_crop returned NULL");
+    for (int r = 0; r < 13; r++) {
+        for (int c = 0; c < 21; c++) {
+            unsigned char exp = raster_data[(r + 5) * w + c + 9];
+            long long got = bdd_region_sum(cropped, 21, 13, r, c, 1, 1, NULL);
+            cr_assert_eq(got, exp, "Wrong pixel at (%d, %d).  Got: %lld | Expected: %d", r, c, got, exp);
+        }
+    }
+}
+
+Test(region_tests_suite, crop_periodic_test, .timeout=5) {
+    int size = 4096;
+    cr_assert_not_null(raster_reserve(size * size), "raster_reserve failed");
+    for (int i = 0; i < size * size; i++)
+        raster_data[i] = ((i / size) / 3 % 4) * 40 + ((i % size) / 5 % 3) * 20 + 1;
+    bdd_reset_nodes();
+    BDD_NODE *root = bdd_from_raster(size, size, raster_data);
+    int before = current_bdd_node_index;
+    BDD_NODE *cropped = bdd_crop(root, size, size, 3, 5, size - 8, size - 7);
+    cr_assert_not_null(cropped, "bdd_crop returned NULL");
+    cr_assert_lt(current_bdd_node_index - before, 2000, "Crop of a periodic image built %d nodes",
+                 current_bdd_node_index - before);
+    int probes[][2] = { { 0, 0 }, { 1, 7 }, { 2047, 2049 }, { size - 9, size - 8 }, { 100, 3001 } };
+    for (int p = 0; p < 5; p++) {
+        int r = probes[p][0], c = probes[p][1];
+        long long got = bdd_region_sum(cropped, size - 7, size - 8, r, c, 1, 1, NULL);
+        cr_assert_eq(got, raster_data[(r + 3) * size + c + 5], "Wrong pixel at (%d, %d)", r, c);
+    }
+}
+
+Test(region_tests_suite, fill_rect_matches_rebuild_test, .timeout=5) {
+    int w = 45, h = 27;
+    cr_assert_not_null(raster_reserve(w * h), "raster_reserve failed");
+    unsigned char *painted = malloc(w * h);
+    for (int i = 0; i < w * h; i++)
+        raster_data[i] = painted[i] = (i / w) < 12 ? 50 : (unsigned char) (i * 7);
+    BDD_NODE *root = bdd_from_raster(w, h, raster_data);
+    int edits[][5] = { { 3, 4, 10, 20, 200 }, { -5, 40, 8, 100, 0 }, { 26, 44, 1, 1, 9 }, { 0, 0, 27, 45, 50 },
+                       { 11, 13, 2, 3, 77 } };
+    for (int e = 0; e < 5; e++) {
+        root = bdd_fill_rect(root, w, h, edits[e][0], edits[e][1], edits[e][2], edits[e][3], edits[e][4]);
+        cr_assert_not_null(root, "bdd_fill_rect returned NULL for edit %d", e);
+        for (int r = 0; r < h; r++)
+            for (int c = 0; c < w; c++)
+                if (r >= edits[e][0] && r < edits[e][0] + edits[e][2] && c >= edits[e][1] && c < edits[e][1] + edits[e][3])
+                    painted[r * w + c] = edits[e][4];
+        BDD_NODE *rebuilt = bdd_from_raster(w, h, painted);
+        cr_assert_eq(root, rebuilt, "Edit %d differs from rebuilding the painted raster", e);
+    }
+    int nodes = current_bdd_node_index;
+    cr_assert_eq(bdd_set_pixel(root, w, h, 11, 13, 77), root, "Repainting a pixel changed the image");
+    cr_assert_eq(bdd_fill_rect(root, w, h, 30, 0, 5, 5, 1), root, "Painting outside the image changed it");
+    cr_assert_eq(current_bdd_node_index, nodes, "Unchanged images created nodes");
+    cr_assert_null(bdd_fill_rect(root, w, h, 0, 0, -1, 5, 1), "Accepted a negative height");
+    free(painted);
+}
+
+Test(region_tests_suite, edit_script_test, .timeout=5) {
+    FILE *script = fopen("test_output/edits.txt", "w");
+    cr_assert_not_null(script, "Cannot create test_output/edits.txt");
+    fprintf(script, "0 0 4 4 255\n10 10 1 1 0\n");
+    fclose(script);
+    FILE *queries = fopen("test_output/edit_queries.txt", "w");
+    cr_assert_not_null(queries, "Cannot create test_output/edit_queries.txt");
+    fprintf(queries, "0 0 4 4\n10 10 1 1\n");
+    fclose(queries);
+    int status = system("bin/birp -e test_output/edits.txt < rsrc/M.birp > test_output/edited_M.birp"
+                        " && bin/birp -q test_output/edit_queries.txt < test_output/edited_M.birp > test_output/edited_M.txt");
+    cr_assert_eq(status, 0, "bin/birp failed");
+    FILE *sums = fopen("test_output/edited_M.txt", "r");
+    long long sum, count;
+    double mean;
+    cr_assert_eq(fscanf(sums, "%lld %lld %lf", &sum, &count, &mean), 3, "Missing first sum");
+    cr_assert(sum == 255 * 16 && count == 16, "Rectangle not painted.  Got: %lld %lld", sum, count);
+    cr_assert_eq(fscanf(sums, "%lld %lld %lf", &sum, &count, &mean), 3, "Missing second sum");
+    cr_assert(sum == 0 && count == 1, "Pixel not painted.  Got: %lld %lld", sum, count);
+    fclose(sums);
+}
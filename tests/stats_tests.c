@@ -0,0 +1,28 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+
+#include "const.h"
+#include "bdd2.h"
+#include "stats.h"
+
+Test(stats_tests_suite, lookup_counters_test, .timeout=5) {
+    cr_assert_eq(stats_enable(), 0, "stats_enable failed");
+    int w = 40, h = 24;
+    cr_assert_not_null(raster_reserve(w * h), "raster_reserve failed");
+    for (int i = 0; i < w * h; i++)
+        raster_data[i] = (i / 7) % 5 == 0 ? 0 : (i * 3) % 256;
+    int before = current_bdd_node_index;
+    BDD_NODE *root = bdd_from_raster(w, h, raster_data);
+    cr_assert_not_null(root, "bdd_from_raster returned NULL");
+    long long created = birp_stats.nodes_created;
+    cr_assert_eq(created, current_bdd_node_index - before,
+                 "Wrong created count.  Got: %lld | Expected: %d", created, current_bdd_node_index - before);
+    long long probes = 0;
+    for (int i = 0; i < STATS_PROBE_BUCKETS; i++)
+        probes += birp_stats.probe_histogram[i];
+    cr_assert_eq(probes, birp_stats.nodes_created + birp_stats.nodes_reused,
+                 "Every uncollapsed lookup should record one probe length");
+    bdd_from_raster(w, h, raster_data);
+    cr_assert_eq(birp_stats.nodes_created, created, "Rebuilding the same raster created nodes");
+    cr_assert(birp_stats.nodes_reused > 0, "Rebuilding the same raster reused no nodes");
+}
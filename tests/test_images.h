@@ -0,0 +1,43 @@
+#ifndef TEST_IMAGES_H
+#define TEST_IMAGES_H
+
+#include <stdlib.h>
+
+/*
+ * Synthetic rasters shared by the suites: bands of rows that alternate
+ * between two patterns, so that an image mixes regions that share many
+ * nodes with regions that share none.
+ */
+typedef unsigned char (*TEST_PATTERN)(int row, int col, int w);
+
+/* Pseudo-random values, which share almost no subtrees. */
+static inline unsigned char test_noise(int row, int col, int w) {
+    return ((row * w + col) * 37 + row * 11) % 256;
+}
+
+/* Vertical stripes 8 pixels wide, in steps of 16. */
+static inline unsigned char test_steps(int row, int col, int w) {
+    return (col / 8) * 16;
+}
+
+/* A horizontal ramp from 0 to 255 across the width. */
+static inline unsigned char test_ramp(int row, int col, int w) {
+    return (col * 255) / w;
+}
+
+/*
+ * A w x h raster, to be freed by the caller, whose rows come in bands of
+ * band rows (at least 1), drawn from first, second, first and so on.  With
+ * band = h / 2, first fills the top half and second the bottom.
+ */
+static inline unsigned char *make_test_image(int w, int h, TEST_PATTERN first, TEST_PATTERN second, int band) {
+    unsigned char *raster = malloc((size_t) w * h);
+    if (band < 1)
+        band = 1;
+    for (int r = 0; r < h; r++)
+        for (int c = 0; c < w; c++)
+            raster[(size_t) r * w + c] = ((r / band) % 2 == 0 ? first : second)(r, c, w);
+    return raster;
+}
+
+#endif
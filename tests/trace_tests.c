@@ -0,0 +1,38 @@
+#include <criterion/criterion.h>
+#include <criterion/logging.h>
+#include <string.h>
+
+#include "const.h"
+#include "trace.h"
+
+static int count_occurrences(char *text, char *pattern) {
+    int count = 0;
+    for (char *p = strstr(text, pattern); p != NULL; p = strstr(p + 1, pattern))
+        count++;
+    return count;
+}
+
+Test(trace_tests_suite, ring_wraps_and_stays_nested_test, .timeout=5) {
+    cr_assert_eq(trace_enable(), 0, "trace_enable failed");
+    trace_event("outer", 'B');
+    for (int i = 0; i < TRACE_RING_SIZE; i++) {
+        trace_event("inner", 'B');
+        trace_event("inner", 'E');
+    }
+    trace_event("outer", 'E');
+    trace_event("unfinished", 'B');
+    cr_assert_eq(trace_write("test_output/trace_test.json"), 0, "trace_write failed");
+    FILE *f = fopen("test_output/trace_test.json", "r");
+    cr_assert_not_null(f, "trace file not created");
+    static char text[1 << 24];
+    size_t len = fread(text, 1, sizeof(text) - 1, f);
+    text[len] = '\0';
+    fclose(f);
+    remove("test_output/trace_test.json");
+    int begins = count_occurrences(text, "\"ph\": \"B\"");
+    int ends = count_occurrences(text, "\"ph\": \"E\"");
+    cr_assert_eq(begins, ends, "Unbalanced trace.  Begins: %d | Ends: %d", begins, ends);
+    cr_assert_eq(begins, TRACE_RING_SIZE / 2 - 1, "Wrong number of complete events.  Got: %d", begins);
+    cr_assert_eq(count_occurrences(text, "outer"), 0, "Event whose begin was overwritten was kept");
+    cr_assert_eq(count_occurrences(text, "unfinished"), 0, "Event that never ended was kept");
+}